@@ -32,6 +32,8 @@
 	geany_functions->p_plugin->plugin_timeout_add_seconds
 #define plugin_idle_add \
 	geany_functions->p_plugin->plugin_idle_add
+#define plugin_document_changes_connect \
+	geany_functions->p_plugin->plugin_document_changes_connect
 #define document_new_file \
 	geany_functions->p_document->document_new_file
 #define document_get_current \
@@ -350,6 +352,8 @@
 	geany_functions->p_tm->tm_work_object_free
 #define tm_workspace_remove_object \
 	geany_functions->p_tm->tm_workspace_remove_object
+#define tm_source_file_get_tag_at_line \
+	geany_functions->p_tm->tm_source_file_get_tag_at_line
 #define search_show_find_in_files_dialog \
 	geany_functions->p_search->search_show_find_in_files_dialog
 #define highlighting_get_style \
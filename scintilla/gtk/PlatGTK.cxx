@@ -143,52 +143,80 @@ static void FontMutexUnlock() {
 #endif
 }
 
+enum fontPitch { pitchUnknown, pitchFixed, pitchVariable };
+
+// Advance widths are cached per font for characters in the Basic Multilingual Plane.
+// The table is split into pages of 256 characters and a page is only allocated when a
+// character from it is first measured, so ASCII-only text costs a single page.
+const int widthPageSize = 256;
+const int widthPages = 0x10000 / widthPageSize;
+
 // On GTK+ 1.x holds a GdkFont* but on GTK+ 2.x can hold a GdkFont* or a
 // PangoFontDescription*.
 class FontHandle {
-	XYPOSITION width[128];
+	XYPOSITION *widths[widthPages];
 	encodingType et;
 public:
 	int ascent;
 	PangoFontDescription *pfd;
 	int characterSet;
-	FontHandle() : et(singleByte), ascent(0), pfd(0), characterSet(-1) {
-		ResetWidths(et);
+	fontPitch pitch;
+	FontHandle() : et(singleByte), ascent(0), pfd(0), characterSet(-1), pitch(pitchUnknown) {
+		for (int page=0; page<widthPages; page++) {
+			widths[page] = 0;
+		}
 	}
 	FontHandle(PangoFontDescription *pfd_, int characterSet_) {
 		et = singleByte;
 		ascent = 0;
 		pfd = pfd_;
 		characterSet = characterSet_;
-		ResetWidths(et);
+		pitch = pitchUnknown;
+		for (int page=0; page<widthPages; page++) {
+			widths[page] = 0;
+		}
 	}
 	~FontHandle() {
 		if (pfd)
 			pango_font_description_free(pfd);
 		pfd = 0;
+		ResetWidths(et);
 	}
 	void ResetWidths(encodingType et_) {
 		et = et_;
-		for (int i=0; i<=127; i++) {
-			width[i] = 0;
+		for (int page=0; page<widthPages; page++) {
+			delete []widths[page];
+			widths[page] = 0;
 		}
 	}
-	XYPOSITION CharWidth(unsigned char ch, encodingType et_) {
+	// Returns 0 when the width of ch has not been measured yet.
+	// Characters above ASCII are only cached for UTF-8 as other encodings
+	// do not index the table by Unicode code point.
+	XYPOSITION CharWidth(unsigned int ch, encodingType et_) {
 		XYPOSITION w = 0;
 		FontMutexLock();
-		if ((ch <= 127) && (et == et_)) {
-			w = width[ch];
+		if ((ch < 0x10000) && (et == et_) && ((ch <= 127) || (et == UTF8))) {
+			const XYPOSITION *page = widths[ch / widthPageSize];
+			if (page)
+				w = page[ch % widthPageSize];
 		}
 		FontMutexUnlock();
 		return w;
 	}
-	void SetCharWidth(unsigned char ch, XYPOSITION w, encodingType et_) {
-		if (ch <= 127) {
+	void SetCharWidth(unsigned int ch, XYPOSITION w, encodingType et_) {
+		if ((ch < 0x10000) && ((ch <= 127) || (et_ == UTF8))) {
 			FontMutexLock();
 			if (et != et_) {
 				ResetWidths(et_);
 			}
-			width[ch] = w;
+			XYPOSITION *&page = widths[ch / widthPageSize];
+			if (!page) {
+				page = new XYPOSITION[widthPageSize];
+				for (int i=0; i<widthPageSize; i++) {
+					page[i] = 0;
+				}
+			}
+			page[ch % widthPageSize] = w;
 			FontMutexUnlock();
 		}
 	}
@@ -365,6 +393,10 @@ class SurfaceImpl : public Surface {
 	Converter conv;
 	int characterSet;
 	void SetConverter(int characterSet_);
+	XYPOSITION MeasureCharPango(FontHandle *fh, unsigned int ch);
+	XYPOSITION CachedCharWidth(FontHandle *fh, unsigned int ch);
+	bool IsFixedPitch(FontHandle *fh);
+	bool MeasureWidthsSimple(Font &font_, const char *s, int len, XYPOSITION *positions);
 public:
 	SurfaceImpl();
 	virtual ~SurfaceImpl();
@@ -975,16 +1007,118 @@ public:
 	}
 };
 
+// Characters which may change shape or width depending on their neighbours, or
+// which are not handled by the per-character width table, so need Pango to lay
+// out the whole run.
+static bool IsShapingSensitive(unsigned int ch) {
+	if ((ch < 0x20) || (ch == 0x7F))
+		return true;	// Control characters
+	if (ch < 0x300)
+		return false;	// Latin
+	return
+		(ch < 0x370) ||	// Combining diacritical marks
+		((ch >= 0x483) && (ch <= 0x489)) ||	// Cyrillic combining marks
+		((ch >= 0x590) && (ch < 0x1100)) ||	// Hebrew, Arabic and complex scripts to Myanmar
+		((ch >= 0x1100) && (ch < 0x1200)) ||	// Hangul Jamo combine into syllables
+		((ch >= 0x1700) && (ch < 0x1D00)) ||	// Philippine, Khmer, Mongolian, Balinese, ...
+		((ch >= 0x1DC0) && (ch < 0x1E00)) ||	// Combining diacritical marks supplement
+		((ch >= 0x200B) && (ch < 0x2010)) ||	// Zero width and directional marks
+		((ch >= 0x2028) && (ch < 0x202F)) ||	// Separators and directional embeddings
+		((ch >= 0x2060) && (ch < 0x2070)) ||	// Invisible operators and deprecated format
+		((ch >= 0x20D0) && (ch < 0x2100)) ||	// Combining marks for symbols
+		((ch >= 0xA800) && (ch < 0xAC00)) ||	// Syloti Nagri to Myanmar extended
+		((ch >= 0xD800) && (ch < 0xE000)) ||	// Surrogates
+		((ch >= 0xFB1D) && (ch < 0xFE10)) ||	// Presentation forms and variation selectors
+		((ch >= 0xFE20) && (ch < 0xFE30)) ||	// Combining half marks
+		((ch >= 0xFE70) && (ch < 0xFF00)) ||	// Arabic presentation forms and BOM
+		((ch >= 0xFFF0) && (ch < 0x10000));	// Specials
+}
+
+XYPOSITION SurfaceImpl::MeasureCharPango(FontHandle *fh, unsigned int ch) {
+	char utf[8];
+	const gint lenUtf = g_unichar_to_utf8(ch, utf);
+	PangoRectangle pos;
+	pango_layout_set_font_description(layout, fh->pfd);
+	pango_layout_set_text(layout, utf, lenUtf);
+#ifdef PANGO_VERSION
+	PangoLayoutLine *pangoLine = pango_layout_get_line_readonly(layout, 0);
+#else
+	PangoLayoutLine *pangoLine = pango_layout_get_line(layout, 0);
+#endif
+	pango_layout_line_get_extents(pangoLine, NULL, &pos);
+	return doubleFromPangoUnits(pos.width);
+}
+
+XYPOSITION SurfaceImpl::CachedCharWidth(FontHandle *fh, unsigned int ch) {
+	XYPOSITION width = fh->CharWidth(ch, et);
+	if (width == 0) {
+		width = MeasureCharPango(fh, ch);
+		fh->SetCharWidth(ch, width, et);
+	}
+	return width;
+}
+
+// Kerning and ligatures mean that positions in proportional fonts can not be summed
+// from individual character widths, so the simple path is only taken for fonts where
+// a selection of narrow and wide characters all have the same advance.
+bool SurfaceImpl::IsFixedPitch(FontHandle *fh) {
+	if (fh->pitch == pitchUnknown) {
+		const XYPOSITION widthNarrow = CachedCharWidth(fh, 'i');
+		fh->pitch = ((widthNarrow > 0) &&
+			(CachedCharWidth(fh, 'W') == widthNarrow) &&
+			(CachedCharWidth(fh, 'm') == widthNarrow) &&
+			(CachedCharWidth(fh, '.') == widthNarrow)) ? pitchFixed : pitchVariable;
+	}
+	return fh->pitch == pitchFixed;
+}
+
+// Calculate positions as cumulative sums of cached character widths. Returns false
+// without a complete result when the run needs shaping by Pango.
+bool SurfaceImpl::MeasureWidthsSimple(Font &font_, const char *s, int len, XYPOSITION *positions) {
+	FontHandle *fh = PFont(font_);
+	const unsigned char *us = reinterpret_cast<const unsigned char *>(s);
+	XYPOSITION position = 0;
+	int i = 0;
+	while (i < len) {
+		if ((i > 0) && !IsFixedPitch(fh))
+			return false;
+		unsigned int ch = us[i];
+		int lenChar = 1;
+		if (ch >= 0x80) {
+			if (et != UTF8)
+				return false;
+			if ((ch >= 0xC2) && (ch < 0xE0) && (i + 1 < len) &&
+				((us[i+1] & 0xC0) == 0x80)) {
+				ch = ((ch & 0x1F) << 6) | (us[i+1] & 0x3F);
+				lenChar = 2;
+			} else if ((ch >= 0xE0) && (ch < 0xF0) && (i + 2 < len) &&
+				((us[i+1] & 0xC0) == 0x80) && ((us[i+2] & 0xC0) == 0x80)) {
+				ch = ((ch & 0xF) << 12) | ((us[i+1] & 0x3F) << 6) | (us[i+2] & 0x3F);
+				if (ch < 0x800)
+					return false;	// Overlong form
+				lenChar = 3;
+			} else {
+				return false;	// Invalid or outside the Basic Multilingual Plane
+			}
+		}
+		if (IsShapingSensitive(ch))
+			return false;
+		const XYPOSITION width = CachedCharWidth(fh, ch);
+		// Evenly distribute space among bytes of this character as the Pango path does.
+		for (int place=1; place<=lenChar; place++) {
+			positions[i++] = position + width * place / lenChar;
+		}
+		position += width;
+	}
+	return true;
+}
+
 void SurfaceImpl::MeasureWidths(Font &font_, const char *s, int len, XYPOSITION *positions) {
 	if (font_.GetID()) {
 		const int lenPositions = len;
 		if (PFont(font_)->pfd) {
-			if (len == 1) {
-				int width = PFont(font_)->CharWidth(*s, et);
-				if (width) {
-					positions[0] = width;
-					return;
-				}
+			if (MeasureWidthsSimple(font_, s, len, positions)) {
+				return;
 			}
 			pango_layout_set_font_description(layout, PFont(font_)->pfd);
 			if (et == UTF8) {
@@ -1065,9 +1199,6 @@ void SurfaceImpl::MeasureWidths(Font &font_, const char *s, int len, XYPOSITION
 					PLATFORM_ASSERT(i == lenPositions);
 				}
 			}
-			if (len == 1) {
-				PFont(font_)->SetCharWidth(*s, positions[0], et);
-			}
 			return;
 		}
 	} else {
@@ -1081,6 +1212,12 @@ void SurfaceImpl::MeasureWidths(Font &font_, const char *s, int len, XYPOSITION
 XYPOSITION SurfaceImpl::WidthText(Font &font_, const char *s, int len) {
 	if (font_.GetID()) {
 		if (PFont(font_)->pfd) {
+			if ((len > 0) && (len <= 256)) {
+				XYPOSITION positions[256];
+				if (MeasureWidthsSimple(font_, s, len, positions)) {
+					return positions[len-1];
+				}
+			}
 			char *utfForm = 0;
 			pango_layout_set_font_description(layout, PFont(font_)->pfd);
 			PangoRectangle pos;
@@ -1391,6 +1528,7 @@ class ListBoxX : public ListBox {
 	int desiredVisibleRows;
 	unsigned int maxItemCharacters;
 	unsigned int aveCharWidth;
+	void SetRow(GtkTreeIter *iter, char *s, int type);
 public:
 	CallBackAction doubleClickAction;
 	void *doubleClickActionData;
@@ -1414,6 +1552,8 @@ public:
 	virtual int CaretFromEdge();
 	virtual void Clear();
 	virtual void Append(char *s, int type = -1);
+	virtual void Insert(int n, char *s, int type = -1);
+	virtual void Remove(int n, int count);
 	virtual int Length();
 	virtual void Select(int n);
 	virtual int GetSelection();
@@ -1670,21 +1810,19 @@ static void init_pixmap(ListImage *list_image) {
 
 #define SPACING 5
 
-void ListBoxX::Append(char *s, int type) {
+void ListBoxX::SetRow(GtkTreeIter *iter, char *s, int type) {
 	ListImage *list_image = NULL;
 	if ((type >= 0) && pixhash) {
 		list_image = static_cast<ListImage *>(g_hash_table_lookup((GHashTable *) pixhash
 		             , (gconstpointer) GINT_TO_POINTER(type)));
 	}
-	GtkTreeIter iter;
 	GtkListStore *store =
 		GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(list)));
-	gtk_list_store_append(GTK_LIST_STORE(store), &iter);
 	if (list_image) {
 		if (NULL == list_image->pixbuf)
 			init_pixmap(list_image);
 		if (list_image->pixbuf) {
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter,
+			gtk_list_store_set(GTK_LIST_STORE(store), iter,
 								PIXBUF_COLUMN, list_image->pixbuf,
 								TEXT_COLUMN, s, -1);
 
@@ -1696,11 +1834,11 @@ void ListBoxX::Append(char *s, int type) {
 				gtk_cell_renderer_set_fixed_size(pixbuf_renderer,
 								pixbuf_width, -1);
 		} else {
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter,
+			gtk_list_store_set(GTK_LIST_STORE(store), iter,
 								TEXT_COLUMN, s, -1);
 		}
 	} else {
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter,
+			gtk_list_store_set(GTK_LIST_STORE(store), iter,
 								TEXT_COLUMN, s, -1);
 	}
 	size_t len = strlen(s);
@@ -1708,6 +1846,31 @@ void ListBoxX::Append(char *s, int type) {
 		maxItemCharacters = len;
 }
 
+void ListBoxX::Append(char *s, int type) {
+	GtkTreeIter iter;
+	GtkListStore *store =
+		GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(list)));
+	gtk_list_store_append(GTK_LIST_STORE(store), &iter);
+	SetRow(&iter, s, type);
+}
+
+void ListBoxX::Insert(int n, char *s, int type) {
+	GtkTreeIter iter;
+	GtkListStore *store =
+		GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(list)));
+	gtk_list_store_insert(GTK_LIST_STORE(store), &iter, n);
+	SetRow(&iter, s, type);
+}
+
+void ListBoxX::Remove(int n, int count) {
+	GtkTreeIter iter;
+	GtkTreeModel *model = gtk_tree_view_get_model(GTK_TREE_VIEW(list));
+	bool valid = gtk_tree_model_iter_nth_child(model, &iter, NULL, n) != FALSE;
+	// Removing a row moves the iterator to the following one
+	for (; valid && count > 0; count--)
+		valid = gtk_list_store_remove(GTK_LIST_STORE(model), &iter) != FALSE;
+}
+
 int ListBoxX::Length() {
 	if (wid)
 		return gtk_tree_model_iter_n_children(gtk_tree_view_get_model
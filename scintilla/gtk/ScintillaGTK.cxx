@@ -158,6 +158,8 @@ class ScintillaGTK : public ScintillaBase {
 	GdkRegion *rgnUpdate;
 #endif
 
+	guint styleIdleID;
+
 	// Private so ScintillaGTK objects can not be copied
 	ScintillaGTK(const ScintillaGTK &);
 	ScintillaGTK &operator=(const ScintillaGTK &);
@@ -362,7 +364,8 @@ ScintillaGTK::ScintillaGTK(_ScintillaObject *sci_) :
 		im_context(NULL),
 		lastWheelMouseDirection(0),
 		wheelMouseIntensity(0),
-		rgnUpdate(0) {
+		rgnUpdate(0),
+		styleIdleID(0) {
 	sci = sci_;
 	wMain = GTK_WIDGET(sci);
 
@@ -811,6 +814,10 @@ void ScintillaGTK::Initialise() {
 
 void ScintillaGTK::Finalise() {
 	SetTicking(false);
+	if (styleIdleID) {
+		g_source_remove(styleIdleID);
+		styleIdleID = 0;
+	}
 	ScintillaBase::Finalise();
 }
 
@@ -2754,10 +2761,12 @@ gboolean ScintillaGTK::IdleCallback(ScintillaGTK *sciThis) {
 
 gboolean ScintillaGTK::StyleIdle(ScintillaGTK *sciThis) {
 	gdk_threads_enter();
-	sciThis->IdleStyling();
+	bool moreStyling = sciThis->IdleStyling();
 	gdk_threads_leave();
-	// Idler will be automatically stopped
-	return FALSE;
+	// Idler will be automatically stopped once styling is complete
+	if (!moreStyling)
+		sciThis->styleIdleID = 0;
+	return moreStyling;
 }
 
 void ScintillaGTK::QueueStyling(int upTo) {
@@ -2765,7 +2774,9 @@ void ScintillaGTK::QueueStyling(int upTo) {
 	if (!styleNeeded.active) {
 		// Only allow one style needed to be queued
 		styleNeeded.active = true;
-		g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+		// The source stays ready until the whole document is styled so it must not
+		// starve redrawing, resizing, other idle sources or low priority timers
+		styleIdleID = g_idle_add_full(G_PRIORITY_LOW + 10,
 			reinterpret_cast<GSourceFunc>(StyleIdle), this, NULL);
 	}
 }
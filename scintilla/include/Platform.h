@@ -404,6 +404,8 @@ public:
 	virtual int CaretFromEdge()=0;
 	virtual void Clear()=0;
 	virtual void Append(char *s, int type = -1)=0;
+	virtual void Insert(int n, char *s, int type = -1)=0;
+	virtual void Remove(int n, int count)=0;
 	virtual int Length()=0;
 	virtual void Select(int n)=0;
 	virtual int GetSelection()=0;
@@ -47,6 +47,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_START 2000
 #define SCI_OPTIONAL_START 3000
 #define SCI_LEXER_START 4000
+#define SCI_PRIVATE_START 9000
 #define SCI_ADDTEXT 2001
 #define SCI_ADDSTYLEDTEXT 2002
 #define SCI_INSERTTEXT 2003
@@ -438,6 +439,11 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_SETFOLDEXPANDED 2229
 #define SCI_GETFOLDEXPANDED 2230
 #define SCI_TOGGLEFOLD 2231
+#define SC_FOLDACTION_CONTRACT 0
+#define SC_FOLDACTION_EXPAND 1
+#define SC_FOLDACTION_TOGGLE 2
+#define SCI_FOLDALL 2662
+#define SCI_FOLDTOLEVEL 9000
 #define SCI_ENSUREVISIBLE 2232
 #define SC_FOLDFLAG_LINEBEFORE_EXPANDED 0x0002
 #define SC_FOLDFLAG_LINEBEFORE_CONTRACTED 0x0004
@@ -696,6 +702,10 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SC_CASEINSENSITIVEBEHAVIOUR_IGNORECASE 1
 #define SCI_AUTOCSETCASEINSENSITIVEBEHAVIOUR 2634
 #define SCI_AUTOCGETCASEINSENSITIVEBEHAVIOUR 2635
+#define SC_ORDER_PRESORTED 0
+#define SC_ORDER_CUSTOM 2
+#define SCI_AUTOCSETORDER 2660
+#define SCI_AUTOCGETORDER 2661
 #define SCI_ALLOCATE 2446
 #define SCI_TARGETASUTF8 2447
 #define SCI_SETLENGTHFORENCODE 2448
@@ -853,6 +863,23 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_FINDINDICATORHIDE 2642
 #define SCI_VCHOMEDISPLAY 2652
 #define SCI_VCHOMEDISPLAYEXTEND 2653
+#define SC_IDLESTYLING_NONE 0
+#define SC_IDLESTYLING_AFTERVISIBLE 2
+#define SCI_SETIDLESTYLING 2692
+#define SCI_GETIDLESTYLING 2693
+#define SCI_SETUNDOMEMORYLIMIT 9001
+#define SCI_GETUNDOMEMORYLIMIT 9002
+#define SCI_GETUNDOMEMORY 9003
+#define SCI_AUTOCSETFILTER 9004
+#define SCI_AUTOCGETFILTER 9005
+#define SCI_GETREVISION 9006
+#define SCI_CREATESNAPSHOT 9007
+#define SCI_RELEASESNAPSHOT 9008
+#define SCI_GETCHANGEDRANGES 9009
+#define SC_DOCUMENTSTORAGE_GAP 0
+#define SC_DOCUMENTSTORAGE_CHUNKED 1
+#define SCI_SETDOCUMENTSTORAGE 9010
+#define SCI_GETDOCUMENTSTORAGE 9011
 #define SCI_STARTRECORD 3001
 #define SCI_STOPRECORD 3002
 #define SCI_SETLEXER 4001
@@ -984,6 +1011,20 @@ struct Sci_TextToFind {
 	struct Sci_CharacterRange chrgText;
 };
 
+struct Sci_TextPiece {
+	const char *text;
+	int length;
+};
+
+/* The text of a document at one revision, see SCI_CREATESNAPSHOT. */
+struct Sci_Snapshot {
+	const char *text;	/* NUL terminated, NULL when the document is stored in chunks */
+	int length;
+	int revision;
+	int pieceCount;
+	const struct Sci_TextPiece *pieces;	/* the whole text in order */
+};
+
 #define CharacterRange Sci_CharacterRange
 #define TextRange Sci_TextRange
 #define TextToFind Sci_TextToFind
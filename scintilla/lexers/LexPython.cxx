@@ -566,6 +566,7 @@ static const char *const pythonWordListDesc[] = {
 	0
 };
 
+// All state is carried by the style at the end of the previous line
 LexerModule lmPython(SCLEX_PYTHON, ColourisePyDoc, "python", FoldPyDoc,
-					 pythonWordListDesc);
+					 pythonWordListDesc, 5, true);
 
@@ -0,0 +1,90 @@
+// Scintilla source code edit control
+/** @file LexerCheckpoints.h
+ ** Track which styling from a previous lexing pass is still valid after modifications
+ ** so restyling can stop once the lexer state at a checkpoint line has converged.
+ ** Only usable with lexers that keep all their state in the document: styles, line
+ ** states and fold levels. Lexers holding per-line state internally, such as the
+ ** preprocessor state of LexerCPP, would lose that state for the skipped lines.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef LEXERCHECKPOINTS_H
+#define LEXERCHECKPOINTS_H
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+/// The state a lexer and folder start a line with.
+struct LexerCheckpoint {
+	int style;	///< Style of the last character of the previous line
+	int lineState;	///< Line state of the previous line
+	int level;	///< Fold level of the previous line
+	LexerCheckpoint() : style(0), lineState(0), level(0) {
+	}
+	LexerCheckpoint(int style_, int lineState_, int level_) :
+		style(style_), lineState(lineState_), level(level_) {
+	}
+	bool operator==(const LexerCheckpoint &other) const {
+		return (style == other.style) && (lineState == other.lineState) && (level == other.level);
+	}
+	bool operator!=(const LexerCheckpoint &other) const {
+		return !(*this == other);
+	}
+};
+
+/// Text in [positionFrom, positionTo) still has the styles, line states and fold levels of
+/// the previous pass. Checkpoints are lines, every linesBetween lines, inside that range.
+class LexerCheckpoints {
+	int positionFrom;
+	int positionTo;
+public:
+	enum { linesBetween = 128 };
+
+	LexerCheckpoints() : positionFrom(-1), positionTo(-1) {
+	}
+	void Invalidate() {
+		positionFrom = -1;
+		positionTo = -1;
+	}
+	bool Valid() const {
+		return positionFrom < positionTo;
+	}
+	int From() const {
+		return positionFrom;
+	}
+	int To() const {
+		return positionTo;
+	}
+	/// Text of length lengthChange (negative for deletions) changed at position while
+	/// text was styled up to endStyled. lineStart is the start of the line containing
+	/// position after the change.
+	void TextChanged(int position, int lengthChange, int endStyled, int lineStart) {
+		const int lengthDeleted = (lengthChange < 0) ? -lengthChange : 0;
+		if (!Valid()) {
+			if (position < endStyled) {
+				// First modification of styled text: all the text after it was styled
+				positionFrom = position + ((lengthChange > 0) ? lengthChange : 0);
+				positionTo = endStyled + lengthChange;
+			}
+		} else if (position + lengthDeleted <= positionFrom) {
+			positionFrom += lengthChange;
+			positionTo += lengthChange;
+		} else if (position < positionFrom) {
+			// Deletion overlapping the start of the range
+			positionFrom = position;
+			positionTo += lengthChange;
+		} else if (position < positionTo) {
+			// Text from this line on has not been lexed since being modified
+			positionTo = lineStart;
+		}
+		if (positionTo <= positionFrom)
+			Invalidate();
+	}
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+#endif
@@ -35,13 +35,15 @@ LexerModule::LexerModule(int language_,
 	const char *languageName_,
 	LexerFunction fnFolder_,
         const char *const wordListDescriptions_[],
-	int styleBits_) :
+	int styleBits_,
+	bool stateInDocument_) :
 	language(language_),
 	fnLexer(fnLexer_),
 	fnFolder(fnFolder_),
 	fnFactory(0),
 	wordListDescriptions(wordListDescriptions_),
 	styleBits(styleBits_),
+	stateInDocument(stateInDocument_),
 	languageName(languageName_) {
 }
 
@@ -56,6 +58,7 @@ LexerModule::LexerModule(int language_,
 	fnFactory(fnFactory_),
 	wordListDescriptions(wordListDescriptions_),
 	styleBits(styleBits_),
+	stateInDocument(false),
 	languageName(languageName_) {
 }
 
@@ -32,6 +32,7 @@ protected:
 	LexerFactoryFunction fnFactory;
 	const char * const * wordListDescriptions;
 	int styleBits;
+	bool stateInDocument;
 
 public:
 	const char *languageName;
@@ -40,7 +41,8 @@ public:
 		const char *languageName_=0,
 		LexerFunction fnFolder_=0,
 		const char * const wordListDescriptions_[] = NULL,
-		int styleBits_=5);
+		int styleBits_=5,
+		bool stateInDocument_=false);
 	LexerModule(int language_,
 		LexerFactoryFunction fnFactory_,
 		const char *languageName_,
@@ -56,6 +58,11 @@ public:
 
 	int GetStyleBitsNeeded() const;
 
+	// Only set for lexers whose whole state at a line start is the previous style, line
+	// state and fold level. Others may depend on earlier text such as here-doc delimiters
+	// or hold per-line state internally like factory lexers.
+	bool StateInDocument() const { return stateInDocument; }
+
 	ILexer *Create() const;
 
 	virtual void Lex(unsigned int startPos, int length, int initStyle,
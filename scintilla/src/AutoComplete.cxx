@@ -11,6 +11,7 @@
 #include <assert.h>
 
 #include <string>
+#include <vector>
 
 #include "Platform.h"
 
@@ -34,6 +35,8 @@ AutoComplete::AutoComplete() :
 	cancelAtStartPos(true),
 	autoHide(true),
 	dropRestOfWord(false),
+	filter(false),
+	autoSort(SC_ORDER_PRESORTED),
 	ignoreCaseBehaviour(SC_CASEINSENSITIVEBEHAVIOUR_RESPECTCASE),
 	widthLBDefault(100),
 	heightLBDefault(100) {
@@ -62,6 +65,10 @@ void AutoComplete::Start(Window &parent, int ctrlID,
 	}
 	lb->Create(parent, ctrlID, location, lineHeight, unicodeMode, technology);
 	lb->Clear();
+	items.clear();
+	itemTypes.clear();
+	shown.clear();
+	filterWord.clear();
 	active = true;
 	startLen = startLen_;
 	posStart = position;
@@ -102,7 +109,30 @@ char AutoComplete::GetTypesep() const {
 }
 
 void AutoComplete::SetList(const char *list) {
-	lb->SetList(list, separator, typesep);
+	items.clear();
+	itemTypes.clear();
+	shown.clear();
+	filterWord.clear();
+	const char *startWord = list;
+	const char *typeWord = NULL;
+	for (const char *s = list; ; s++) {
+		if (*s == separator || *s == '\0') {
+			const char *endWord = typeWord ? typeWord : s;
+			items.push_back(std::string(startWord, endWord - startWord));
+			itemTypes.push_back(typeWord ? atoi(typeWord + 1) : -1);
+			if (*s == '\0')
+				break;
+			startWord = s + 1;
+			typeWord = NULL;
+		} else if (*s == typesep) {
+			typeWord = s;
+		}
+	}
+	lb->Clear();
+	for (size_t i = 0; i < items.size(); i++) {
+		shown.push_back(static_cast<int>(i));
+		lb->Append(const_cast<char *>(items[i].c_str()), itemTypes[i]);
+	}
 }
 
 int AutoComplete::GetSelection() const {
@@ -110,9 +140,9 @@ int AutoComplete::GetSelection() const {
 }
 
 std::string AutoComplete::GetValue(int item) const {
-	char value[maxItemLen];
-	lb->GetValue(item, value, sizeof(value));
-	return std::string(value);
+	if (item >= 0 && item < static_cast<int>(shown.size()))
+		return items[shown[item]];
+	return std::string();
 }
 
 void AutoComplete::Show(bool show) {
@@ -127,6 +157,10 @@ void AutoComplete::Cancel() {
 		lb->Destroy();
 		active = false;
 	}
+	items.clear();
+	itemTypes.clear();
+	shown.clear();
+	filterWord.clear();
 }
 
 
@@ -144,12 +178,34 @@ void AutoComplete::Move(int delta) {
 void AutoComplete::Select(const char *word) {
 	size_t lenWord = strlen(word);
 	int location = -1;
+	if (autoSort == SC_ORDER_CUSTOM) {
+		// Items are not sorted so take the best ranked one starting with the word,
+		// or the best ranked one at all as the container chose them for this word
+		for (size_t i = 0; i < shown.size(); i++) {
+			const std::string &item = items[shown[i]];
+			if (!ItemStartsWith(item, word, lenWord))
+				continue;
+			if (location == -1)
+				location = static_cast<int>(i);
+			if (!ignoreCase || ignoreCaseBehaviour != SC_CASEINSENSITIVEBEHAVIOUR_RESPECTCASE ||
+				!strncmp(word, item.c_str(), lenWord)) {
+				location = static_cast<int>(i);
+				break;
+			}
+		}
+		if ((location == -1) && !shown.empty())
+			location = 0;
+		if (location == -1 && autoHide)
+			Cancel();
+		else
+			lb->Select(location);
+		return;
+	}
 	int start = 0; // lower bound of the api array block to search
-	int end = lb->Length() - 1; // upper bound of the api array block to search
+	int end = static_cast<int>(shown.size()) - 1; // upper bound of the api array block to search
 	while ((start <= end) && (location == -1)) { // Binary searching loop
 		int pivot = (start + end) / 2;
-		char item[maxItemLen];
-		lb->GetValue(pivot, item, maxItemLen);
+		const char *item = items[shown[pivot]].c_str();
 		int cond;
 		if (ignoreCase)
 			cond = CompareNCaseInsensitive(word, item, lenWord);
@@ -158,7 +214,7 @@ void AutoComplete::Select(const char *word) {
 		if (!cond) {
 			// Find first match
 			while (pivot > start) {
-				lb->GetValue(pivot-1, item, maxItemLen);
+				item = items[shown[pivot-1]].c_str();
 				if (ignoreCase)
 					cond = CompareNCaseInsensitive(word, item, lenWord);
 				else
@@ -172,7 +228,7 @@ void AutoComplete::Select(const char *word) {
 				&& ignoreCaseBehaviour == SC_CASEINSENSITIVEBEHAVIOUR_RESPECTCASE) {
 				// Check for exact-case match
 				for (; pivot <= end; pivot++) {
-					lb->GetValue(pivot, item, maxItemLen);
+					item = items[shown[pivot]].c_str();
 					if (!strncmp(word, item, lenWord)) {
 						location = pivot;
 						break;
@@ -193,3 +249,81 @@ void AutoComplete::Select(const char *word) {
 		lb->Select(location);
 }
 
+bool AutoComplete::ItemStartsWith(const std::string &item, const char *word, size_t lenWord) const {
+	if (item.length() < lenWord)
+		return false;
+	if (ignoreCase)
+		return CompareNCaseInsensitive(word, item.c_str(), lenWord) == 0;
+	return strncmp(word, item.c_str(), lenWord) == 0;
+}
+
+/// Change the rows of the list box to the items in rows. As both shown and rows are in
+/// item order, only the rows being removed or added have to be touched.
+void AutoComplete::ShowItems(const std::vector<int> &rows) {
+	size_t common = 0;
+	for (size_t i = 0, j = 0; i < shown.size() && j < rows.size();) {
+		if (shown[i] < rows[j]) {
+			i++;
+		} else if (rows[j] < shown[i]) {
+			j++;
+		} else {
+			common++;
+			i++;
+			j++;
+		}
+	}
+	if ((shown.size() - common) + (rows.size() - common) > rows.size()) {
+		// Most rows change so it is quicker to fill the list again
+		lb->Clear();
+		for (size_t j = 0; j < rows.size(); j++)
+			lb->Append(const_cast<char *>(items[rows[j]].c_str()), itemTypes[rows[j]]);
+	} else {
+		int row = 0;
+		size_t i = 0;
+		size_t j = 0;
+		while (i < shown.size() || j < rows.size()) {
+			if (j == rows.size() || (i < shown.size() && shown[i] < rows[j])) {
+				const size_t first = i;
+				while (i < shown.size() && (j == rows.size() || shown[i] < rows[j]))
+					i++;
+				lb->Remove(row, static_cast<int>(i - first));
+			} else if (i == shown.size() || rows[j] < shown[i]) {
+				lb->Insert(row, const_cast<char *>(items[rows[j]].c_str()), itemTypes[rows[j]]);
+				row++;
+				j++;
+			} else {
+				row++;
+				i++;
+				j++;
+			}
+		}
+	}
+	shown = rows;
+}
+
+void AutoComplete::Filter(const char *word) {
+	size_t lenWord = strlen(word);
+	// Items not starting with the previous word can not start with a longer one
+	const bool narrowing = ItemStartsWith(word, filterWord.c_str(), filterWord.length());
+	std::vector<int> rows;
+	const size_t candidates = narrowing ? shown.size() : items.size();
+	for (size_t i = 0; i < candidates; i++) {
+		const int item = narrowing ? shown[i] : static_cast<int>(i);
+		if (ItemStartsWith(items[item], word, lenWord))
+			rows.push_back(item);
+	}
+	if (rows.empty() || (rows.size() == 1 && items[rows[0]] == word)) {
+		// Nothing left to choose from
+		if (autoHide) {
+			Cancel();
+			return;
+		}
+		if (rows.empty()) {
+			lb->Select(-1);
+			return;
+		}
+	}
+	ShowItems(rows);
+	filterWord = word;
+	Select(word);
+}
@@ -22,6 +22,17 @@ class AutoComplete {
 	char typesep; // Type seperator
 	enum { maxItemLen=1000 };
 
+	/// All the items of the list and their image types
+	std::vector<std::string> items;
+	std::vector<int> itemTypes;
+	/// The items shown in the list box, as indices into items
+	std::vector<int> shown;
+	/// The word the shown items were filtered by
+	std::string filterWord;
+
+	bool ItemStartsWith(const std::string &item, const char *word, size_t lenWord) const;
+	void ShowItems(const std::vector<int> &rows);
+
 public:
 
 	bool ignoreCase;
@@ -33,6 +44,10 @@ public:
 	bool cancelAtStartPos;
 	bool autoHide;
 	bool dropRestOfWord;
+	/// Should the list be narrowed to the matching items as the word is typed?
+	bool filter;
+	/// SC_ORDER_PRESORTED for items in sort order or SC_ORDER_CUSTOM for items ranked by the container
+	int autoSort;
 	unsigned int ignoreCaseBehaviour;
 	int widthLBDefault;
 	int heightLBDefault;
@@ -80,6 +95,9 @@ public:
 
 	/// Select a list element that starts with word as the current element
 	void Select(const char *word);
+
+	/// Show only the list elements that start with word and select the first of them
+	void Filter(const char *word);
 };
 
 #ifdef SCI_NAMESPACE
@@ -10,11 +10,14 @@
 #include <stdlib.h>
 #include <stdarg.h>
 
+#include <vector>
+
 #include "Platform.h"
 
 #include "Scintilla.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "ChunkedVector.h"
 #include "CellBuffer.h"
 
 #ifdef SCI_NAMESPACE
@@ -68,40 +71,118 @@ int LineVector::LineFromPosition(int pos) const {
 	return starts.PartitionFromPosition(pos);
 }
 
+UndoBlock::UndoBlock(UndoArena *arena_, int size_) :
+	arena(arena_), data(new char[size_]), size(size_), used(0), references(0) {
+}
+
+UndoBlock::~UndoBlock() {
+	delete []data;
+	data = 0;
+}
+
+void UndoBlock::Release() {
+	PLATFORM_ASSERT(references > 0);
+	references--;
+	if (references == 0)
+		arena->BlockUnused(this);
+}
+
+UndoArena::UndoArena() : tail(0), allocated(0) {
+}
+
+UndoArena::~UndoArena() {
+	// All actions have been destroyed so only the tail block remains
+	delete tail;
+	tail = 0;
+}
+
+char *UndoArena::Append(const char *s, int length, UndoBlock *&block) {
+	if (length > blockSize / 4) {
+		// Large text such as from a replace all gets its own block so that it can be freed
+		// independently and does not waste the rest of the tail block
+		block = new UndoBlock(this, length);
+		allocated += length;
+	} else {
+		if (!tail || (tail->used + length > tail->size)) {
+			UndoBlock *full = tail;
+			tail = new UndoBlock(this, blockSize);
+			allocated += blockSize;
+			if (full && (full->references == 0))
+				BlockUnused(full);
+		}
+		block = tail;
+	}
+	char *data = block->data + block->used;
+	memcpy(data, s, length);
+	block->used += length;
+	block->references++;
+	return data;
+}
+
+bool UndoArena::Extend(UndoBlock *block, const char *data, int lenData, const char *s, int length) {
+	if (block && (block == tail) && (data + lenData == tail->data + tail->used) &&
+		(tail->used + length <= tail->size)) {
+		memcpy(tail->data + tail->used, s, length);
+		tail->used += length;
+		return true;
+	}
+	return false;
+}
+
+void UndoArena::BlockUnused(UndoBlock *block) {
+	if (block == tail) {
+		// Keep the tail for the next actions
+		tail->used = 0;
+	} else {
+		allocated -= block->size;
+		delete block;
+	}
+}
+
+int UndoArena::Allocated() const {
+	return allocated;
+}
+
 Action::Action() {
 	at = startAction;
 	position = 0;
 	data = 0;
 	lenData = 0;
 	mayCoalesce = false;
+	block = 0;
 }
 
 Action::~Action() {
 	Destroy();
 }
 
-void Action::Create(actionType at_, int position_, char *data_, int lenData_, bool mayCoalesce_) {
-	delete []data;
+void Action::Create(actionType at_, int position_, char *data_, int lenData_, bool mayCoalesce_, UndoBlock *block_) {
+	Destroy();
 	position = position_;
 	at = at_;
 	data = data_;
 	lenData = lenData_;
 	mayCoalesce = mayCoalesce_;
+	block = block_;
 }
 
 void Action::Destroy() {
-	delete []data;
+	// The text is owned by the arena so only the reference to its block is dropped
+	if (block)
+		block->Release();
+	block = 0;
 	data = 0;
 }
 
 void Action::Grab(Action *source) {
-	delete []data;
+	Destroy();
 
 	position = source->position;
 	at = source->at;
 	data = source->data;
 	lenData = source->lenData;
 	mayCoalesce = source->mayCoalesce;
+	block = source->block;
 
 	// Ownership of source data transferred to this
 	source->position = 0;
@@ -109,6 +190,7 @@ void Action::Grab(Action *source) {
 	source->data = 0;
 	source->lenData = 0;
 	source->mayCoalesce = true;
+	source->block = 0;
 }
 
 // The undo history stores a sequence of user operations that represent the user's view of the
@@ -128,6 +210,11 @@ void Action::Grab(Action *source) {
 // operation. If there is no outstanding BeginUndoAction call then a new operation is started
 // unless it looks as if the new action is caused by the user typing or deleting a stream of text.
 // Sequences that look like typing or deletion are coalesced into a single user operation.
+// The text of actions is stored in an append-only arena. When a coalesced insertion or
+// deletion continues the text of the previous action, that action is extended in place
+// so a run of typing takes a single action.
+// The oldest user operations are dropped when the memory used by the history exceeds
+// the memory limit.
 
 UndoHistory::UndoHistory() {
 
@@ -137,6 +224,7 @@ UndoHistory::UndoHistory() {
 	currentAction = 0;
 	undoSequenceDepth = 0;
 	savePoint = 0;
+	memoryLimit = 0;
 
 	actions[currentAction].Create(startAction);
 }
@@ -161,9 +249,49 @@ void UndoHistory::EnsureUndoRoom() {
 	}
 }
 
-void UndoHistory::AppendAction(actionType at, int position, char *data, int lengthData,
+// Release the text of the actions that can no longer be redone.
+void UndoHistory::DropRedo() {
+	for (int act = currentAction + 1; act <= maxAction; act++)
+		actions[act].Destroy();
+}
+
+// Forget the oldest user operations until the history fits in the memory limit. The user
+// operation being built or undone to is always kept.
+void UndoHistory::DropOldestActions() {
+	if ((memoryLimit <= 0) || (MemoryUsed() <= memoryLimit))
+		return;
+	// Aim below the limit so dropping is not repeated for every new operation
+	const int excess = MemoryUsed() - memoryLimit / 4 * 3;
+	int lastStart = currentAction - 1;
+	while ((lastStart > 0) && (actions[lastStart].at != startAction))
+		lastStart--;
+	int drop = 0;
+	int freed = 0;
+	for (int act = 1; act <= lastStart; act++) {
+		if (actions[act].at == startAction) {
+			drop = act;
+			if (freed >= excess)
+				break;
+		} else {
+			freed += actions[act].lenData + static_cast<int>(sizeof(Action));
+		}
+	}
+	if (drop == 0)
+		return;
+	for (int act = 1; act < drop; act++)
+		actions[act].Destroy();
+	// The start action at drop becomes the first action
+	for (int act = drop; act <= maxAction; act++)
+		actions[act - drop].Grab(&actions[act]);
+	maxAction -= drop;
+	currentAction -= drop;
+	savePoint = (savePoint >= drop) ? savePoint - drop : -1;
+}
+
+const char *UndoHistory::AppendAction(actionType at, int position, const char *data, int lengthData,
 	bool &startSequence, bool mayCoalesce) {
 	EnsureUndoRoom();
+	DropRedo();
 	//Platform::DebugPrintf("%% %d action %d %d %d\n", at, position, lengthData, currentAction);
 	//Platform::DebugPrintf("^ %d action %d %d\n", actions[currentAction - 1].at,
 	//	actions[currentAction - 1].position, actions[currentAction - 1].lenData);
@@ -225,10 +353,31 @@ void UndoHistory::AppendAction(actionType at, int position, char *data, int leng
 		currentAction++;
 	}
 	startSequence = oldCurrentAction != currentAction;
-	actions[currentAction].Create(at, position, data, lengthData, mayCoalesce);
+	if (!startSequence && (currentAction >= 1) && (lengthData > 0) &&
+		(actions[currentAction].at == startAction)) {
+		Action &actLast = actions[currentAction - 1];
+		if ((actLast.at == at) && actLast.mayCoalesce && mayCoalesce &&
+			(((at == insertAction) && (position == actLast.position + actLast.lenData)) ||
+			((at == removeAction) && (position == actLast.position))) &&
+			arena.Extend(actLast.block, actLast.data, actLast.lenData, data, lengthData)) {
+			// Typing or forward deletion continuing the text of the last action
+			const char *dataAppended = actLast.data + actLast.lenData;
+			actLast.lenData += lengthData;
+			maxAction = currentAction;
+			return dataAppended;
+		}
+	}
+	char *dataStored = 0;
+	UndoBlock *block = 0;
+	if (lengthData > 0)
+		dataStored = arena.Append(data, lengthData, block);
+	actions[currentAction].Create(at, position, dataStored, lengthData, mayCoalesce, block);
 	currentAction++;
 	actions[currentAction].Create(startAction);
 	maxAction = currentAction;
+	if (startSequence)
+		DropOldestActions();
+	return dataStored;
 }
 
 void UndoHistory::BeginUndoAction() {
@@ -255,6 +404,7 @@ void UndoHistory::EndUndoAction() {
 			maxAction = currentAction;
 		}
 		actions[currentAction].mayCoalesce = false;
+		DropOldestActions();
 	}
 }
 
@@ -271,6 +421,19 @@ void UndoHistory::DeleteUndoHistory() {
 	savePoint = 0;
 }
 
+void UndoHistory::SetMemoryLimit(int bytes) {
+	memoryLimit = bytes;
+	DropOldestActions();
+}
+
+int UndoHistory::GetMemoryLimit() const {
+	return memoryLimit;
+}
+
+int UndoHistory::MemoryUsed() const {
+	return arena.Allocated() + (maxAction + 1) * static_cast<int>(sizeof(Action));
+}
+
 void UndoHistory::SetSavePoint() {
 	savePoint = currentAction;
 }
@@ -329,12 +492,241 @@ void UndoHistory::CompletedRedoStep() {
 	currentAction++;
 }
 
+CellVector::CellVector() : gap(new SplitVector<char>()), chunked(0) {
+}
+
+CellVector::~CellVector() {
+	delete gap;
+	gap = 0;
+	delete chunked;
+	chunked = 0;
+}
+
+char CellVector::ChunkedValueAt(int position) const {
+	return chunked->ValueAt(position);
+}
+
+int CellVector::ChunkedLength() const {
+	return chunked->Length();
+}
+
+void CellVector::SetChunked(bool chunked_) {
+	if (chunked_ && !chunked) {
+		chunked = new ChunkedVector<char>();
+		const int length = gap->Length();
+		if (length > 0)
+			chunked->InsertFromArray(0, gap->RangePointer(0, length), 0, length);
+		delete gap;
+		gap = 0;
+	} else if (!chunked_ && chunked) {
+		gap = new SplitVector<char>();
+		gap->ReAllocate(chunked->Length() + 1);
+		for (int i = 0; i < chunked->Chunks(); i++) {
+			const ElementChunk<char> *chunk = chunked->ChunkAt(i);
+			gap->InsertFromArray(gap->Length(), chunk->data, 0, chunk->length);
+		}
+		delete chunked;
+		chunked = 0;
+	}
+}
+
+void CellVector::SetValueAt(int position, char v) {
+	if (chunked)
+		chunked->SetValueAt(position, v);
+	else
+		gap->SetValueAt(position, v);
+}
+
+void CellVector::InsertFromArray(int positionToInsert, const char s[], int positionFrom, int insertLength) {
+	if (chunked)
+		chunked->InsertFromArray(positionToInsert, s, positionFrom, insertLength);
+	else
+		gap->InsertFromArray(positionToInsert, s, positionFrom, insertLength);
+}
+
+void CellVector::InsertValue(int position, int insertLength, char v) {
+	if (chunked)
+		chunked->InsertValue(position, insertLength, v);
+	else
+		gap->InsertValue(position, insertLength, v);
+}
+
+void CellVector::DeleteRange(int position, int deleteLength) {
+	if (chunked)
+		chunked->DeleteRange(position, deleteLength);
+	else
+		gap->DeleteRange(position, deleteLength);
+}
+
+void CellVector::GetRange(char *buffer, int position, int retrieveLength) const {
+	if (chunked)
+		chunked->GetRange(buffer, position, retrieveLength);
+	else
+		gap->GetRange(buffer, position, retrieveLength);
+}
+
+char *CellVector::BufferPointer() {
+	return chunked ? chunked->BufferPointer() : gap->BufferPointer();
+}
+
+char *CellVector::RangePointer(int position, int rangeLength) {
+	return chunked ? chunked->RangePointer(position, rangeLength) : gap->RangePointer(position, rangeLength);
+}
+
+// Chunks have no single position to avoid, so report the end
+int CellVector::GapPosition() const {
+	return chunked ? chunked->Length() : gap->GapPosition();
+}
+
+void CellVector::ReAllocate(int newSize) {
+	if (!chunked)
+		gap->ReAllocate(newSize);
+}
+
+ChangeLog::ChangeLog() : changes(0), start(0), count(0), revision(0) {
+}
+
+ChangeLog::~ChangeLog() {
+	delete []changes;
+	changes = 0;
+}
+
+void ChangeLog::Add(int position, int lengthChange) {
+	if (!changes)
+		changes = new Change[maxChanges];
+	int index;
+	if (count < maxChanges) {
+		index = (start + count) % maxChanges;
+		count++;
+	} else {
+		// Forget the oldest change
+		index = start;
+		start = (start + 1) % maxChanges;
+	}
+	changes[index].position = position;
+	changes[index].lengthChange = lengthChange;
+	revision++;
+}
+
+static long MovePosition(long pos, int position, int lengthInserted, int lengthDeleted) {
+	if (pos < position)
+		return pos;
+	else if (pos < position + lengthDeleted)
+		return position;
+	else
+		return pos - lengthDeleted + lengthInserted;
+}
+
+int ChangeLog::ChangedRanges(int sinceRevision, Sci_CharacterRange *ranges) const {
+	const int changesSince = revision - sinceRevision;
+	if ((changesSince < 0) || (changesSince > count))
+		return -1;
+	std::vector<Sci_CharacterRange> changed;
+	std::vector<Sci_CharacterRange> merged;
+	for (int i = count - changesSince; i < count; i++) {
+		const Change &change = changes[(start + i) % maxChanges];
+		const int lengthInserted = (change.lengthChange > 0) ? change.lengthChange : 0;
+		const int lengthDeleted = (change.lengthChange < 0) ? -change.lengthChange : 0;
+		Sci_CharacterRange range = { change.position, change.position + lengthInserted };
+		// Earlier ranges move with the text around them, staying in order
+		size_t insertBefore = changed.size();
+		for (size_t r = 0; r < changed.size(); r++) {
+			changed[r].cpMin = MovePosition(changed[r].cpMin,
+				change.position, lengthInserted, lengthDeleted);
+			changed[r].cpMax = MovePosition(changed[r].cpMax,
+				change.position, lengthInserted, lengthDeleted);
+			if ((insertBefore == changed.size()) && (changed[r].cpMin > range.cpMin))
+				insertBefore = r;
+		}
+		changed.insert(changed.begin() + insertBefore, range);
+		merged.clear();
+		for (size_t r = 0; r < changed.size(); r++) {
+			if (!merged.empty() && (changed[r].cpMin <= merged.back().cpMax)) {
+				if (changed[r].cpMax > merged.back().cpMax)
+					merged.back().cpMax = changed[r].cpMax;
+			} else {
+				merged.push_back(changed[r]);
+			}
+		}
+		changed.swap(merged);
+	}
+	if (ranges) {
+		for (size_t r = 0; r < changed.size(); r++)
+			ranges[r] = changed[r];
+	}
+	return static_cast<int>(changed.size());
+}
+
+Snapshot::Snapshot(const CellVector &substance, int revision_) : references(0), chunks(0) {
+	const ChunkedVector<char> *chunked = substance.Chunked();
+	Sci_TextPiece *textPieces;
+	length = substance.Length();
+	revision = revision_;
+	if (chunked) {
+		// Share the chunks, which the buffer copies before modifying them
+		text = 0;
+		pieceCount = chunked->Chunks();
+		textPieces = new Sci_TextPiece[pieceCount];
+		chunks = new ElementChunk<char> *[pieceCount];
+		for (int i = 0; i < pieceCount; i++) {
+			chunks[i] = chunked->ChunkAt(i);
+			chunks[i]->AddRef();
+			textPieces[i].text = chunks[i]->data;
+			textPieces[i].length = chunks[i]->length;
+		}
+	} else {
+		char *data = new char[length + 1];
+		if (length > 0)
+			substance.GetRange(data, 0, length);
+		data[length] = '\0';
+		text = data;
+		pieceCount = 1;
+		textPieces = new Sci_TextPiece[1];
+		textPieces[0].text = text;
+		textPieces[0].length = length;
+	}
+	pieces = textPieces;
+}
+
+Snapshot::~Snapshot() {
+	if (chunks) {
+		for (int i = 0; i < pieceCount; i++)
+			chunks[i]->Release();
+		delete []chunks;
+		chunks = 0;
+	}
+	delete []pieces;
+	pieces = 0;
+	delete []text;
+	text = 0;
+}
+
+void Snapshot::AddRef() {
+	references++;
+}
+
+void Snapshot::Release() {
+	references--;
+	if (references == 0)
+		delete this;
+}
+
 CellBuffer::CellBuffer() {
 	readOnly = false;
 	collectingUndo = true;
+	snapshot = 0;
 }
 
 CellBuffer::~CellBuffer() {
+	DropSnapshot();
+}
+
+void CellBuffer::DropSnapshot() {
+	if (snapshot) {
+		// Holders of references keep it alive
+		snapshot->Release();
+		snapshot = 0;
+	}
 }
 
 char CellBuffer::CharAt(int position) const {
@@ -383,19 +775,42 @@ int CellBuffer::GapPosition() const {
 	return substance.GapPosition();
 }
 
+void CellBuffer::SetChunked(bool chunked) {
+	substance.SetChunked(chunked);
+	style.SetChunked(chunked);
+}
+
+bool CellBuffer::IsChunked() const {
+	return substance.Chunked() != 0;
+}
+
+int CellBuffer::Revision() const {
+	return changeLog.Revision();
+}
+
+// Copies the text once for each revision a snapshot is requested at, without moving the gap,
+// or shares the chunks the text is stored in
+Snapshot *CellBuffer::CreateSnapshot() {
+	if (!snapshot) {
+		snapshot = new Snapshot(substance, changeLog.Revision());
+		snapshot->AddRef();
+	}
+	snapshot->AddRef();
+	return snapshot;
+}
+
+int CellBuffer::ChangedRanges(int sinceRevision, Sci_CharacterRange *ranges) const {
+	return changeLog.ChangedRanges(sinceRevision, ranges);
+}
+
 // The char* returned is to an allocation owned by the undo history
 const char *CellBuffer::InsertString(int position, const char *s, int insertLength, bool &startSequence) {
-	char *data = 0;
+	const char *data = 0;
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	if (!readOnly) {
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
-			// This takes up about half load time
-			data = new char[insertLength];
-			for (int i = 0; i < insertLength; i++) {
-				data[i] = s[i];
-			}
-			uh.AppendAction(insertAction, position, data, insertLength, startSequence);
+			data = uh.AppendAction(insertAction, position, s, insertLength, startSequence);
 		}
 
 		BasicInsertString(position, s, insertLength);
@@ -433,15 +848,12 @@ bool CellBuffer::SetStyleFor(int position, int lengthStyle, char styleValue, cha
 const char *CellBuffer::DeleteChars(int position, int deleteLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	PLATFORM_ASSERT(deleteLength > 0);
-	char *data = 0;
+	const char *data = 0;
 	if (!readOnly) {
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
-			data = new char[deleteLength];
-			for (int i = 0; i < deleteLength; i++) {
-				data[i] = substance.ValueAt(position + i);
-			}
-			uh.AppendAction(removeAction, position, data, deleteLength, startSequence);
+			data = uh.AppendAction(removeAction, position,
+				substance.RangePointer(position, deleteLength), deleteLength, startSequence);
 		}
 
 		BasicDeleteChars(position, deleteLength);
@@ -506,6 +918,8 @@ void CellBuffer::BasicInsertString(int position, const char *s, int insertLength
 		return;
 	PLATFORM_ASSERT(insertLength > 0);
 
+	DropSnapshot();
+	changeLog.Add(position, insertLength);
 	substance.InsertFromArray(position, s, 0, insertLength);
 	style.InsertValue(position, insertLength, 0);
 
@@ -550,6 +964,8 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 	if (deleteLength == 0)
 		return;
 
+	DropSnapshot();
+	changeLog.Add(position, -deleteLength);
 	if ((position == 0) && (deleteLength == substance.Length())) {
 		// If whole buffer is being deleted, faster to reinitialise lines data
 		// than to delete each line.
@@ -628,6 +1044,18 @@ void CellBuffer::DeleteUndoHistory() {
 	uh.DeleteUndoHistory();
 }
 
+void CellBuffer::SetUndoMemoryLimit(int bytes) {
+	uh.SetMemoryLimit(bytes);
+}
+
+int CellBuffer::GetUndoMemoryLimit() const {
+	return uh.GetMemoryLimit();
+}
+
+int CellBuffer::UndoMemoryUsed() const {
+	return uh.MemoryUsed();
+}
+
 bool CellBuffer::CanUndo() {
 	return uh.CanUndo();
 }
@@ -8,6 +8,10 @@
 #ifndef CELLBUFFER_H
 #define CELLBUFFER_H
 
+// Outside the namespace like SplitVector, see ChunkedVector.h
+template <typename T> class ElementChunk;
+template <typename T> class ChunkedVector;
+
 #ifdef SCI_NAMESPACE
 namespace Scintilla {
 #endif
@@ -67,6 +71,46 @@ public:
 
 enum actionType { insertAction, removeAction, startAction, containerAction };
 
+class UndoArena;
+
+/**
+ * A block of undo text. Blocks are filled in order and freed when no action refers to them.
+ */
+class UndoBlock {
+public:
+	UndoArena *arena;
+	char *data;
+	int size;
+	int used;
+	int references;
+
+	UndoBlock(UndoArena *arena_, int size_);
+	~UndoBlock();
+	void Release();
+};
+
+/**
+ * Append-only storage for the text of undo actions so that each action does not need
+ * its own allocation.
+ */
+class UndoArena {
+	UndoBlock *tail;
+	int allocated;
+
+public:
+	enum { blockSize = 0x10000 };
+
+	UndoArena();
+	~UndoArena();
+
+	/// Copy text into the arena, referencing the block it was stored in.
+	char *Append(const char *s, int length, UndoBlock *&block);
+	/// Extend the text of an action ending at the end of the arena if there is room.
+	bool Extend(UndoBlock *block, const char *data, int lenData, const char *s, int length);
+	void BlockUnused(UndoBlock *block);
+	int Allocated() const;
+};
+
 /**
  * Actions are used to store all the information required to perform one undo/redo step.
  */
@@ -77,10 +121,11 @@ public:
 	char *data;
 	int lenData;
 	bool mayCoalesce;
+	UndoBlock *block;
 
 	Action();
 	~Action();
-	void Create(actionType at_, int position_=0, char *data_=0, int lenData_=0, bool mayCoalesce_=true);
+	void Create(actionType at_, int position_=0, char *data_=0, int lenData_=0, bool mayCoalesce_=true, UndoBlock *block_=0);
 	void Destroy();
 	void Grab(Action *source);
 };
@@ -95,20 +140,30 @@ class UndoHistory {
 	int currentAction;
 	int undoSequenceDepth;
 	int savePoint;
+	UndoArena arena;
+	int memoryLimit;
 
 	void EnsureUndoRoom();
+	void DropRedo();
+	void DropOldestActions();
 
 public:
 	UndoHistory();
 	~UndoHistory();
 
-	void AppendAction(actionType at, int position, char *data, int length, bool &startSequence, bool mayCoalesce=true);
+	const char *AppendAction(actionType at, int position, const char *data, int length, bool &startSequence, bool mayCoalesce=true);
 
 	void BeginUndoAction();
 	void EndUndoAction();
 	void DropUndoSequence();
 	void DeleteUndoHistory();
 
+	/// When the memory used exceeds the limit, the oldest user operations are forgotten.
+	/// A limit of 0 allows unbounded memory use.
+	void SetMemoryLimit(int bytes);
+	int GetMemoryLimit() const;
+	int MemoryUsed() const;
+
 	/// The save point is a marker in the undo stack where the container has stated that
 	/// the buffer was saved. Undo and redo can move over the save point.
 	void SetSavePoint();
@@ -126,6 +181,98 @@ public:
 	void CompletedRedoStep();
 };
 
+/**
+ * The characters or styles of a buffer, in a gap buffer or for large documents
+ * in chunks, which are cheap to modify anywhere and to share with snapshots.
+ */
+class CellVector {
+	SplitVector<char> *gap;
+	ChunkedVector<char> *chunked;
+
+	char ChunkedValueAt(int position) const;
+	int ChunkedLength() const;
+
+	// Private so CellVector objects can not be copied
+	CellVector(const CellVector &);
+
+public:
+	CellVector();
+	~CellVector();
+
+	/// Move the elements to chunks or back to a gap buffer.
+	void SetChunked(bool chunked_);
+	const ChunkedVector<char> *Chunked() const {
+		return chunked;
+	}
+
+	char ValueAt(int position) const {
+		return chunked ? ChunkedValueAt(position) : gap->ValueAt(position);
+	}
+	int Length() const {
+		return chunked ? ChunkedLength() : gap->Length();
+	}
+	void SetValueAt(int position, char v);
+	void InsertFromArray(int positionToInsert, const char s[], int positionFrom, int insertLength);
+	void InsertValue(int position, int insertLength, char v);
+	void DeleteRange(int position, int deleteLength);
+	void GetRange(char *buffer, int position, int retrieveLength) const;
+	char *BufferPointer();
+	char *RangePointer(int position, int rangeLength);
+	int GapPosition() const;
+	void ReAllocate(int newSize);
+};
+
+/**
+ * The most recent insertions and deletions, so the text changed since a revision
+ * can be found without comparing it.
+ */
+class ChangeLog {
+	/// Change made by revision: an insertion for positive lengthChange, a deletion otherwise
+	struct Change {
+		int position;
+		int lengthChange;
+	};
+	Change *changes;	///< Circular buffer of the latest count changes
+	int start;
+	int count;
+	int revision;
+
+	// Private so ChangeLog objects can not be copied
+	ChangeLog(const ChangeLog &);
+
+public:
+	enum { maxChanges = 0x1000 };
+
+	ChangeLog();
+	~ChangeLog();
+
+	void Add(int position, int lengthChange);
+	int Revision() const {
+		return revision;
+	}
+	/// Fill ranges, if not null, with the ranges changed since sinceRevision.
+	/// @return the number of ranges or -1 if the changes are no longer known.
+	int ChangedRanges(int sinceRevision, Sci_CharacterRange *ranges) const;
+};
+
+/**
+ * The text of a buffer at one revision. The text never changes so it can be read from
+ * any thread, but references are only added and released on the thread owning the buffer.
+ */
+class Snapshot : public Sci_Snapshot {
+	int references;
+	ElementChunk<char> **chunks;	///< Shared with the buffer when stored in chunks
+
+	// Private so Snapshot objects can not be copied
+	Snapshot(const Snapshot &);
+
+public:
+	Snapshot(const CellVector &substance, int revision_);
+	~Snapshot();
+	void AddRef();
+	void Release();
+};
+
 /**
  * Holder for an expandable array of characters that supports undo and line markers.
  * Based on article "Data Structures in a Bit-Mapped Text Editor"
@@ -133,8 +280,8 @@ public:
  */
 class CellBuffer {
 private:
-	SplitVector<char> substance;
-	SplitVector<char> style;
+	CellVector substance;
+	CellVector style;
 	bool readOnly;
 
 	bool collectingUndo;
@@ -142,6 +289,11 @@ private:
 
 	LineVector lv;
 
+	ChangeLog changeLog;
+	Snapshot *snapshot;	///< Snapshot of the current revision, if one was requested
+
+	void DropSnapshot();
+
 	/// Actions without undo
 	void BasicInsertString(int position, const char *s, int insertLength);
 	void BasicDeleteChars(int position, int deleteLength);
@@ -159,6 +311,14 @@ public:
 	const char *BufferPointer();
 	const char *RangePointer(int position, int rangeLength);
 	int GapPosition() const;
+	/// Store the text in chunks for large documents, or in a gap buffer.
+	void SetChunked(bool chunked);
+	bool IsChunked() const;
+
+	int Revision() const;
+	/// Reference to a snapshot of the current text, which the caller releases.
+	Snapshot *CreateSnapshot();
+	int ChangedRanges(int sinceRevision, Sci_CharacterRange *ranges) const;
 
 	int Length() const;
 	void Allocate(int newSize);
@@ -191,6 +351,9 @@ public:
 	void EndUndoAction();
 	void AddUndoAction(int token, bool mayCoalesce);
 	void DeleteUndoHistory();
+	void SetUndoMemoryLimit(int bytes);
+	int GetUndoMemoryLimit() const;
+	int UndoMemoryUsed() const;
 
 	/// To perform an undo, StartUndo is called to retrieve the number of steps, then UndoStep is
 	/// called that many times. Similarly for redo.
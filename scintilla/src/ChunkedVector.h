@@ -0,0 +1,364 @@
+// Scintilla source code edit control
+/** @file ChunkedVector.h
+ ** Data structure for holding large arrays that handle insertions and deletions
+ ** anywhere without moving the whole array and that can be shared cheaply.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef CHUNKEDVECTOR_H
+#define CHUNKEDVECTOR_H
+
+/// Elements of a ChunkedVector stored together, reference counted so they can be shared.
+template <typename T>
+class ElementChunk {
+	// Private so ElementChunk objects can not be copied
+	ElementChunk(const ElementChunk &);
+public:
+	enum { maxLength = 0x10000 };
+
+	T *data;
+	int length;
+	int size;
+	int references;
+
+	ElementChunk() : data(0), length(0), size(0), references(1) {
+	}
+	~ElementChunk() {
+		delete []data;
+		data = 0;
+	}
+	void AddRef() {
+		references++;
+	}
+	void Release() {
+		references--;
+		if (references == 0)
+			delete this;
+	}
+	void RoomFor(int insertLength) {
+		if (length + insertLength > size) {
+			int newSize = size * 2;
+			if (newSize < length + insertLength)
+				newSize = length + insertLength;
+			if (newSize > maxLength)
+				newSize = (length + insertLength > maxLength) ? length + insertLength : maxLength;
+			T *newData = new T[newSize];
+			if (length > 0)
+				memcpy(newData, data, sizeof(T) * length);
+			delete []data;
+			data = newData;
+			size = newSize;
+		}
+	}
+	void Insert(int offset, const T *s, int insertLength) {
+		RoomFor(insertLength);
+		memmove(data + offset + insertLength, data + offset, sizeof(T) * (length - offset));
+		memcpy(data + offset, s, sizeof(T) * insertLength);
+		length += insertLength;
+	}
+	void Delete(int offset, int deleteLength) {
+		memmove(data + offset, data + offset + deleteLength,
+			sizeof(T) * (length - offset - deleteLength));
+		length -= deleteLength;
+	}
+};
+
+/// Elements stored as a sequence of chunks of up to maxChunkLength elements.
+/// Finding the chunk of a position is a binary search over the chunk start positions,
+/// and an insertion or deletion only moves elements inside the chunks it touches.
+/// Chunks are reference counted so a copy of the sequence can keep using them; a chunk
+/// referenced elsewhere is copied before it is modified.
+/// Needs SplitVector.h and Partitioning.h.
+template <typename T>
+class ChunkedVector {
+public:
+	typedef ElementChunk<T> Chunk;
+	enum { maxChunkLength = Chunk::maxLength };
+
+private:
+	SplitVector<Chunk *> chunks;	///< Always at least one chunk, only empty when it is the only one
+	Partitioning starts;	///< Partition n is chunk n
+	T *flat;	///< Contiguous copy of all the elements returned by BufferPointer
+	T *rangeCopy;	///< Contiguous copy returned by RangePointer across chunks
+	int sizeRangeCopy;
+	// Chunk of the last access, as consecutive accesses are usually close to each other
+	mutable int cacheChunk;
+	mutable int cacheStart;
+	mutable int cacheEnd;
+
+	// Private so ChunkedVector objects can not be copied
+	ChunkedVector(const ChunkedVector &);
+
+	void InvalidateCache() {
+		cacheStart = 0;
+		cacheEnd = 0;
+	}
+
+	/// Free the contiguous copies, which are only valid until a modification.
+	void ReleaseCopies() {
+		if (flat) {
+			delete []flat;
+			flat = 0;
+		}
+		if (rangeCopy) {
+			delete []rangeCopy;
+			rangeCopy = 0;
+			sizeRangeCopy = 0;
+		}
+	}
+
+	int ChunkFromPosition(int position) const {
+		if ((position < cacheStart) || (position >= cacheEnd)) {
+			cacheChunk = starts.PartitionFromPosition(position);
+			cacheStart = starts.PositionFromPartition(cacheChunk);
+			cacheEnd = starts.PositionFromPartition(cacheChunk + 1);
+		}
+		return cacheChunk;
+	}
+
+	/// The chunk to modify, copied first if it is shared.
+	Chunk *WritableChunk(int chunk) {
+		Chunk *c = chunks.ValueAt(chunk);
+		if (c->references > 1) {
+			Chunk *copy = new Chunk();
+			copy->Insert(0, c->data, c->length);
+			c->Release();
+			chunks.SetValueAt(chunk, copy);
+			c = copy;
+		}
+		return c;
+	}
+
+	/// Append elements after the chunk ending at position, adding chunks when it is full.
+	void AppendToChunks(int &chunk, int &position, const T *s, int appendLength) {
+		while (appendLength > 0) {
+			Chunk *c = chunks.ValueAt(chunk);
+			if (c->length >= maxChunkLength) {
+				chunk++;
+				chunks.Insert(chunk, new Chunk());
+				starts.InsertPartition(chunk, position);
+				continue;
+			}
+			int lengthAppend = maxChunkLength - c->length;
+			if (lengthAppend > appendLength)
+				lengthAppend = appendLength;
+			c->Insert(c->length, s, lengthAppend);
+			s += lengthAppend;
+			appendLength -= lengthAppend;
+			position += lengthAppend;
+		}
+	}
+
+	void RemoveChunk(int chunk) {
+		chunks.ValueAt(chunk)->Release();
+		chunks.Delete(chunk);
+		// Partition 0 always starts at 0, remove the start of the following chunk instead
+		// which is the same position when the first chunk is removed
+		starts.RemovePartition((chunk == 0) ? 1 : chunk);
+	}
+
+	/// Merge a small chunk into the next so deletions do not leave many small chunks.
+	void MergeChunk(int chunk) {
+		Chunk *c = chunks.ValueAt(chunk);
+		if (c->length == 0) {
+			if (chunks.Length() > 1)
+				RemoveChunk(chunk);
+		} else if ((c->length < maxChunkLength / 4) && (chunk + 1 < chunks.Length())) {
+			Chunk *next = chunks.ValueAt(chunk + 1);
+			if (c->length + next->length <= maxChunkLength) {
+				c = WritableChunk(chunk);
+				c->Insert(c->length, next->data, next->length);
+				next->Release();
+				chunks.Delete(chunk + 1);
+				starts.RemovePartition(chunk + 1);
+			}
+		}
+	}
+
+	void Init() {
+		chunks.Insert(0, new Chunk());
+		InvalidateCache();
+	}
+
+public:
+	ChunkedVector() : starts(256), flat(0), rangeCopy(0), sizeRangeCopy(0),
+		cacheChunk(0), cacheStart(0), cacheEnd(0) {
+		chunks.SetGrowSize(256);
+		Init();
+	}
+
+	~ChunkedVector() {
+		for (int i = 0; i < chunks.Length(); i++)
+			chunks.ValueAt(i)->Release();
+		ReleaseCopies();
+	}
+
+	int Length() const {
+		return starts.PositionFromPartition(starts.Partitions());
+	}
+
+	int Chunks() const {
+		return chunks.Length();
+	}
+
+	/// Retrieve a chunk to share it, adding a reference to keep it unchanged.
+	Chunk *ChunkAt(int chunk) const {
+		return chunks.ValueAt(chunk);
+	}
+
+	/// Retrieving positions outside the range of the buffer returns 0.
+	T ValueAt(int position) const {
+		if ((position < 0) || (position >= Length()))
+			return 0;
+		int chunk = ChunkFromPosition(position);
+		return chunks.ValueAt(chunk)->data[position - cacheStart];
+	}
+
+	/// Setting positions outside the range of the buffer is safe and has no effect.
+	void SetValueAt(int position, T v) {
+		if ((position < 0) || (position >= Length()))
+			return;
+		ReleaseCopies();
+		int chunk = ChunkFromPosition(position);
+		WritableChunk(chunk)->data[position - cacheStart] = v;
+	}
+
+	void InsertFromArray(int positionToInsert, const T s[], int positionFrom, int insertLength) {
+		PLATFORM_ASSERT((positionToInsert >= 0) && (positionToInsert <= Length()));
+		if (insertLength <= 0)
+			return;
+		InvalidateCache();
+		ReleaseCopies();
+		int chunk = starts.PartitionFromPosition(positionToInsert);
+		int offset = positionToInsert - starts.PositionFromPartition(chunk);
+		Chunk *c = WritableChunk(chunk);
+		starts.InsertText(chunk, insertLength);
+		if (c->length + insertLength <= maxChunkLength) {
+			c->Insert(offset, s + positionFrom, insertLength);
+		} else {
+			// Continue the chunk with the new elements then the elements after them
+			int lengthTail = c->length - offset;
+			T *tail = new T[lengthTail + 1];
+			if (lengthTail > 0)
+				memcpy(tail, c->data + offset, sizeof(T) * lengthTail);
+			c->length = offset;
+			int position = positionToInsert;
+			AppendToChunks(chunk, position, s + positionFrom, insertLength);
+			AppendToChunks(chunk, position, tail, lengthTail);
+			delete []tail;
+		}
+	}
+
+	void InsertValue(int position, int insertLength, T v) {
+		if (insertLength <= 0)
+			return;
+		int lengthValues = (insertLength < maxChunkLength) ? insertLength : maxChunkLength;
+		T *values = new T[lengthValues];
+		for (int i = 0; i < lengthValues; i++)
+			values[i] = v;
+		while (insertLength > 0) {
+			int lengthInsert = (insertLength < lengthValues) ? insertLength : lengthValues;
+			InsertFromArray(position, values, 0, lengthInsert);
+			position += lengthInsert;
+			insertLength -= lengthInsert;
+		}
+		delete []values;
+	}
+
+	void DeleteRange(int position, int deleteLength) {
+		PLATFORM_ASSERT((position >= 0) && (position + deleteLength <= Length()));
+		if ((position < 0) || ((position + deleteLength) > Length()))
+			return;
+		InvalidateCache();
+		ReleaseCopies();
+		if ((position == 0) && (deleteLength == Length())) {
+			DeleteAll();
+			return;
+		}
+		int chunk = starts.PartitionFromPosition(position);
+		while (deleteLength > 0) {
+			int offset = position - starts.PositionFromPartition(chunk);
+			Chunk *c = chunks.ValueAt(chunk);
+			int lengthDelete = c->length - offset;
+			if (lengthDelete > deleteLength)
+				lengthDelete = deleteLength;
+			if (lengthDelete == c->length) {
+				// Whole chunk deleted so no need to copy it if it is shared
+				starts.InsertText(chunk, -lengthDelete);
+				RemoveChunk(chunk);
+			} else {
+				WritableChunk(chunk)->Delete(offset, lengthDelete);
+				starts.InsertText(chunk, -lengthDelete);
+				chunk++;
+			}
+			deleteLength -= lengthDelete;
+		}
+		// The chunks before and after the deletion may now be small
+		chunk = starts.PartitionFromPosition(position);
+		MergeChunk(chunk);
+		if (chunk > 0)
+			MergeChunk(chunk - 1);
+	}
+
+	void DeleteAll() {
+		for (int i = 0; i < chunks.Length(); i++)
+			chunks.ValueAt(i)->Release();
+		chunks.DeleteAll();
+		starts.DeleteAll();
+		ReleaseCopies();
+		Init();
+	}
+
+	/// Retrieve a range of elements into an array
+	void GetRange(T *buffer, int position, int retrieveLength) const {
+		if (retrieveLength <= 0)
+			return;
+		int chunk = starts.PartitionFromPosition(position);
+		int offset = position - starts.PositionFromPartition(chunk);
+		while ((retrieveLength > 0) && (chunk < chunks.Length())) {
+			const Chunk *c = chunks.ValueAt(chunk);
+			int lengthCopy = c->length - offset;
+			if (lengthCopy > retrieveLength)
+				lengthCopy = retrieveLength;
+			memcpy(buffer, c->data + offset, sizeof(T) * lengthCopy);
+			buffer += lengthCopy;
+			retrieveLength -= lengthCopy;
+			offset = 0;
+			chunk++;
+		}
+	}
+
+	/// Return a pointer to a range of elements, valid until the next modification or call.
+	/// A range inside one chunk is not copied, nor one inside the copy of BufferPointer.
+	T *RangePointer(int position, int rangeLength) {
+		if (rangeLength > 0) {
+			int chunk = ChunkFromPosition(position);
+			if (position + rangeLength <= cacheEnd)
+				return chunks.ValueAt(chunk)->data + position - cacheStart;
+		}
+		if (flat)
+			return flat + position;
+		if (sizeRangeCopy <= rangeLength) {
+			delete []rangeCopy;
+			sizeRangeCopy = rangeLength + 1;
+			rangeCopy = new T[sizeRangeCopy];
+		}
+		GetRange(rangeCopy, position, rangeLength);
+		rangeCopy[rangeLength] = 0;
+		return rangeCopy;
+	}
+
+	/// Contiguous copy of all the elements, terminated by a 0 element. It is made once
+	/// and kept until the next modification so repeated calls are cheap.
+	T *BufferPointer() {
+		if (!flat) {
+			int length = Length();
+			flat = new T[length + 1];
+			GetRange(flat, 0, length);
+			flat[length] = 0;
+		}
+		return flat;
+	}
+};
+
+#endif
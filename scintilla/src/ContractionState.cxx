@@ -249,6 +249,43 @@ bool ContractionState::SetHeight(int lineDoc, int height) {
 	}
 }
 
+static void FillRuns(RunStyles *rs, const char *values, int length) {
+	rs->DeleteAll();
+	rs->InsertSpace(0, length);
+	for (int start = 0; start < length;) {
+		int end = start + 1;
+		while ((end < length) && (values[end] == values[start]))
+			end++;
+		if (values[start]) {
+			int position = start;
+			int fillLength = end - start;
+			rs->FillRange(position, 1, fillLength);
+		}
+		start = end;
+	}
+}
+
+// Replace the visibility and expansion of all lines, with one element per document line,
+// and rebuild the display lines in a single pass.
+void ContractionState::SetFolding(const char *visible_, const char *expanded_) {
+	const int lines = LinesInDoc();
+	EnsureData();
+	FillRuns(visible, visible_, lines);
+	FillRuns(expanded, expanded_, lines);
+	delete displayLines;
+	displayLines = new Partitioning(4);
+	int lineDisplay = 0;
+	for (int line = 0; line < lines; line++) {
+		displayLines->InsertPartition(line, lineDisplay);
+		if (visible_[line]) {
+			const int height = heights->ValueAt(line);
+			displayLines->InsertText(line, height);
+			lineDisplay += height;
+		}
+	}
+	Check();
+}
+
 void ContractionState::ShowAll() {
 	int lines = LinesInDoc();
 	Clear();
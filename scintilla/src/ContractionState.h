@@ -57,6 +57,7 @@ public:
 	int GetHeight(int lineDoc) const;
 	bool SetHeight(int lineDoc, int height);
 
+	void SetFolding(const char *visible_, const char *expanded_);
 	void ShowAll();
 	void Check() const;
 };
@@ -28,6 +28,7 @@
 #include "CharacterSet.h"
 #include "Decoration.h"
 #include "Document.h"
+#include "LexerCheckpoints.h"
 #include "RESearch.h"
 #include "UniConversion.h"
 
@@ -39,6 +40,16 @@ static inline bool IsPunctuation(char ch) {
 	return isascii(ch) && ispunct(ch);
 }
 
+LexInterface::LexInterface(Document *pdoc_) : pdoc(pdoc_), instance(0), performingStyle(false),
+	stateInDocument(false) {
+	checkpoints = new LexerCheckpoints();
+}
+
+LexInterface::~LexInterface() {
+	delete checkpoints;
+	checkpoints = 0;
+}
+
 void LexInterface::Colourise(int start, int end) {
 	if (pdoc && instance && !performingStyle) {
 		// Protect against reentrance, which may occur, for example, when
@@ -59,14 +70,71 @@ void LexInterface::Colourise(int start, int end) {
 			styleStart = pdoc->StyleAt(start - 1) & pdoc->stylingBitsMask;
 
 		if (len > 0) {
-			instance->Lex(start, len, styleStart, pdoc);
-			instance->Fold(start, len, styleStart, pdoc);
+			if (stateInDocument && checkpoints->Valid() && (end > checkpoints->From())) {
+				ColouriseCheckpointed(start, end, styleStart);
+			} else {
+				instance->Lex(start, len, styleStart, pdoc);
+				instance->Fold(start, len, styleStart, pdoc);
+			}
 		}
 
 		performingStyle = false;
 	}
 }
 
+static LexerCheckpoint CheckpointAt(Document *pdoc, int line) {
+	return LexerCheckpoint(pdoc->StyleAt(pdoc->LineStart(line) - 1) & pdoc->stylingBitsMask,
+		pdoc->GetLineState(line - 1), pdoc->GetLevel(line - 1));
+}
+
+// Lex in steps between checkpoint lines. When the state at a checkpoint inside the text
+// still styled from the previous pass is the same after lexing as it was before, the rest
+// of that text would be styled the same again so lexing can jump to its end.
+void LexInterface::ColouriseCheckpointed(int start, int end, int styleStart) {
+	int pos = start;
+	while (pos < end) {
+		int lineNext = pdoc->LineFromPosition(pos) + 1;
+		bool checkable = checkpoints->Valid();
+		if (checkable) {
+			const int lineFrom = pdoc->LineFromPosition(checkpoints->From());
+			if (lineNext <= lineFrom + 1)
+				lineNext = lineFrom + 2;
+			lineNext = ((lineNext + LexerCheckpoints::linesBetween - 1) /
+				LexerCheckpoints::linesBetween) * LexerCheckpoints::linesBetween;
+			checkable = pdoc->LineStart(lineNext) < checkpoints->To();
+		}
+		const int posNext = checkable ? Platform::Minimum(pdoc->LineStart(lineNext), end) : end;
+		const LexerCheckpoint before = checkable ? CheckpointAt(pdoc, lineNext) : LexerCheckpoint();
+		instance->Lex(pos, posNext - pos, styleStart, pdoc);
+		instance->Fold(pos, posNext - pos, styleStart, pdoc);
+		pos = posNext;
+		if (checkable && (pos == pdoc->LineStart(lineNext)) && (CheckpointAt(pdoc, lineNext) == before)) {
+			// Converged: text up to the end of the range is still correctly styled
+			pos = pdoc->LineStart(pdoc->LineFromPosition(checkpoints->To()));
+			const int endRestored = checkpoints->To();
+			checkpoints->Invalidate();
+			pdoc->StyledTo(endRestored);
+			if (pos >= end)
+				return;
+		} else if (checkpoints->Valid() && (pos >= checkpoints->To())) {
+			checkpoints->Invalidate();
+		}
+		if (pos > 0)
+			styleStart = pdoc->StyleAt(pos - 1) & pdoc->stylingBitsMask;
+	}
+}
+
+void LexInterface::TextChanged(int position, int lengthChange, int endStyled) {
+	if (stateInDocument) {
+		checkpoints->TextChanged(position, lengthChange, endStyled,
+			pdoc->LineStart(pdoc->LineFromPosition(position)));
+	}
+}
+
+void LexInterface::StylesInvalidated() {
+	checkpoints->Invalidate();
+}
+
 Document::Document() {
 	refCount = 0;
 	pcf = NULL;
@@ -103,6 +171,7 @@ Document::Document() {
 	perLineData[ldState] = new LineState();
 	perLineData[ldMargin] = new LineAnnotation();
 	perLineData[ldAnnotation] = new LineAnnotation();
+	perLineData[ldBraces] = new LineBraces();
 
 	cb.SetPerLine(this);
 
@@ -730,11 +799,37 @@ int Document::SafeSegment(const char *text, int length, int lengthSegment) {
 	return lastEncodingAllowedBreak;
 }
 
+// Styles after pos are no longer valid, for example as a keyword list changed
 void Document::ModifiedAt(int pos) {
+	if (pli)
+		pli->StylesInvalidated();
 	if (endStyled > pos)
 		endStyled = pos;
 }
 
+// Text after pos is known to still be styled correctly
+void Document::StyledTo(int pos) {
+	if (endStyled < pos)
+		endStyled = pos;
+}
+
+// Text was inserted (positive lengthChange) or deleted at position so styling is needed from posStyle.
+// Styles after the change remain valid if the lexer reaches the same state there.
+void Document::TextModifiedAt(int position, int lengthChange, int posStyle) {
+	if (pli)
+		pli->TextChanged(position, lengthChange, endStyled);
+	if (endStyled > posStyle)
+		endStyled = posStyle;
+	BracesChanged(position, position + ((lengthChange > 0) ? lengthChange : 0));
+}
+
+// Text or styles changed from startPos to endPos so the brace counts of those lines are stale.
+void Document::BracesChanged(int startPos, int endPos) {
+	const int lineFirst = LineFromPosition(startPos);
+	const int lineLast = LineFromPosition(endPos);
+	static_cast<LineBraces *>(perLineData[ldBraces])->Invalidate(lineFirst, lineLast);
+}
+
 void Document::CheckReadOnly() {
 	if (cb.IsReadOnly() && enteredReadOnlyCount == 0) {
 		enteredReadOnlyCount++;
@@ -769,9 +864,9 @@ bool Document::DeleteChars(int pos, int len) {
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(!startSavePoint);
 			if ((pos < Length()) || (pos == 0))
-				ModifiedAt(pos);
+				TextModifiedAt(pos, -len, pos);
 			else
-				ModifiedAt(pos-1);
+				TextModifiedAt(pos, -len, pos-1);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_DELETETEXT | SC_PERFORMED_USER | (startSequence?SC_STARTACTION:0),
@@ -807,7 +902,7 @@ bool Document::InsertString(int position, const char *s, int insertLength) {
 			const char *text = cb.InsertString(position, s, insertLength, startSequence);
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(!startSavePoint);
-			ModifiedAt(position);
+			TextModifiedAt(position, insertLength, position);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_INSERTTEXT | SC_PERFORMED_USER | (startSequence?SC_STARTACTION:0),
@@ -871,7 +966,9 @@ int Document::Undo() {
 				}
 				cb.PerformUndoStep();
 				if (action.at != containerAction) {
-					ModifiedAt(action.position);
+					// Undoing a removal inserts the text again
+					TextModifiedAt(action.position,
+						(action.at == removeAction) ? action.lenData : -action.lenData, action.position);
 					newPos = action.position;
 				}
 
@@ -945,7 +1042,8 @@ int Document::Redo() {
 				}
 				cb.PerformRedoStep();
 				if (action.at != containerAction) {
-					ModifiedAt(action.position);
+					TextModifiedAt(action.position,
+						(action.at == insertAction) ? action.lenData : -action.lenData, action.position);
 					newPos = action.position;
 				}
 
@@ -1662,6 +1760,7 @@ bool SCI_METHOD Document::SetStyleFor(int length, char style) {
 		style &= stylingMask;
 		int prevEndStyled = endStyled;
 		if (cb.SetStyleFor(endStyled, length, style, stylingMask)) {
+			BracesChanged(prevEndStyled, prevEndStyled + length);
 			DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
 			                   prevEndStyled, length);
 			NotifyModified(mh);
@@ -1691,6 +1790,7 @@ bool SCI_METHOD Document::SetStyles(int length, const char *styles) {
 			}
 		}
 		if (didChange) {
+			BracesChanged(startMod, endMod);
 			DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
 			                   startMod, endMod - startMod + 1);
 			NotifyModified(mh);
@@ -2037,19 +2137,71 @@ static char BraceOpposite(char ch) {
 	}
 }
 
-// TODO: should be able to extend styled region to find matching brace
-int Document::BraceMatch(int position, int /*maxReStyle*/) {
-	char chBrace = CharAt(position);
-	char chSeek = BraceOpposite(chBrace);
-	if (chSeek == '\0')
-		return - 1;
-	char styBrace = static_cast<char>(StyleAt(position) & stylingBitsMask);
-	int direction = -1;
-	if (chBrace == '(' || chBrace == '[' || chBrace == '{' || chBrace == '<')
-		direction = 1;
-	int depth = 1;
-	position = NextPosition(position, direction);
-	while ((position >= 0) && (position < Length())) {
+// Lines on each side of a brace searched for its match before using the brace index
+static const int braceScanLines = 64;
+
+static int BraceKind(char ch) {
+	switch (ch) {
+	case '(':
+	case ')':
+		return 0;
+	case '[':
+	case ']':
+		return 1;
+	case '{':
+	case '}':
+		return 2;
+	default:
+		return 3;
+	}
+}
+
+// The index of braces of the kind of chBrace with style styBrace.
+// Returns NULL when braces can not be counted byte by byte as with DBCS.
+BraceCounts *Document::BraceIndex(char chBrace, char styBrace) {
+	if (dbcsCodePage && (dbcsCodePage != SC_CP_UTF8))
+		return 0;
+	return static_cast<LineBraces *>(perLineData[ldBraces])->Index(BraceKind(chBrace),
+		static_cast<unsigned char>(styBrace), LinesTotal());
+}
+
+// Count the braces on the lines of the block containing line. Only the lines before
+// lineEnd are counted as the lines after do not have their final styles yet.
+void Document::CountBraces(BraceCounts *braces, int line, int lineEnd, char chBrace, char styBrace) {
+	const bool opening = (chBrace == '(' || chBrace == '[' || chBrace == '{' || chBrace == '<');
+	const char chOpen = opening ? chBrace : BraceOpposite(chBrace);
+	const char chClose = opening ? BraceOpposite(chBrace) : chBrace;
+	int lineFirst = 0;
+	int lineLast = 0;
+	braces->BlockLines(line, lineFirst, lineLast);
+	for (line = lineFirst; (line < lineLast) && (line < lineEnd); line++) {
+		if (!braces->Counted(line)) {
+			int closes = 0;
+			int opens = 0;
+			const int endLine = LineStart(line + 1);
+			for (int pos = LineStart(line); pos < endLine; pos++) {
+				const char ch = cb.CharAt(pos);
+				if (((ch == chOpen) || (ch == chClose)) &&
+					(static_cast<char>(cb.StyleAt(pos) & stylingBitsMask) == styBrace)) {
+					if (ch == chOpen)
+						opens++;
+					else if (opens > 0)
+						opens--;
+					else
+						closes++;
+				}
+			}
+			braces->SetCounts(line, closes, opens);
+		}
+	}
+	if (lineLast <= lineEnd)
+		braces->BlockCounted(lineFirst);
+}
+
+// Look for the brace bringing depth to 0 from position up to but not including limit.
+int Document::BraceScan(int position, int limit, int direction, char chBrace, char chSeek, char styBrace, int &depth) {
+	while ((position >= 0) && (position < Length()) &&
+		((direction > 0) ? (position < limit) : (position > limit))) {
 		char chAtPos = CharAt(position);
 		char styAtPos = static_cast<char>(StyleAt(position) & stylingBitsMask);
 		if ((position > GetEndStyled()) || (styAtPos == styBrace)) {
@@ -2068,6 +2220,71 @@ int Document::BraceMatch(int position, int /*maxReStyle*/) {
 	return - 1;
 }
 
+// TODO: should be able to extend styled region to find matching brace
+int Document::BraceMatch(int position, int /*maxReStyle*/) {
+	char chBrace = CharAt(position);
+	char chSeek = BraceOpposite(chBrace);
+	if (chSeek == '\0')
+		return - 1;
+	char styBrace = static_cast<char>(StyleAt(position) & stylingBitsMask);
+	int direction = -1;
+	if (chBrace == '(' || chBrace == '[' || chBrace == '{' || chBrace == '<')
+		direction = 1;
+	int depth = 1;
+	const int lineBrace = LineFromPosition(position);
+	position = NextPosition(position, direction);
+	BraceCounts *braces = BraceIndex(chBrace, styBrace);
+	if (!braces)
+		return BraceScan(position, (direction > 0) ? Length() : -1, direction, chBrace, chSeek, styBrace, depth);
+	// Matching braces are usually close so scan the lines near the brace. Further lines
+	// are counted into the index, only as far as the search goes, and indexed lines not
+	// containing the match are skipped over. Lines from the one containing endStyled
+	// do not have their final styles and are always scanned.
+	const int linesIndexed = LineFromPosition(GetEndStyled());
+	if (direction > 0) {
+		int line = Platform::Minimum(lineBrace + 1 + braceScanLines, LinesTotal());
+		int match = BraceScan(position, LineStart(line), direction, chBrace, chSeek, styBrace, depth);
+		if (match >= 0)
+			return match;
+		while (line < linesIndexed) {
+			const int lineMatch = braces->FindForward(line, linesIndexed, depth);
+			if (lineMatch < 0) {
+				line = linesIndexed;
+			} else if (braces->Counted(lineMatch)) {
+				return BraceScan(LineStart(lineMatch), LineStart(lineMatch + 1),
+					direction, chBrace, chSeek, styBrace, depth);
+			} else {
+				CountBraces(braces, lineMatch, linesIndexed, chBrace, styBrace);
+				line = lineMatch;
+			}
+		}
+		return BraceScan(LineStart(line), Length(), direction, chBrace, chSeek, styBrace, depth);
+	} else {
+		int line = Platform::Maximum(lineBrace - braceScanLines, 0);
+		int match = BraceScan(position, LineStart(line) - 1, direction, chBrace, chSeek, styBrace, depth);
+		if (match >= 0)
+			return match;
+		if (line > linesIndexed) {
+			match = BraceScan(LineStart(line) - 1, LineStart(linesIndexed) - 1,
+				direction, chBrace, chSeek, styBrace, depth);
+			if (match >= 0)
+				return match;
+			line = linesIndexed;
+		}
+		while (line > 0) {
+			const int lineMatch = braces->FindBackward(0, line, depth);
+			if (lineMatch < 0)
+				return - 1;
+			if (braces->Counted(lineMatch))
+				return BraceScan(LineStart(lineMatch + 1) - 1, LineStart(lineMatch) - 1,
+					direction, chBrace, chSeek, styBrace, depth);
+			CountBraces(braces, lineMatch, linesIndexed, chBrace, styBrace);
+			line = lineMatch + 1;
+		}
+		return - 1;
+	}
+}
+
 /**
  * Implementation of RegexSearchBase for the default built-in regular expression engine
  */
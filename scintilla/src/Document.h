@@ -175,20 +175,26 @@ public:
 
 class Document;
 
+class LexerCheckpoints;
+class BraceCounts;
+
 class LexInterface {
 protected:
 	Document *pdoc;
 	ILexer *instance;
 	bool performingStyle;	///< Prevent reentrance
+	bool stateInDocument;	///< Lexer keeps its whole state in the document so can use checkpoints
+	LexerCheckpoints *checkpoints;
+	void ColouriseCheckpointed(int start, int end, int styleStart);
 public:
-	LexInterface(Document *pdoc_) : pdoc(pdoc_), instance(0), performingStyle(false) {
-	}
-	virtual ~LexInterface() {
-	}
+	LexInterface(Document *pdoc_);
+	virtual ~LexInterface();
 	void Colourise(int start, int end);
 	bool UseContainerLexing() const {
 		return instance == 0;
 	}
+	void TextChanged(int position, int lengthChange, int endStyled);
+	void StylesInvalidated();
 };
 
 /**
@@ -224,7 +230,7 @@ private:
 	int lenWatchers;
 
 	// ldSize is not real data - it is for dimensions and loops
-	enum lineData { ldMarkers, ldLevels, ldState, ldMargin, ldAnnotation, ldSize };
+	enum lineData { ldMarkers, ldLevels, ldState, ldMargin, ldAnnotation, ldBraces, ldSize };
 	PerLine *perLineData[ldSize];
 
 	bool matchesValid;
@@ -280,6 +286,7 @@ public:
 
 	// Gateways to modifying document
 	void ModifiedAt(int pos);
+	void StyledTo(int pos);
 	void CheckReadOnly();
 	bool DeleteChars(int pos, int len);
 	bool InsertString(int position, const char *s, int insertLength);
@@ -290,6 +297,9 @@ public:
 	bool CanUndo() { return cb.CanUndo(); }
 	bool CanRedo() { return cb.CanRedo(); }
 	void DeleteUndoHistory() { cb.DeleteUndoHistory(); }
+	void SetUndoMemoryLimit(int bytes) { cb.SetUndoMemoryLimit(bytes); }
+	int GetUndoMemoryLimit() const { return cb.GetUndoMemoryLimit(); }
+	int UndoMemoryUsed() const { return cb.UndoMemoryUsed(); }
 	bool SetUndoCollection(bool collectUndo) {
 		return cb.SetUndoCollection(collectUndo);
 	}
@@ -302,6 +312,13 @@ public:
 	const char * SCI_METHOD BufferPointer() { return cb.BufferPointer(); }
 	const char *RangePointer(int position, int rangeLength) { return cb.RangePointer(position, rangeLength); }
 	int GapPosition() const { return cb.GapPosition(); }
+	void SetChunked(bool chunked) { cb.SetChunked(chunked); }
+	bool IsChunked() const { return cb.IsChunked(); }
+	int Revision() const { return cb.Revision(); }
+	Snapshot *CreateSnapshot() { return cb.CreateSnapshot(); }
+	int ChangedRanges(int sinceRevision, Sci_CharacterRange *ranges) const {
+		return cb.ChangedRanges(sinceRevision, ranges);
+	}
 
 	int SCI_METHOD GetLineIndentation(int line);
 	void SetLineIndentation(int line, int indent);
@@ -425,6 +442,11 @@ private:
 	bool IsWordEndAt(int pos);
 	bool IsWordAt(int start, int end);
 
+	void TextModifiedAt(int position, int lengthChange, int posStyle);
+	void BracesChanged(int startPos, int endPos);
+	BraceCounts *BraceIndex(char chBrace, char styBrace);
+	void CountBraces(BraceCounts *braces, int line, int lineEnd, char chBrace, char styBrace);
+	int BraceScan(int position, int limit, int direction, char chBrace, char chSeek, char styBrace, int &depth);
 	void NotifyModifyAttempt();
 	void NotifySavePoint(bool atSavePoint);
 	void NotifyModified(DocModification mh);
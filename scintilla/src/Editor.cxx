@@ -163,6 +163,7 @@ Editor::Editor() {
 	verticalScrollBarVisible = true;
 	endAtLastLine = true;
 	caretSticky = SC_CARETSTICKY_OFF;
+	idleStyling = SC_IDLESTYLING_NONE;
 	marginOptions = SC_MARGINOPTION_NONE;
 	multipleSelection = false;
 	additionalSelectionTyping = false;
@@ -6698,9 +6699,14 @@ void Editor::StyleToPositionInView(Position pos) {
 		// so require rest of window to be styled.
 		pdoc->EnsureStyledTo(endWindow);
 	}
+	if ((idleStyling != SC_IDLESTYLING_NONE) && (pdoc->GetEndStyled() < pdoc->Length())) {
+		// Continue with the rest of the document in idle time
+		QueueStyling(0);
+	}
 }
 
-void Editor::IdleStyling() {
+// Returns true when more styling should be performed in a later idle call.
+bool Editor::IdleStyling() {
 	// Style the line after the modification as this allows modifications that change just the
 	// line of the modification to heal instead of propagating to the rest of the window.
 	StyleToPositionInView(pdoc->LineStart(pdoc->LineFromPosition(styleNeeded.upTo) + 2));
@@ -6710,6 +6716,29 @@ void Editor::IdleStyling() {
 		needUpdateUI = 0;
 	}
 	styleNeeded.Reset();
+	// Keep the idle styling active while there is more to do so no other one gets queued
+	styleNeeded.active = IdleStylingAfterVisible();
+	return styleNeeded.active;
+}
+
+// Style a slice of the document after the end of the styled text. Slices are bounded in
+// time so that very large documents are styled without blocking user interaction.
+// Returns true when there is more text to style.
+bool Editor::IdleStylingAfterVisible() {
+	if (idleStyling == SC_IDLESTYLING_NONE)
+		return false;
+	const int linesPerStep = 100;
+	const double secondsPerSlice = 0.02;
+	ElapsedTime et;
+	while (pdoc->GetEndStyled() < pdoc->Length()) {
+		const int endStyled = pdoc->GetEndStyled();
+		pdoc->EnsureStyledTo(pdoc->LineStart(pdoc->LineFromPosition(endStyled) + linesPerStep));
+		if (pdoc->GetEndStyled() <= endStyled)
+			return false;	// No lexer or the container is not styling
+		if (et.Duration() > secondsPerSlice)
+			break;
+	}
+	return pdoc->GetEndStyled() < pdoc->Length();
 }
 
 void Editor::QueueStyling(int upTo) {
@@ -6899,6 +6928,68 @@ void Editor::ToggleContraction(int line) {
 	}
 }
 
+/**
+ * Set the expansion of every line and show only the lines outside contracted folds.
+ * Done in one pass with a single update of the contraction state, rather than toggling
+ * each header which scrolls and redraws every time.
+ */
+void Editor::SetFolds(const std::vector<char> &expanded) {
+	const int maxLine = pdoc->LinesTotal();
+	std::vector<char> visible(maxLine, 1);
+	for (int line = 0; line < maxLine; line++) {
+		if (!expanded[line]) {
+			const int lineMaxSubord = pdoc->GetLastChild(line);
+			for (int lineHide = line + 1; lineHide <= lineMaxSubord; lineHide++)
+				visible[lineHide] = 0;
+			line = Platform::Maximum(line, lineMaxSubord);
+		}
+	}
+	cs.SetFolding(&visible[0], &expanded[0]);
+	SetScrollBars();
+	Redraw();
+}
+
+void Editor::FoldAll(int action) {
+	pdoc->EnsureStyledTo(pdoc->Length());
+	const int maxLine = pdoc->LinesTotal();
+	bool expanding = action == SC_FOLDACTION_EXPAND;
+	if (action == SC_FOLDACTION_TOGGLE) {
+		// Discover current state
+		for (int lineSeek = 0; lineSeek < maxLine; lineSeek++) {
+			if (pdoc->GetLevel(lineSeek) & SC_FOLDLEVELHEADERFLAG) {
+				expanding = !cs.GetExpanded(lineSeek);
+				break;
+			}
+		}
+	}
+	std::vector<char> expanded(maxLine, 1);
+	if (!expanding) {
+		// Contract the top level headers, nested headers keep their state
+		for (int line = 0; line < maxLine; line++) {
+			const int level = pdoc->GetLevel(line);
+			if (level & SC_FOLDLEVELHEADERFLAG) {
+				expanded[line] = ((level & SC_FOLDLEVELNUMBERMASK) == SC_FOLDLEVELBASE) ?
+					0 : cs.GetExpanded(line);
+			}
+		}
+	}
+	SetFolds(expanded);
+}
+
+void Editor::FoldToLevel(int level) {
+	pdoc->EnsureStyledTo(pdoc->Length());
+	const int maxLine = pdoc->LinesTotal();
+	std::vector<char> expanded(maxLine, 1);
+	for (int line = 0; line < maxLine; line++) {
+		const int levelLine = pdoc->GetLevel(line);
+		if ((levelLine & SC_FOLDLEVELHEADERFLAG) &&
+			((levelLine & SC_FOLDLEVELNUMBERMASK) - SC_FOLDLEVELBASE >= level)) {
+			expanded[line] = 0;
+		}
+	}
+	SetFolds(expanded);
+}
+
 int Editor::ContractedFoldNext(int lineStart) {
 	for (int line = lineStart; line<pdoc->LinesTotal();) {
 		if (!cs.GetExpanded(line) && (pdoc->GetLevel(line) & SC_FOLDLEVELHEADERFLAG))
@@ -7246,6 +7337,16 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		pdoc->DeleteUndoHistory();
 		return 0;
 
+	case SCI_SETUNDOMEMORYLIMIT:
+		pdoc->SetUndoMemoryLimit(wParam);
+		return 0;
+
+	case SCI_GETUNDOMEMORYLIMIT:
+		return pdoc->GetUndoMemoryLimit();
+
+	case SCI_GETUNDOMEMORY:
+		return pdoc->UndoMemoryUsed();
+
 	case SCI_GETFIRSTVISIBLELINE:
 		return topLine;
 
@@ -8011,6 +8112,17 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETCARETSTICKY:
 		return caretSticky;
 
+	case SCI_SETIDLESTYLING:
+		if ((wParam == SC_IDLESTYLING_NONE) || (wParam == SC_IDLESTYLING_AFTERVISIBLE)) {
+			idleStyling = wParam;
+			if (idleStyling != SC_IDLESTYLING_NONE)
+				QueueStyling(0);
+		}
+		break;
+
+	case SCI_GETIDLESTYLING:
+		return idleStyling;
+
 	case SCI_TOGGLECARETSTICKY:
 		caretSticky = !caretSticky;
 		break;
@@ -8398,6 +8510,14 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		ToggleContraction(wParam);
 		break;
 
+	case SCI_FOLDALL:
+		FoldAll(wParam);
+		break;
+
+	case SCI_FOLDTOLEVEL:
+		FoldToLevel(wParam);
+		break;
+
 	case SCI_CONTRACTEDFOLDNEXT:
 		return ContractedFoldNext(wParam);
 
@@ -8988,6 +9108,27 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETGAPPOSITION:
 		return pdoc->GapPosition();
 
+	case SCI_GETREVISION:
+		return pdoc->Revision();
+
+	case SCI_CREATESNAPSHOT:
+		return reinterpret_cast<sptr_t>(static_cast<Sci_Snapshot *>(pdoc->CreateSnapshot()));
+
+	case SCI_RELEASESNAPSHOT:
+		if (lParam)
+			static_cast<Snapshot *>(reinterpret_cast<Sci_Snapshot *>(lParam))->Release();
+		break;
+
+	case SCI_GETCHANGEDRANGES:
+		return pdoc->ChangedRanges(wParam, reinterpret_cast<Sci_CharacterRange *>(lParam));
+
+	case SCI_SETDOCUMENTSTORAGE:
+		pdoc->SetChunked(wParam == SC_DOCUMENTSTORAGE_CHUNKED);
+		break;
+
+	case SCI_GETDOCUMENTSTORAGE:
+		return pdoc->IsChunked() ? SC_DOCUMENTSTORAGE_CHUNKED : SC_DOCUMENTSTORAGE_GAP;
+
 	case SCI_SETEXTRAASCENT:
 		vs.extraAscent = wParam;
 		InvalidateStyleRedraw();
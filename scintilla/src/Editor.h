@@ -165,6 +165,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	bool verticalScrollBarVisible;
 	bool endAtLastLine;
 	int caretSticky;
+	int idleStyling;
 	int marginOptions;
 	bool multipleSelection;
 	bool additionalSelectionTyping;
@@ -518,7 +519,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	int PositionAfterArea(PRectangle rcArea);
 	void StyleToPositionInView(Position pos);
-	void IdleStyling();
+	bool IdleStyling();
+	bool IdleStylingAfterVisible();
 	virtual void QueueStyling(int upTo);
 
 	virtual bool PaintContains(PRectangle rc);
@@ -533,6 +535,9 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	void Expand(int &line, bool doExpand);
 	void ToggleContraction(int line);
+	void SetFolds(const std::vector<char> &expanded);
+	void FoldAll(int action);
+	void FoldToLevel(int level);
 	int ContractedFoldNext(int lineStart);
 	void EnsureLineVisible(int lineDoc, bool enforcePolicy);
 	int GetTag(char *tagValue, int tagNumber);
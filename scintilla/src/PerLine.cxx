@@ -501,3 +501,300 @@ int LineAnnotation::Lines(int line) const {
 	else
 		return 0;
 }
+
+BraceCounts::BraceCounts(int kind_, int style_, int lines) : kind(kind_), style(style_),
+	blocks(256), treeCloses(0), treeOpens(0), leaves(0), treeValid(false) {
+	closes.InsertValue(0, lines, -1);
+	opens.InsertValue(0, lines, -1);
+	blocks.InsertText(0, lines);
+	for (int line = linesPerBlock; line < lines; line += linesPerBlock)
+		blocks.InsertPartition(blocks.Partitions(), line);
+	blockCloses.InsertValue(0, blocks.Partitions(), blockUncounted);
+	blockOpens.InsertValue(0, blocks.Partitions(), blockUncounted);
+}
+
+BraceCounts::~BraceCounts() {
+	delete []treeCloses;
+	treeCloses = 0;
+	delete []treeOpens;
+	treeOpens = 0;
+}
+
+int BraceCounts::Kind() const {
+	return kind;
+}
+
+int BraceCounts::Style() const {
+	return style;
+}
+
+// Braces left unmatched by a range followed by another range.
+static void CombineBraces(int closesLeft, int opensLeft, int closesRight, int opensRight,
+	int &closesBoth, int &opensBoth) {
+	const int matched = Platform::Minimum(opensLeft, closesRight);
+	closesBoth = closesLeft + closesRight - matched;
+	opensBoth = opensLeft + opensRight - matched;
+}
+
+void BraceCounts::SetBlock(int block, int closesBlock, int opensBlock) {
+	if ((blockCloses.ValueAt(block) == closesBlock) && (blockOpens.ValueAt(block) == opensBlock))
+		return;
+	blockCloses.SetValueAt(block, closesBlock);
+	blockOpens.SetValueAt(block, opensBlock);
+	if (treeValid) {
+		int node = leaves + block;
+		treeCloses[node] = closesBlock;
+		treeOpens[node] = opensBlock;
+		for (node /= 2; node >= 1; node /= 2) {
+			CombineBraces(treeCloses[node * 2], treeOpens[node * 2],
+				treeCloses[node * 2 + 1], treeOpens[node * 2 + 1], treeCloses[node], treeOpens[node]);
+		}
+	}
+}
+
+void BraceCounts::BuildTree() {
+	const int blocksDocument = blocks.Partitions();
+	int leavesNeeded = 1;
+	while (leavesNeeded < blocksDocument)
+		leavesNeeded *= 2;
+	if (leavesNeeded != leaves) {
+		delete []treeCloses;
+		delete []treeOpens;
+		treeCloses = new int[leavesNeeded * 2];
+		treeOpens = new int[leavesNeeded * 2];
+		leaves = leavesNeeded;
+	}
+	for (int block = 0; block < leaves; block++) {
+		treeCloses[leaves + block] = (block < blocksDocument) ? blockCloses.ValueAt(block) : 0;
+		treeOpens[leaves + block] = (block < blocksDocument) ? blockOpens.ValueAt(block) : 0;
+	}
+	for (int node = leaves - 1; node >= 1; node--) {
+		CombineBraces(treeCloses[node * 2], treeOpens[node * 2],
+			treeCloses[node * 2 + 1], treeOpens[node * 2 + 1], treeCloses[node], treeOpens[node]);
+	}
+	treeValid = true;
+}
+
+void BraceCounts::InsertLine(int line) {
+	if (line > closes.Length())
+		return;
+	closes.Insert(line, -1);
+	opens.Insert(line, -1);
+	const int block = blocks.PartitionFromPosition(line);
+	blocks.InsertText(block, 1);
+	const int lineBlock = blocks.PositionFromPartition(block);
+	if (blocks.PositionFromPartition(block + 1) - lineBlock > 2 * linesPerBlock) {
+		// Split the block so it does not get too long to scan
+		blocks.InsertPartition(block + 1, lineBlock + linesPerBlock);
+		blockCloses.Insert(block + 1, blockUncounted);
+		blockOpens.Insert(block + 1, blockUncounted);
+		treeValid = false;
+	}
+	SetBlock(block, blockUncounted, blockUncounted);
+}
+
+void BraceCounts::RemoveLine(int line) {
+	if (line >= closes.Length())
+		return;
+	closes.Delete(line);
+	opens.Delete(line);
+	const int block = blocks.PartitionFromPosition(line);
+	blocks.InsertText(block, -1);
+	if ((blocks.Partitions() > 1) &&
+		(blocks.PositionFromPartition(block) == blocks.PositionFromPartition(block + 1))) {
+		// Merge the empty block with a neighbour whose lines have not changed
+		blocks.RemovePartition((block > 0) ? block : 1);
+		blockCloses.Delete(block);
+		blockOpens.Delete(block);
+		treeValid = false;
+	} else {
+		SetBlock(block, blockUncounted, blockUncounted);
+	}
+}
+
+void BraceCounts::Invalidate(int lineFirst, int lineLast) {
+	if (lineLast >= closes.Length())
+		lineLast = closes.Length() - 1;
+	if (lineFirst > lineLast)
+		return;
+	for (int line = lineFirst; line <= lineLast; line++) {
+		closes[line] = -1;
+		opens[line] = -1;
+	}
+	const int blockLast = blocks.PartitionFromPosition(lineLast);
+	for (int block = blocks.PartitionFromPosition(lineFirst); block <= blockLast; block++)
+		SetBlock(block, blockUncounted, blockUncounted);
+}
+
+bool BraceCounts::Counted(int line) const {
+	return (line < closes.Length()) && (closes.ValueAt(line) >= 0);
+}
+
+void BraceCounts::SetCounts(int line, int closesLine, int opensLine) {
+	closes[line] = closesLine;
+	opens[line] = opensLine;
+}
+
+void BraceCounts::BlockLines(int line, int &lineFirst, int &lineEnd) const {
+	const int block = blocks.PartitionFromPosition(line);
+	lineFirst = blocks.PositionFromPartition(block);
+	lineEnd = blocks.PositionFromPartition(block + 1);
+}
+
+void BraceCounts::BlockCounted(int line) {
+	const int block = blocks.PartitionFromPosition(line);
+	const int lineEnd = blocks.PositionFromPartition(block + 1);
+	int closesBlock = 0;
+	int opensBlock = 0;
+	for (line = blocks.PositionFromPartition(block); line < lineEnd; line++) {
+		if (closes.ValueAt(line) < 0)
+			return;
+		CombineBraces(closesBlock, opensBlock, closes.ValueAt(line), opens.ValueAt(line),
+			closesBlock, opensBlock);
+	}
+	SetBlock(block, closesBlock, opensBlock);
+}
+
+// Find the first block in [blockStart, blockEnd) within the node covering [blockFirst, blockLast)
+// whose unmatched closing braces reach depth.
+int BraceCounts::Forward(int node, int blockFirst, int blockLast, int blockStart, int blockEnd, int &depth) const {
+	if ((blockLast <= blockStart) || (blockFirst >= blockEnd))
+		return -1;
+	if ((blockStart <= blockFirst) && (blockLast <= blockEnd)) {
+		if (treeCloses[node] < depth) {
+			depth += treeOpens[node] - treeCloses[node];
+			return -1;
+		}
+		if (blockLast - blockFirst == 1)
+			return blockFirst;
+	}
+	const int blockMiddle = (blockFirst + blockLast) / 2;
+	const int block = Forward(node * 2, blockFirst, blockMiddle, blockStart, blockEnd, depth);
+	if (block >= 0)
+		return block;
+	return Forward(node * 2 + 1, blockMiddle, blockLast, blockStart, blockEnd, depth);
+}
+
+int BraceCounts::Backward(int node, int blockFirst, int blockLast, int blockStart, int blockEnd, int &depth) const {
+	if ((blockLast <= blockStart) || (blockFirst >= blockEnd))
+		return -1;
+	if ((blockStart <= blockFirst) && (blockLast <= blockEnd)) {
+		if (treeOpens[node] < depth) {
+			depth += treeCloses[node] - treeOpens[node];
+			return -1;
+		}
+		if (blockLast - blockFirst == 1)
+			return blockFirst;
+	}
+	const int blockMiddle = (blockFirst + blockLast) / 2;
+	const int block = Backward(node * 2 + 1, blockMiddle, blockLast, blockStart, blockEnd, depth);
+	if (block >= 0)
+		return block;
+	return Backward(node * 2, blockFirst, blockMiddle, blockStart, blockEnd, depth);
+}
+
+// Blocks not yet counted are at the limit of both unmatched closing and opening braces
+// so the tree searches stop at them.
+int BraceCounts::FindForward(int lineStart, int lineEnd, int &depth) {
+	const int blockEnd = (lineEnd >= closes.Length()) ?
+		blocks.Partitions() : blocks.PartitionFromPosition(lineEnd);
+	int line = lineStart;
+	while (line < lineEnd) {
+		int lineLimit = lineEnd;
+		int blockStart = blocks.PartitionFromPosition(line);
+		if (blocks.PositionFromPartition(blockStart) < line)
+			blockStart++;
+		if (blockStart < blockEnd) {
+			if (line < blocks.PositionFromPartition(blockStart)) {
+				lineLimit = blocks.PositionFromPartition(blockStart);
+			} else {
+				if (!treeValid)
+					BuildTree();
+				const int block = Forward(1, 0, leaves, blockStart, blockEnd, depth);
+				if (block < 0) {
+					line = blocks.PositionFromPartition(blockEnd);
+					continue;
+				}
+				line = blocks.PositionFromPartition(block);
+				lineLimit = blocks.PositionFromPartition(block + 1);
+			}
+		}
+		for (; line < lineLimit; line++) {
+			if ((closes.ValueAt(line) < 0) || (closes.ValueAt(line) >= depth))
+				return line;
+			depth += opens.ValueAt(line) - closes.ValueAt(line);
+		}
+	}
+	return -1;
+}
+
+int BraceCounts::FindBackward(int lineStart, int lineEnd, int &depth) {
+	int blockStart = blocks.PartitionFromPosition(lineStart);
+	if (blocks.PositionFromPartition(blockStart) < lineStart)
+		blockStart++;
+	int line = lineEnd - 1;
+	while (line >= lineStart) {
+		int lineLimit = lineStart;
+		const int blockEnd = (line + 1 >= closes.Length()) ?
+			blocks.Partitions() : blocks.PartitionFromPosition(line + 1);
+		if (blockStart < blockEnd) {
+			if (line >= blocks.PositionFromPartition(blockEnd)) {
+				lineLimit = blocks.PositionFromPartition(blockEnd);
+			} else {
+				if (!treeValid)
+					BuildTree();
+				const int block = Backward(1, 0, leaves, blockStart, blockEnd, depth);
+				if (block < 0) {
+					line = blocks.PositionFromPartition(blockStart) - 1;
+					continue;
+				}
+				line = blocks.PositionFromPartition(block + 1) - 1;
+				lineLimit = blocks.PositionFromPartition(block);
+			}
+		}
+		for (; line >= lineLimit; line--) {
+			if ((opens.ValueAt(line) < 0) || (opens.ValueAt(line) >= depth))
+				return line;
+			depth += closes.ValueAt(line) - opens.ValueAt(line);
+		}
+	}
+	return -1;
+}
+
+LineBraces::LineBraces() {
+}
+
+LineBraces::~LineBraces() {
+	Init();
+}
+
+void LineBraces::Init() {
+	for (int i = 0; i < indexes.Length(); i++)
+		delete indexes[i];
+	indexes.DeleteAll();
+}
+
+void LineBraces::InsertLine(int line) {
+	for (int i = 0; i < indexes.Length(); i++)
+		indexes[i]->InsertLine(line);
+}
+
+void LineBraces::RemoveLine(int line) {
+	for (int i = 0; i < indexes.Length(); i++)
+		indexes[i]->RemoveLine(line);
+}
+
+BraceCounts *LineBraces::Index(int kind, int style, int lines) {
+	for (int i = 0; i < indexes.Length(); i++) {
+		if ((indexes[i]->Kind() == kind) && (indexes[i]->Style() == style))
+			return indexes[i];
+	}
+	BraceCounts *braces = new BraceCounts(kind, style, lines);
+	indexes.Insert(indexes.Length(), braces);
+	return braces;
+}
+
+void LineBraces::Invalidate(int lineFirst, int lineLast) {
+	for (int i = 0; i < indexes.Length(); i++)
+		indexes[i]->Invalidate(lineFirst, lineLast);
+}
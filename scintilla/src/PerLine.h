@@ -114,6 +114,78 @@ public:
 	int Lines(int line) const;
 };
 
+/**
+ * Index of the braces of one kind, such as '{' and '}', and one style. For each line it
+ * holds the closing braces not matched earlier on the line and the opening braces not
+ * matched later on the line. Lines are grouped in blocks which are combined in a tree so
+ * the line holding a matching brace is found without visiting the lines in between.
+ * Lines are counted lazily, block by block, when a search reaches them.
+ */
+class BraceCounts {
+	int kind;
+	int style;
+	SplitVector<int> closes;	///< -1 when the line has not been counted
+	SplitVector<int> opens;
+	Partitioning blocks;	///< Lines of each block
+	SplitVector<int> blockCloses;	///< blockUncounted until all lines of the block are counted
+	SplitVector<int> blockOpens;
+	int *treeCloses;
+	int *treeOpens;
+	int leaves;
+	bool treeValid;	///< False when blocks have been added or removed
+
+	// Private so BraceCounts objects can not be copied
+	BraceCounts(const BraceCounts &);
+	BraceCounts &operator=(const BraceCounts &);
+	void SetBlock(int block, int closesBlock, int opensBlock);
+	void BuildTree();
+	int Forward(int node, int blockFirst, int blockLast, int blockStart, int blockEnd, int &depth) const;
+	int Backward(int node, int blockFirst, int blockLast, int blockStart, int blockEnd, int &depth) const;
+public:
+	enum { linesPerBlock = 16, blockUncounted = 0x20000000 };
+
+	BraceCounts(int kind_, int style_, int lines);
+	~BraceCounts();
+	int Kind() const;
+	int Style() const;
+	void InsertLine(int line);
+	void RemoveLine(int line);
+	/// Text or styles on these lines have changed.
+	void Invalidate(int lineFirst, int lineLast);
+	bool Counted(int line) const;
+	void SetCounts(int line, int closesLine, int opensLine);
+	/// Lines of the block containing line, from lineFirst up to but not including lineEnd.
+	void BlockLines(int line, int &lineFirst, int &lineEnd) const;
+	/// Lines of the block containing line have been counted so add it to the tree.
+	void BlockCounted(int line);
+	/// Find the first line in [lineStart, lineEnd) where a closing brace brings depth to 0
+	/// or which has not been counted yet.
+	/// depth is updated to the depth at the start of that line or at lineEnd.
+	int FindForward(int lineStart, int lineEnd, int &depth);
+	/// Find the last line in [lineStart, lineEnd) where an opening brace brings depth to 0
+	/// or which has not been counted yet.
+	/// depth is updated to the depth at the end of that line or at lineStart.
+	int FindBackward(int lineStart, int lineEnd, int &depth);
+};
+
+/**
+ * The brace indexes of a document, created for each kind of brace and style when
+ * first needed.
+ */
+class LineBraces : public PerLine {
+	SplitVector<BraceCounts *> indexes;
+public:
+	LineBraces();
+	virtual ~LineBraces();
+	virtual void Init();
+	virtual void InsertLine(int line);
+	virtual void RemoveLine(int line);
+
+	BraceCounts *Index(int kind, int style, int lines);
+	/// Text or styles on these lines have changed.
+	void Invalidate(int lineFirst, int lineLast);
+};
+
 #ifdef SCI_NAMESPACE
 }
 #endif
@@ -255,12 +255,20 @@ void ScintillaBase::AutoCompleteStart(int lenEntered, const char *list) {
 
 	ac.SetList(list);
 
-	// Fiddle the position of the list so it is right next to the target and wide enough for all its strings
+	AutoCompletePlaceList(pt, rcPopupBounds);
+	ac.Show(true);
+	if (lenEntered != 0) {
+		AutoCompleteMoveToCurrentWord();
+	}
+}
+
+/// Fiddle the position of the list so it is right next to the target and wide enough for all its strings
+void ScintillaBase::AutoCompletePlaceList(Point pt, PRectangle rcPopupBounds) {
 	PRectangle rcList = ac.lb->GetDesiredRect();
 	int heightAlloced = rcList.bottom - rcList.top;
-	widthLB = Platform::Maximum(widthLB, rcList.right - rcList.left);
+	int widthLB = Platform::Maximum(ac.widthLBDefault, rcList.right - rcList.left);
 	if (maxListWidth != 0)
-		widthLB = Platform::Minimum(widthLB, aveCharWidth*maxListWidth);
+		widthLB = Platform::Minimum(widthLB, vs.styles[STYLE_DEFAULT].aveCharWidth*maxListWidth);
 	// Make an allowance for large strings in list
 	rcList.left = pt.x - ac.lb->CaretFromEdge();
 	rcList.right = rcList.left + widthLB;
@@ -272,10 +280,6 @@ void ScintillaBase::AutoCompleteStart(int lenEntered, const char *list) {
 	}
 	rcList.bottom = rcList.top + heightAlloced;
 	ac.lb->SetPositionRelative(rcList, wMain);
-	ac.Show(true);
-	if (lenEntered != 0) {
-		AutoCompleteMoveToCurrentWord();
-	}
 }
 
 void ScintillaBase::AutoCompleteCancel() {
@@ -295,7 +299,20 @@ void ScintillaBase::AutoCompleteMove(int delta) {
 
 void ScintillaBase::AutoCompleteMoveToCurrentWord() {
 	std::string wordCurrent = RangeText(ac.posStart - ac.startLen, sel.MainCaret());
-	ac.Select(wordCurrent.c_str());
+	if (ac.filter) {
+		const int rows = ac.lb->Length();
+		ac.Filter(wordCurrent.c_str());
+		if (ac.Active() && ac.lb->Length() != rows) {
+			// Fit the list to its new length
+			Point pt = LocationFromPosition(ac.posStart - ac.startLen);
+			PRectangle rcPopupBounds = wMain.GetMonitorRect(pt);
+			if (rcPopupBounds.Height() == 0)
+				rcPopupBounds = GetClientRectangle();
+			AutoCompletePlaceList(pt, rcPopupBounds);
+		}
+	} else {
+		ac.Select(wordCurrent.c_str());
+	}
 }
 
 void ScintillaBase::AutoCompleteCharacterAdded(char ch) {
@@ -526,6 +543,8 @@ void LexState::SetLexerModule(const LexerModule *lex) {
 		lexCurrent = lex;
 		if (lexCurrent)
 			instance = lexCurrent->Create();
+		stateInDocument = lexCurrent && lexCurrent->StateInDocument();
+		StylesInvalidated();
 		pdoc->LexerChanged();
 	}
 }
@@ -737,6 +756,20 @@ sptr_t ScintillaBase::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lPara
 	case SCI_AUTOCGETAUTOHIDE:
 		return ac.autoHide;
 
+	case SCI_AUTOCSETFILTER:
+		ac.filter = wParam != 0;
+		break;
+
+	case SCI_AUTOCGETFILTER:
+		return ac.filter;
+
+	case SCI_AUTOCSETORDER:
+		ac.autoSort = wParam;
+		break;
+
+	case SCI_AUTOCGETORDER:
+		return ac.autoSort;
+
 	case SCI_AUTOCSETDROPRESTOFWORD:
 		ac.dropRestOfWord = wParam != 0;
 		break;
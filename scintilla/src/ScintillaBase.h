@@ -65,6 +65,7 @@ protected:
 	virtual int KeyCommand(unsigned int iMessage);
 
 	void AutoCompleteStart(int lenEntered, const char *list);
+	void AutoCompletePlaceList(Point pt, PRectangle rcPopupBounds);
 	void AutoCompleteCancel();
 	void AutoCompleteMove(int delta);
 	int AutoCompleteGetCurrent();
@@ -173,7 +173,7 @@ G_MODULE_EXPORT void on_save1_activate(GtkMenuItem *menuitem, gpointer user_data
 
 	if (doc != NULL && cur_page >= 0)
 	{
-		document_save_file(doc, ui_prefs.allow_always_save);
+		document_save_file_async(doc, ui_prefs.allow_always_save);
 	}
 }
 
@@ -188,7 +188,7 @@ G_MODULE_EXPORT void on_save_all1_activate(GtkMenuItem *menuitem, gpointer user_
 {
 	guint i, max = (guint) gtk_notebook_get_n_pages(GTK_NOTEBOOK(main_widgets.notebook));
 	GeanyDocument *doc, *cur_doc = document_get_current();
-	guint count = 0;
+	guint count = 0, started = 0;
 
 	/* iterate over documents in tabs order */
 	for (i = 0; i < max; i++)
@@ -197,13 +197,27 @@ G_MODULE_EXPORT void on_save_all1_activate(GtkMenuItem *menuitem, gpointer user_
 		if (! doc->changed)
 			continue;
 
-		if (document_save_file(doc, FALSE))
+		if (! document_save_file_async(doc, FALSE))
+			continue;
+		/* background saves report each file once it has been written */
+		if (doc->priv->save_job != NULL)
+			started++;
+		else
 			count++;
 	}
-	if (!count)
+	if (!count && !started)
 		return;
 
-	ui_set_statusbar(FALSE, ngettext("%d file saved.", "%d files saved.", count), count);
+	if (!started)
+		ui_set_statusbar(FALSE, ngettext("%d file saved.", "%d files saved.", count), count);
+	else
+	{
+		gchar *saved = g_strdup_printf(ngettext("%d file saved", "%d files saved", count), count);
+
+		ui_set_statusbar(FALSE, ngettext("%s, saving %d more file...", "%s, saving %d more files...",
+			started), saved, started);
+		g_free(saved);
+	}
 	/* saving may have changed window title, sidebar for another doc, so update */
 	sidebar_update_tag_list(cur_doc, TRUE);
 	ui_set_window_title(cur_doc);
@@ -881,7 +895,9 @@ G_MODULE_EXPORT void on_set_file_readonly1_toggled(GtkCheckMenuItem *checkmenuit
 		g_return_if_fail(doc != NULL);
 
 		doc->readonly = ! doc->readonly;
-		sci_set_readonly(doc->editor->sci, doc->readonly);
+		/* a document being saved is kept read-only until then */
+		if (doc->priv->save_job == NULL)
+			sci_set_readonly(doc->editor->sci, doc->readonly);
 		ui_update_tab_status(doc);
 		ui_update_statusbar(doc, -1);
 	}
@@ -48,6 +48,19 @@
 /*#define USE_GIO_FILEMON 1*/
 #include <gio/gio.h>
 
+#define RELOAD_THREADS 4
+/* number of file names listed when prompting to reload several files */
+#define RELOAD_PROMPT_NAMES 10
+
+#define SAVE_CHUNK_SIZE 65536
+/* encoded chunks waiting for the writer thread */
+#define SAVE_MAX_QUEUED 16
+#define SAVE_QUEUE_WAIT 10000			/* microseconds */
+/* smaller local files are written before document_save_file_async() returns */
+#define SAVE_ASYNC_MIN_SIZE (1024 * 1024)
+#define SAVE_TIMEOUT 10					/* milliseconds */
+#define SAVE_TIME_SLICE 0.02			/* seconds spent encoding per timeout */
+
 #include "document.h"
 #include "documentprivate.h"
 #include "filetypes.h"
@@ -72,6 +85,8 @@
 #include "search.h"
 #include "filetypesprivate.h"
 #include "project.h"
+#include "projectindex.h"
+#include "filewatch.h"
 
 #include "SciLexer.h"
 
@@ -91,6 +106,11 @@ GeanyFilePrefs file_prefs;
  * Notebook tabs can be reordered. Use @c document_get_from_page(). */
 GPtrArray *documents_array = NULL;
 
+#ifdef G_OS_UNIX
+/* read once at startup, because reading it means setting it, which other threads could see */
+static mode_t file_umask = 022;
+#endif
+
 
 /* an undo action, also used for redo actions */
 typedef struct
@@ -105,6 +125,7 @@ typedef struct
 static void document_undo_clear(GeanyDocument *doc);
 static void document_redo_add(GeanyDocument *doc, guint type, gpointer data);
 static gboolean remove_page(guint page_num);
+static void document_wait_for_save(GeanyDocument *doc);
 
 
 /**
@@ -269,6 +290,10 @@ GeanyDocument *document_get_current(void)
 void document_init_doclist()
 {
 	documents_array = g_ptr_array_new();
+#ifdef G_OS_UNIX
+	file_umask = umask(0);
+	umask(file_umask);
+#endif
 }
 
 
@@ -276,6 +301,8 @@ void document_finalize()
 {
 	guint i;
 
+	file_watch_finalize();
+
 	for (i = 0; i < documents_array->len; i++)
 		g_free(documents[i]);
 	g_ptr_array_free(documents_array, TRUE);
@@ -352,8 +379,7 @@ void document_set_text_changed(GeanyDocument *doc, gboolean changed)
 	{
 		ui_update_tab_status(doc);
 		ui_save_buttons_toggle(changed);
-		ui_set_window_title(doc);
-		ui_update_statusbar(doc, -1);
+		ui_queue_update(GEANY_UI_UPDATE_WINDOW_TITLE | GEANY_UI_UPDATE_STATUSBAR);
 	}
 }
 
@@ -437,6 +463,8 @@ static void document_stop_file_monitoring(GeanyDocument *doc)
 		g_object_unref(doc->priv->monitor);
 		doc->priv->monitor = NULL;
 	}
+	file_watch_remove(doc);
+	doc->priv->watched = FALSE;
 }
 
 
@@ -468,6 +496,8 @@ static void monitor_file_setup(GeanyDocument *doc)
 			g_object_unref(file);
 		}
 		g_free(locale_filename);
+#else
+		doc->priv->watched = file_watch_add(doc);
 #endif
 	}
 	doc->priv->file_disk_status = FILE_OK;
@@ -580,6 +610,7 @@ static gboolean remove_page(guint page_num)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
+	document_wait_for_save(doc);
 	if (doc->changed && ! dialogs_show_unsaved_file(doc))
 		return FALSE;
 
@@ -603,6 +634,8 @@ static gboolean remove_page(guint page_num)
 	g_free(doc->priv->saved_encoding.encoding);
 	g_free(doc->file_name);
 	g_free(doc->real_path);
+	if (doc->tm_file != NULL)
+		project_index_file_closed(doc->tm_file->file_name);
 	tm_workspace_remove_object(doc->tm_file, TRUE, TRUE);
 
 	editor_destroy(doc->editor);
@@ -612,6 +645,7 @@ static gboolean remove_page(guint page_num)
 
 	document_undo_clear(doc);
 
+	symbols_free_tag_rows(doc);
 	g_free(doc->priv);
 
 	/* reset document settings to defaults for re-use */
@@ -774,12 +808,14 @@ typedef struct
 	gboolean	 bom;
 	time_t		 mtime;	/* modification time, read by stat::st_mtime */
 	gboolean	 readonly;
+	gchar		*error;	/* message if the file could not be read */
 } FileData;
 
 
-/* loads textfile data, verifies and converts to forced_enc or UTF-8. Also handles BOM. */
-static gboolean load_text_file(const gchar *locale_filename, const gchar *display_filename,
-	FileData *filedata, const gchar *forced_enc)
+/* reads textfile data without converting it. This doesn't use the UI, so that it can
+ * be called from other threads. */
+static gboolean read_text_file(const gchar *locale_filename, const gchar *display_filename,
+	FileData *filedata)
 {
 	GError *err = NULL;
 	struct stat st;
@@ -789,10 +825,11 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 	filedata->enc = NULL;
 	filedata->bom = FALSE;
 	filedata->readonly = FALSE;
+	filedata->error = NULL;
 
 	if (g_stat(locale_filename, &st) != 0)
 	{
-		ui_set_statusbar(TRUE, _("Could not open file %s (%s)"),
+		filedata->error = g_strdup_printf(_("Could not open file %s (%s)"),
 			display_filename, g_strerror(errno));
 		return FALSE;
 	}
@@ -801,12 +838,28 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 
 	if (! g_file_get_contents(locale_filename, &filedata->data, NULL, &err))
 	{
-		ui_set_statusbar(TRUE, "%s", err->message);
+		filedata->error = g_strdup(err->message);
 		g_error_free(err);
 		return FALSE;
 	}
 
 	filedata->len = (gsize) st.st_size;
+	return TRUE;
+}
+
+
+/* verifies and converts textfile data read by read_text_file() to forced_enc or UTF-8.
+ * Also handles BOM. */
+static gboolean load_text_file(const gchar *display_filename, FileData *filedata,
+	const gchar *forced_enc)
+{
+	if (filedata->error != NULL)
+	{
+		ui_set_statusbar(TRUE, "%s", filedata->error);
+		g_free(filedata->error);
+		return FALSE;
+	}
+
 	if (! encodings_convert_to_utf8_auto(&filedata->data, &filedata->len, forced_enc,
 				&filedata->enc, &filedata->bom, &filedata->readonly))
 	{
@@ -1070,13 +1123,10 @@ void document_show_tab(GeanyDocument *doc)
 }
 
 
-/* To open a new file, set doc to NULL; filename should be locale encoded.
- * To reload a file, set the doc for the document to be reloaded; filename should be NULL.
- * pos is the cursor position, which can be overridden by --line and --column.
- * forced_enc can be NULL to detect the file encoding.
- * Returns: doc of the opened file or NULL if an error occurred. */
-GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename, gint pos,
-		gboolean readonly, GeanyFiletype *ft, const gchar *forced_enc)
+/* See document_open_file_full(). When reloading, read_data can be the file already read
+ * by read_text_file(). */
+static GeanyDocument *open_file(GeanyDocument *doc, const gchar *filename, gint pos,
+		gboolean readonly, GeanyFiletype *ft, const gchar *forced_enc, FileData *read_data)
 {
 	gint editor_mode;
 	gboolean reload = (doc == NULL) ? FALSE : TRUE;
@@ -1088,6 +1138,7 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 
 	if (reload)
 	{
+		document_wait_for_save(doc);
 		utf8_filename = g_strdup(doc->file_name);
 		locale_filename = utils_get_locale_from_utf8(utf8_filename);
 	}
@@ -1122,7 +1173,11 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 	{	/* doc possibly changed */
 		display_filename = utils_str_middle_truncate(utf8_filename, 100);
 
-		if (! load_text_file(locale_filename, display_filename, &filedata, forced_enc))
+		if (read_data != NULL)
+			filedata = *read_data;
+		else
+			read_text_file(locale_filename, display_filename, &filedata);
+		if (! load_text_file(display_filename, &filedata, forced_enc))
 		{
 			g_free(display_filename);
 			g_free(utf8_filename);
@@ -1145,6 +1200,10 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 		sci_set_undo_collection(doc->editor->sci, FALSE); /* avoid creation of an undo action */
 		sci_empty_undo_buffer(doc->editor->sci);
 
+		/* large files are stored in chunks, which are cheap to edit far apart */
+		sci_set_chunked_storage(doc->editor->sci, editor_prefs.chunked_storage_size > 0 &&
+			filedata.len >= (gsize) editor_prefs.chunked_storage_size * 1024 * 1024);
+
 		/* add the text to the ScintillaObject */
 		sci_set_readonly(doc->editor->sci, FALSE);	/* to allow replacing text */
 		sci_set_text(doc->editor->sci, filedata.data);	/* NULL terminated data */
@@ -1234,6 +1293,18 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 }
 
 
+/* To open a new file, set doc to NULL; filename should be locale encoded.
+ * To reload a file, set the doc for the document to be reloaded; filename should be NULL.
+ * pos is the cursor position, which can be overridden by --line and --column.
+ * forced_enc can be NULL to detect the file encoding.
+ * Returns: doc of the opened file or NULL if an error occurred. */
+GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename, gint pos,
+		gboolean readonly, GeanyFiletype *ft, const gchar *forced_enc)
+{
+	return open_file(doc, filename, pos, readonly, ft, forced_enc, NULL);
+}
+
+
 /* Takes a new line separated list of filename URIs and opens each file.
  * length is the length of the string */
 void document_open_file_list(const gchar *data, gsize length)
@@ -1403,6 +1474,7 @@ void document_rename_file(GeanyDocument *doc, const gchar *new_filename)
 	gchar *new_locale_filename = utils_get_locale_from_utf8(new_filename);
 	gint result;
 
+	document_wait_for_save(doc);
 	/* stop file monitoring to avoid getting events for deleting/creating files,
 	 * it's re-setup in document_save_file_as() */
 	document_stop_file_monitoring(doc);
@@ -1447,6 +1519,7 @@ gboolean document_save_file_as(GeanyDocument *doc, const gchar *utf8_fname)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
+	document_wait_for_save(doc);
 	if (utf8_fname != NULL)
 		SETPTR(doc->file_name, g_strdup(utf8_fname));
 
@@ -1481,306 +1554,602 @@ gboolean document_save_file_as(GeanyDocument *doc, const gchar *utf8_fname)
 }
 
 
-static gsize save_convert_to_encoding(GeanyDocument *doc, gchar **data, gsize *len)
+/* Part of the file being saved. */
+typedef struct SaveChunk
+{
+	gchar *data;
+	gsize len;
+	gboolean end;			/* the end of the file, without data */
+	gboolean commit;		/* with end, whether the file should replace that on disk */
+}
+SaveChunk;
+
+/* The file being written, only used by the thread writing it. */
+typedef struct SaveFile
+{
+	gchar *locale_filename;
+	gchar *temp_filename;	/* safe saving writes this first and renames it over the file */
+	FILE *fp;
+	GOutputStream *stream;	/* GIO saving */
+	gboolean safe;
+	gboolean gio;
+	gboolean gio_backup;
+	gchar *error;
+}
+SaveFile;
+
+/* A document being saved. The text is encoded on the main thread, chunk by chunk, and for
+ * a background save the chunks are written by another thread. */
+typedef struct SaveJob
+{
+	GeanyDocument *doc;
+	SaveFile file;
+	GIConv conv;			/* (GIConv) -1 to write the text unchanged */
+	gboolean checking;		/* encoding the text only to find conversion errors */
+	gboolean bom;			/* the BOM has still to be written */
+	gint pos;				/* of the text not yet encoded */
+	gint length;
+	gboolean encoded;
+	gchar *encode_error;	/* secondary text of a conversion error */
+	/* background saving */
+	GThread *thread;
+	GAsyncQueue *chunks;	/* SaveChunk to the writer thread */
+	gboolean queued_end;
+	volatile gint write_failed;
+	volatile gint written;	/* set by the writer thread once it has closed the file */
+	guint timeout_id;
+}
+SaveJob;
+
+static const gchar utf8_bom[] = "\xef\xbb\xbf";
+
+
+static void free_save_chunk(SaveChunk *chunk)
 {
-	GError *conv_error = NULL;
-	gchar* conv_file_contents = NULL;
-	gsize bytes_read;
-	gsize conv_len;
+	g_free(chunk->data);
+	g_free(chunk);
+}
 
-	g_return_val_if_fail(data != NULL && *data != NULL, FALSE);
-	g_return_val_if_fail(len != NULL, FALSE);
 
-	/* try to convert it from UTF-8 to original encoding */
-	conv_file_contents = g_convert(*data, *len - 1, doc->encoding, "UTF-8",
-												&bytes_read, &conv_len, &conv_error);
+/* Appends the conversion of in_len bytes of in to chunk, growing chunk->data as needed.
+ * in can be NULL to reset the conversion state at the end of the text.
+ * @return @c FALSE on a conversion error, setting converted to the bytes converted before it. */
+static gboolean convert_to_chunk(GIConv conv, const gchar *in, gsize in_len,
+		SaveChunk *chunk, gsize *size, gsize *converted)
+{
+	gchar *inbuf = (gchar *) in;
+	gsize in_left = in_len;
 
-	if (conv_error != NULL)
+	while (TRUE)
 	{
-		gchar *text = g_strdup_printf(
-_("An error occurred while converting the file from UTF-8 in \"%s\". The file remains unsaved."),
-			doc->encoding);
-		gchar *error_text;
+		gchar *out = chunk->data + chunk->len;
+		gsize out_left = *size - chunk->len;
+		gsize ret = g_iconv(conv, &inbuf, &in_left, &out, &out_left);
+
+		chunk->len = out - chunk->data;
+		*converted = in_len - in_left;
+		if (ret != (gsize) -1)
+			return TRUE;
+		if (errno != E2BIG)
+			return FALSE;
+
+		*size *= 2;
+		chunk->data = g_realloc(chunk->data, *size);
+	}
+}
+
+
+static void set_encode_error(SaveJob *job, gint pos, const gchar *message)
+{
+	GeanyDocument *doc = job->doc;
+	gchar *context;
+	gint line, column;
+	gint context_len;
+	gunichar unic;
+	/* don't read over the doc length */
+	gint max_len = MIN(pos + 6, job->length);
 
-		if (conv_error->code == G_CONVERT_ERROR_ILLEGAL_SEQUENCE)
+	context = g_malloc0(7); /* read 6 bytes from Sci + '\0' */
+	sci_get_text_range(doc->editor->sci, pos, max_len, context);
+
+	/* take only one valid Unicode character from the context and discard the leftover */
+	unic = g_utf8_get_char_validated(context, -1);
+	context_len = g_unichar_to_utf8(unic, context);
+	context[context_len] = '\0';
+	get_line_column_from_pos(doc, pos, &line, &column);
+
+	job->encode_error = g_strdup_printf(
+		_("Error message: %s\nThe error occurred at \"%s\" (line: %d, column: %d)."),
+		message, context, line + 1, column);
+	g_free(context);
+}
+
+
+/* Encodes the next part of the text, straight from the Scintilla buffer.
+ * @return The encoded chunk, or @c NULL when the text has been encoded or can't be converted,
+ * setting job->encode_error in the latter case. */
+static SaveChunk *save_job_encode(SaveJob *job)
+{
+	SaveChunk *chunk;
+	const gchar *text = "";
+	gint want, n;
+
+	if (job->encoded)
+		return NULL;
+
+	want = MIN(SAVE_CHUNK_SIZE + 4, job->length - job->pos);
+	if (want > 0)
+		text = (const gchar *) scintilla_send_message(job->doc->editor->sci,
+			SCI_GETRANGEPOINTER, (uptr_t) job->pos, want);
+	n = MIN(SAVE_CHUNK_SIZE, want);
+	/* don't split a multibyte character between chunks */
+	if (n < want)
+	{
+		gint end = n;
+
+		while (end > 0 && ((guchar) text[end] & 0xc0) == 0x80)
+			end--;
+		if (end > 0)
+			n = end;
+	}
+
+	chunk = g_new0(SaveChunk, 1);
+	if (job->conv == (GIConv) -1)
+	{
+		const gchar *nul = memchr(text, '\0', n);
+
+		/* like before, the text written ends at a NUL character */
+		if (nul != NULL)
 		{
-			gchar *context = NULL;
-			gint line, column;
-			gint context_len;
-			gunichar unic;
-			/* don't read over the doc length */
-			gint max_len = MIN((gint)bytes_read + 6, (gint)*len - 1);
-			context = g_malloc(7); /* read 6 bytes from Sci + '\0' */
-			sci_get_text_range(doc->editor->sci, bytes_read, max_len, context);
-
-			/* take only one valid Unicode character from the context and discard the leftover */
-			unic = g_utf8_get_char_validated(context, -1);
-			context_len = g_unichar_to_utf8(unic, context);
-			context[context_len] = '\0';
-			get_line_column_from_pos(doc, bytes_read, &line, &column);
-
-			error_text = g_strdup_printf(
-				_("Error message: %s\nThe error occurred at \"%s\" (line: %d, column: %d)."),
-				conv_error->message, context, line + 1, column);
-			g_free(context);
+			n = nul - text;
+			job->encoded = TRUE;
 		}
-		else
-			error_text = g_strdup_printf(_("Error message: %s."), conv_error->message);
-
-		geany_debug("encoding error: %s", conv_error->message);
-		dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, text, error_text);
-		g_error_free(conv_error);
-		g_free(text);
-		g_free(error_text);
-		return FALSE;
+		chunk->data = g_malloc(n + 3);
+		if (job->bom)
+		{
+			memcpy(chunk->data, utf8_bom, 3);
+			chunk->len = 3;
+		}
+		memcpy(chunk->data + chunk->len, text, n);
+		chunk->len += n;
 	}
 	else
 	{
-		g_free(*data);
-		*data = conv_file_contents;
-		*len = conv_len;
+		/* enough for any encoding but UTF-7, which grows the chunk if needed */
+		gsize size = n * 4 + 16;
+		gsize converted;
+		gboolean ok = TRUE;
+
+		chunk->data = g_malloc(size);
+		/* the BOM is converted to that of doc->encoding */
+		if (job->bom)
+			ok = convert_to_chunk(job->conv, utf8_bom, 3, chunk, &size, &converted);
+		/* the error offset counts only the text bytes, the BOM isn't part of the document */
+		if (! ok)
+			converted = 0;
+		else
+			ok = convert_to_chunk(job->conv, text, n, chunk, &size, &converted);
+		if (! ok)
+		{
+			set_encode_error(job, job->pos + converted, g_strerror(errno));
+			free_save_chunk(chunk);
+			job->encoded = TRUE;
+			return NULL;
+		}
+		if (job->pos + n >= job->length)
+			convert_to_chunk(job->conv, NULL, 0, chunk, &size, &converted);
 	}
-	return TRUE;
+	job->bom = FALSE;
+	job->pos += n;
+	if (job->pos >= job->length)
+		job->encoded = TRUE;
+	return chunk;
+}
+
+
+/* Starts encoding again after checking that all the text can be converted. */
+static void save_job_restart(SaveJob *job)
+{
+	job->checking = FALSE;
+	job->encoded = FALSE;
+	job->pos = 0;
+	job->bom = job->doc->has_bom && encodings_is_unicode_charset(job->doc->encoding);
+	if (job->conv != (GIConv) -1)
+		g_iconv(job->conv, NULL, NULL, NULL, NULL);
+}
+
+
+static void set_save_file_error(SaveFile *file, const gchar *format, const gchar *function)
+{
+	int save_errno = errno;
+	gchar *display_name = g_filename_display_name(file->locale_filename);
+
+	if (file->error == NULL)
+		file->error = g_strdup_printf(format, display_name, function, g_strerror(save_errno));
+	g_free(display_name);
+}
+
+
+static void set_save_file_gerror(SaveFile *file, GError *error)
+{
+	if (file->error == NULL)
+		file->error = g_strdup(error->message);
+	g_error_free(error);
 }
 
 
-static gchar *write_data_to_disk(const gchar *locale_filename,
-								 const gchar *data, gsize len)
+/* The SaveFile functions only use the file, so that they can be called from another thread. */
+static gboolean save_file_open(SaveFile *file)
 {
 	GError *error = NULL;
 
-	if (file_prefs.use_safe_file_saving)
+	if (file->safe)
 	{
-		/* Use old GLib API for safe saving (GVFS-safe, but alters ownership and permissons).
-		 * This is the only option that handles disk space exhaustion. */
-		if (g_file_set_contents(locale_filename, data, len, &error))
-			geany_debug("Wrote %s with g_file_set_contents().", locale_filename);
+		/* write a temporary file next to the file and rename it over the file once written,
+		 * so that the file is never left truncated */
+		gint fd;
+#ifdef G_OS_UNIX
+		struct stat st;
+#endif
+
+		file->temp_filename = g_strconcat(file->locale_filename, ".XXXXXX", NULL);
+		errno = 0;
+		fd = g_mkstemp(file->temp_filename);
+		if (fd == -1)
+		{
+			set_save_file_error(file, _("Failed to open file '%s' for writing: %s() failed: %s"),
+				"mkstemp");
+			SETPTR(file->temp_filename, NULL);
+			return FALSE;
+		}
+#ifdef G_OS_UNIX
+		/* keep the permissions of the file, or give a new file those open() would,
+		 * not the 0600 of mkstemp() */
+		if (g_stat(file->locale_filename, &st) == 0)
+			fchmod(fd, st.st_mode & 07777);
+		else
+			fchmod(fd, 0666 & ~file_umask);
+#endif
+		file->fp = fdopen(fd, "wb");
+		if (file->fp == NULL)
+		{
+			close(fd);
+			g_unlink(file->temp_filename);
+			SETPTR(file->temp_filename, NULL);
+		}
 	}
-	else if (file_prefs.use_gio_unsafe_file_saving)
+	else if (file->gio)
 	{
-		GFile *fp;
-
 		/* Use GIO API to save file (GVFS-safe)
 		 * It is best in most GVFS setups but don't seem to work correctly on some more complex
 		 * setups (saving from some VM to their host, over some SMB shares, etc.) */
-		fp = g_file_new_for_path(locale_filename);
-		g_file_replace_contents(fp, data, len, NULL, file_prefs.gio_unsafe_save_backup,
-			G_FILE_CREATE_NONE, NULL, NULL, &error);
+		GFile *fp = g_file_new_for_path(file->locale_filename);
+
+		file->stream = G_OUTPUT_STREAM(g_file_replace(fp, NULL, file->gio_backup,
+			G_FILE_CREATE_NONE, NULL, &error));
 		g_object_unref(fp);
+		if (file->stream == NULL)
+		{
+			set_save_file_gerror(file, error);
+			return FALSE;
+		}
+		return TRUE;
 	}
 	else
 	{
-		FILE *fp;
-		int save_errno;
-		gchar *display_name = g_filename_display_name(locale_filename);
-
 		/* Use POSIX API for unsafe saving (GVFS-unsafe) */
 		/* The error handling is taken from glib-2.26.0 gfileutils.c */
 		errno = 0;
-		fp = g_fopen(locale_filename, "wb");
-		if (fp == NULL)
-		{
-			save_errno = errno;
-
-			g_set_error(&error,
-				G_FILE_ERROR,
-				g_file_error_from_errno(save_errno),
-				_("Failed to open file '%s' for writing: fopen() failed: %s"),
-				display_name,
-				g_strerror(save_errno));
-		}
-		else
-		{
-			gsize bytes_written;
+		file->fp = g_fopen(file->locale_filename, "wb");
+	}
+	if (file->fp == NULL)
+	{
+		set_save_file_error(file, _("Failed to open file '%s' for writing: %s() failed: %s"),
+			"fopen");
+		return FALSE;
+	}
+	return TRUE;
+}
 
-			errno = 0;
-			bytes_written = fwrite(data, sizeof(gchar), len, fp);
 
-			if (len != bytes_written)
-			{
-				save_errno = errno;
-
-				g_set_error(&error,
-					G_FILE_ERROR,
-					g_file_error_from_errno(save_errno),
-					_("Failed to write file '%s': fwrite() failed: %s"),
-					display_name,
-					g_strerror(save_errno));
-			}
+static gboolean save_file_write(SaveFile *file, const gchar *data, gsize len)
+{
+	GError *error = NULL;
 
-			errno = 0;
-			/* preserve the fwrite() error if any */
-			if (fclose(fp) != 0 && error == NULL)
-			{
-				save_errno = errno;
-
-				g_set_error(&error,
-					G_FILE_ERROR,
-					g_file_error_from_errno(save_errno),
-					_("Failed to close file '%s': fclose() failed: %s"),
-					display_name,
-					g_strerror(save_errno));
-			}
+	if (file->stream != NULL)
+	{
+		if (! g_output_stream_write_all(file->stream, data, len, NULL, NULL, &error))
+		{
+			set_save_file_gerror(file, error);
+			return FALSE;
 		}
-
-		g_free(display_name);
+		return TRUE;
 	}
-	if (error != NULL)
+
+	errno = 0;
+	if (fwrite(data, sizeof(gchar), len, file->fp) != len)
 	{
-		gchar *msg = g_strdup(error->message);
-		g_error_free(error);
-		/* geany will warn about file truncation for unsafe saving below */
-		return msg;
+		set_save_file_error(file, _("Failed to write file '%s': %s() failed: %s"), "fwrite");
+		return FALSE;
 	}
-	return NULL;
+	return TRUE;
 }
 
 
-static gchar *save_doc(GeanyDocument *doc, const gchar *locale_filename,
-								 const gchar *data, gsize len)
+/* Closes the file, replacing the file on disk with a safely written one only if commit
+ * is set. */
+static void save_file_close(SaveFile *file, gboolean commit)
 {
-	gchar *err;
+	GError *error = NULL;
 
-	g_return_val_if_fail(doc != NULL, g_strdup(g_strerror(EINVAL)));
-	g_return_val_if_fail(data != NULL, g_strdup(g_strerror(EINVAL)));
+	if (file->stream != NULL)
+	{
+		/* closing a cancelled stream leaves the original file in place */
+		GCancellable *cancellable = g_cancellable_new();
 
-	err = write_data_to_disk(locale_filename, data, len);
-	if (err)
-		return err;
+		if (! commit)
+			g_cancellable_cancel(cancellable);
+		if (! g_output_stream_close(file->stream, cancellable, &error) && commit)
+			set_save_file_gerror(file, error);
+		else if (error != NULL)
+			g_error_free(error);
+		g_object_unref(cancellable);
+		g_object_unref(file->stream);
+		file->stream = NULL;
+		return;
+	}
+	if (file->fp == NULL)
+		return;
 
-	/* now the file is on disk, set real_path */
-	if (doc->real_path == NULL)
+	errno = 0;
+	if (file->safe && commit && fflush(file->fp) != 0)
 	{
-		doc->real_path = tm_get_real_path(locale_filename);
-		doc->priv->is_remote = utils_is_remote_path(locale_filename);
-		monitor_file_setup(doc);
+		set_save_file_error(file, _("Failed to write file '%s': %s() failed: %s"), "fflush");
+		commit = FALSE;
+	}
+#ifdef G_OS_UNIX
+	/* make sure the data is on disk before the file is replaced */
+	else if (file->safe && commit && fsync(fileno(file->fp)) != 0)
+	{
+		set_save_file_error(file, _("Failed to write file '%s': %s() failed: %s"), "fsync");
+		commit = FALSE;
+	}
+#endif
+	errno = 0;
+	/* preserve the fwrite() error if any */
+	if (fclose(file->fp) != 0)
+	{
+		set_save_file_error(file, _("Failed to close file '%s': %s() failed: %s"), "fclose");
+		commit = FALSE;
+	}
+	file->fp = NULL;
+
+	if (file->temp_filename != NULL)
+	{
+#ifdef G_OS_WIN32
+		/* rename() can't replace a file on Windows */
+		if (commit)
+			g_unlink(file->locale_filename);
+#endif
+		errno = 0;
+		if (commit && g_rename(file->temp_filename, file->locale_filename) != 0)
+		{
+			set_save_file_error(file, _("Failed to write file '%s': %s() failed: %s"), "rename");
+			commit = FALSE;
+		}
+		if (! commit)
+			g_unlink(file->temp_filename);
 	}
-	return NULL;
 }
 
 
-/**
- *  Saves the document.
- *  Also shows the Save As dialog if necessary.
- *  If the file is not modified, this function may do nothing unless @a force is set to @c TRUE.
- *
- *  Saving may include replacing tabs by spaces,
- *  stripping trailing spaces and adding a final new line at the end of the file, depending
- *  on user preferences. Then the @c "document-before-save" signal is emitted,
- *  allowing plugins to modify the document before it is saved, and data is
- *  actually written to disk.
- *
- *  On successful saving:
- *  - GeanyDocument::real_path is set.
- *  - The filetype is set again or auto-detected if it wasn't set yet.
- *  - The @c "document-save" signal is emitted for plugins.
- *
- *  @warning You should ensure @c doc->file_name has an absolute path unless you want the
- *  Save As dialog to be shown. A @c NULL value also shows the dialog. This behaviour was
- *  added in Geany 1.22.
- *
- *  @param doc The document to save.
- *  @param force Whether to save the file even if it is not modified.
- *
- *  @return @c TRUE if the file was saved or @c FALSE if the file could not or should not be saved.
- **/
-gboolean document_save_file(GeanyDocument *doc, gboolean force)
+static void save_job_free(SaveJob *job)
 {
-	gchar *errmsg;
-	gchar *data;
-	gsize len;
-	gchar *locale_filename;
-	const GeanyFilePrefs *fp;
-
-	g_return_val_if_fail(doc != NULL, FALSE);
-
-	if (document_need_save_as(doc))
+	if (job->conv != (GIConv) -1)
+		g_iconv_close(job->conv);
+	if (job->chunks != NULL)
 	{
-		/* ensure doc is the current tab before showing the dialog */
-		document_show_tab(doc);
-		return dialogs_show_save_as();
-	}
+		SaveChunk *chunk;
 
-	/* the "changed" flag should exclude the "readonly" flag, but check it anyway for safety */
-	if (! force && (! doc->changed || doc->readonly))
-		return FALSE;
+		while ((chunk = g_async_queue_try_pop(job->chunks)) != NULL)
+			free_save_chunk(chunk);
+		g_async_queue_unref(job->chunks);
+	}
+	g_free(job->file.locale_filename);
+	g_free(job->file.temp_filename);
+	g_free(job->file.error);
+	g_free(job->encode_error);
+	g_free(job);
+}
 
-	fp = project_get_file_prefs();
-	/* replaces tabs by spaces but only if the current file is not a Makefile */
-	if (fp->replace_tabs && doc->file_type->id != GEANY_FILETYPES_MAKE)
-		editor_replace_tabs(doc->editor);
-	/* strip trailing spaces */
-	if (fp->strip_trailing_spaces)
-		editor_strip_trailing_spaces(doc->editor);
-	/* ensure the file has a newline at the end */
-	if (fp->final_new_line)
-		editor_ensure_final_newline(doc->editor);
-	/* ensure newlines are consistent */
-	if (fp->ensure_convert_new_lines)
-		sci_convert_eols(doc->editor->sci, sci_get_eol_mode(doc->editor->sci));
 
-	/* notify plugins which may wish to modify the document before it's saved */
-	g_signal_emit_by_name(geany_object, "document-before-save", doc);
+/* @return @c NULL if the text can't be converted to doc->encoding, after telling the user. */
+static SaveJob *save_job_new(GeanyDocument *doc)
+{
+	SaveJob *job = g_new0(SaveJob, 1);
+	gboolean check = FALSE;
 
-	len = sci_get_length(doc->editor->sci) + 1;
-	if (doc->has_bom && encodings_is_unicode_charset(doc->encoding))
-	{	/* always write a UTF-8 BOM because in this moment the text itself is still in UTF-8
-		 * encoding, it will be converted to doc->encoding below and this conversion
-		 * also changes the BOM */
-		data = (gchar*) g_malloc(len + 3);	/* 3 chars for BOM */
-		data[0] = (gchar) 0xef;
-		data[1] = (gchar) 0xbb;
-		data[2] = (gchar) 0xbf;
-		sci_get_text(doc->editor->sci, len, data + 3);
-		len += 3;
-	}
-	else
-	{
-		data = (gchar*) g_malloc(len);
-		sci_get_text(doc->editor->sci, len, data);
-	}
+	job->doc = doc;
+	job->conv = (GIConv) -1;
+	job->length = sci_get_length(doc->editor->sci);
+	job->file.locale_filename = utils_get_locale_from_utf8(doc->file_name);
+	job->file.safe = file_prefs.use_safe_file_saving;
+	job->file.gio = file_prefs.use_gio_unsafe_file_saving;
+	job->file.gio_backup = file_prefs.gio_unsafe_save_backup;
 
 	/* save in original encoding, skip when it is already UTF-8 or has the encoding "None" */
 	if (doc->encoding != NULL && ! utils_str_equal(doc->encoding, "UTF-8") &&
 		! utils_str_equal(doc->encoding, encodings[GEANY_ENCODING_NONE].charset))
 	{
-		if (! save_convert_to_encoding(doc, &data, &len))
+		job->conv = g_iconv_open(doc->encoding, "UTF-8");
+		if (job->conv == (GIConv) -1)
 		{
-			g_free(data);
-			return FALSE;
+			gchar *text = g_strdup_printf(
+_("An error occurred while converting the file from UTF-8 in \"%s\". The file remains unsaved."),
+				doc->encoding);
+			gchar *error_text = g_strdup_printf(
+				_("Conversion from UTF-8 to \"%s\" is not supported."), doc->encoding);
+
+			dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, text, error_text);
+			g_free(text);
+			g_free(error_text);
+			save_job_free(job);
+			return NULL;
 		}
+		/* a file written in place is truncated as soon as it is opened, so make sure
+		 * the whole text can be converted first */
+		check = ! job->file.safe && ! job->file.gio;
 	}
-	else
+	save_job_restart(job);
+	job->checking = check;
+	return job;
+}
+
+
+/* Writes the file on the current thread. */
+static void save_job_run(SaveJob *job)
+{
+	SaveChunk *chunk;
+	gboolean ok;
+
+	if (job->checking)
 	{
-		len = strlen(data);
+		while ((chunk = save_job_encode(job)) != NULL)
+			free_save_chunk(chunk);
+		if (job->encode_error != NULL)
+			return;
+		save_job_restart(job);
 	}
+	ok = save_file_open(&job->file);
+	while (ok && (chunk = save_job_encode(job)) != NULL)
+	{
+		ok = save_file_write(&job->file, chunk->data, chunk->len);
+		free_save_chunk(chunk);
+	}
+	save_file_close(&job->file, ok && job->encode_error == NULL);
+}
 
-	locale_filename = utils_get_locale_from_utf8(doc->file_name);
-
-	/* ignore file changed notification when the file is written */
-	doc->priv->file_disk_status = FILE_IGNORE;
 
-	/* actually write the content of data to the file on disk */
-	errmsg = save_doc(doc, locale_filename, data, len);
-	g_free(data);
+/* Runs in the thread writing the chunks encoded by the main thread. */
+static gpointer save_job_write(gpointer data)
+{
+	SaveJob *job = data;
+	SaveChunk *chunk;
+	gboolean ok = save_file_open(&job->file);
 
-	if (errmsg != NULL)
+	if (! ok)
+		g_atomic_int_set(&job->write_failed, 1);
+	while (! (chunk = g_async_queue_pop(job->chunks))->end)
 	{
-		ui_set_statusbar(TRUE, _("Error saving file (%s)."), errmsg);
-
-		if (!file_prefs.use_safe_file_saving)
+		if (ok && ! save_file_write(&job->file, chunk->data, chunk->len))
 		{
-			SETPTR(errmsg,
-				g_strdup_printf(_("%s\n\nThe file on disk may now be truncated!"), errmsg));
+			ok = FALSE;
+			g_atomic_int_set(&job->write_failed, 1);
 		}
-		dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, _("Error saving file."), errmsg);
-		doc->priv->file_disk_status = FILE_OK;
-		utils_beep();
-		g_free(locale_filename);
+		free_save_chunk(chunk);
+	}
+	save_file_close(&job->file, ok && chunk->commit);
+	free_save_chunk(chunk);
+
+	g_atomic_int_set(&job->written, 1);
+	return NULL;
+}
+
+
+/* Encodes the next chunk for the writer thread, starting the thread if needed.
+ * The end of the file is queued once all the text has been encoded or an error occurred. */
+static void save_job_push(SaveJob *job)
+{
+	SaveChunk *chunk = NULL;
+	GError *error = NULL;
+
+	if (job->checking)
+	{
+		chunk = save_job_encode(job);
+		if (chunk != NULL)
+		{
+			free_save_chunk(chunk);
+			return;
+		}
+		if (job->encode_error != NULL)
+		{
+			job->queued_end = TRUE;
+			return;
+		}
+		save_job_restart(job);
+	}
+	if (job->thread == NULL)
+	{
+		job->chunks = g_async_queue_new();
+		job->thread = g_thread_create(save_job_write, job, TRUE, &error);
+		if (job->thread == NULL)
+		{
+			job->file.error = g_strdup(error->message);
+			g_error_free(error);
+			job->queued_end = TRUE;
+			return;
+		}
+	}
+
+	if (! g_atomic_int_get(&job->write_failed))
+		chunk = save_job_encode(job);
+	if (chunk == NULL)
+	{
+		chunk = g_new0(SaveChunk, 1);
+		chunk->end = TRUE;
+		chunk->commit = (job->encode_error == NULL);
+		job->queued_end = TRUE;
+	}
+	g_async_queue_push(job->chunks, chunk);
+}
+
+
+/* Finishes saving the document after its file has been written, or reports the error.
+ * @return @c TRUE if the file was saved. */
+static gboolean save_job_finish(SaveJob *job)
+{
+	GeanyDocument *doc = job->doc;
+	const gchar *locale_filename = job->file.locale_filename;
+
+	if (job->encode_error != NULL)
+	{
+		gchar *text = g_strdup_printf(
+_("An error occurred while converting the file from UTF-8 in \"%s\". The file remains unsaved."),
+			doc->encoding);
+
+		dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, text, job->encode_error);
+		g_free(text);
+		doc->priv->file_disk_status = FILE_OK;
+		save_job_free(job);
+		return FALSE;
+	}
+	if (job->file.error != NULL)
+	{
+		gchar *errmsg = g_strdup(job->file.error);
+
+		ui_set_statusbar(TRUE, _("Error saving file (%s)."), errmsg);
+
+		if (! job->file.safe)
+		{
+			SETPTR(errmsg,
+				g_strdup_printf(_("%s\n\nThe file on disk may now be truncated!"), errmsg));
+		}
+		dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, _("Error saving file."), errmsg);
+		doc->priv->file_disk_status = FILE_OK;
+		utils_beep();
 		g_free(errmsg);
+		save_job_free(job);
 		return FALSE;
 	}
 
+	/* now the file is on disk, set real_path */
+	if (doc->real_path == NULL)
+	{
+		doc->real_path = tm_get_real_path(locale_filename);
+		doc->priv->is_remote = utils_is_remote_path(locale_filename);
+		monitor_file_setup(doc);
+	}
+
 	/* store the opened encoding for undo/redo */
 	store_saved_encoding(doc);
 
@@ -1803,7 +2172,7 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 		vte_cwd((doc->real_path != NULL) ? doc->real_path : doc->file_name, FALSE);
 #endif
 	}
-	g_free(locale_filename);
+	save_job_free(job);
 
 	g_signal_emit_by_name(geany_object, "document-save", doc);
 
@@ -1811,6 +2180,168 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 }
 
 
+/* Completes a background save once its file has been written. */
+static void save_job_complete(SaveJob *job)
+{
+	GeanyDocument *doc = job->doc;
+
+	if (job->thread != NULL)
+		g_thread_join(job->thread);
+	doc->priv->save_job = NULL;
+	sci_set_readonly(doc->editor->sci, doc->readonly);
+	save_job_finish(job);
+}
+
+
+static gboolean on_save_timeout(gpointer data)
+{
+	SaveJob *job = data;
+	GTimer *timer = g_timer_new();
+
+	/* don't encode the text faster than it can be written */
+	while (! job->queued_end && g_timer_elapsed(timer, NULL) < SAVE_TIME_SLICE &&
+		(job->chunks == NULL || g_async_queue_length(job->chunks) < SAVE_MAX_QUEUED))
+		save_job_push(job);
+	g_timer_destroy(timer);
+
+	if (! job->queued_end || (job->thread != NULL && ! g_atomic_int_get(&job->written)))
+		return TRUE;
+
+	job->timeout_id = 0;
+	save_job_complete(job);
+	return FALSE;
+}
+
+
+/* Finishes writing the file of doc on the current thread if it is being saved
+ * in the background. */
+static void document_wait_for_save(GeanyDocument *doc)
+{
+	SaveJob *job = doc->priv->save_job;
+
+	if (job == NULL)
+		return;
+
+	g_source_remove(job->timeout_id);
+	while (! job->queued_end)
+	{
+		if (job->chunks != NULL && g_async_queue_length(job->chunks) >= SAVE_MAX_QUEUED)
+			g_usleep(SAVE_QUEUE_WAIT);
+		else
+			save_job_push(job);
+	}
+	save_job_complete(job);
+}
+
+
+static gboolean save_file(GeanyDocument *doc, gboolean force, gboolean async)
+{
+	SaveJob *job;
+	const GeanyFilePrefs *fp;
+
+	g_return_val_if_fail(doc != NULL, FALSE);
+
+	if (doc->priv->save_job != NULL)
+	{
+		/* the document can't change until it has been saved */
+		if (async)
+			return TRUE;
+		document_wait_for_save(doc);
+	}
+
+	if (document_need_save_as(doc))
+	{
+		/* ensure doc is the current tab before showing the dialog */
+		document_show_tab(doc);
+		return dialogs_show_save_as();
+	}
+
+	/* the "changed" flag should exclude the "readonly" flag, but check it anyway for safety */
+	if (! force && (! doc->changed || doc->readonly))
+		return FALSE;
+
+	fp = project_get_file_prefs();
+	/* replaces tabs by spaces but only if the current file is not a Makefile */
+	if (fp->replace_tabs && doc->file_type->id != GEANY_FILETYPES_MAKE)
+		editor_replace_tabs(doc->editor);
+	/* strip trailing spaces */
+	if (fp->strip_trailing_spaces)
+		editor_strip_trailing_spaces(doc->editor);
+	/* ensure the file has a newline at the end */
+	if (fp->final_new_line)
+		editor_ensure_final_newline(doc->editor);
+	/* ensure newlines are consistent */
+	if (fp->ensure_convert_new_lines)
+		sci_convert_eols(doc->editor->sci, sci_get_eol_mode(doc->editor->sci));
+
+	/* notify plugins which may wish to modify the document before it's saved */
+	g_signal_emit_by_name(geany_object, "document-before-save", doc);
+
+	job = save_job_new(doc);
+	if (job == NULL)
+		return FALSE;
+
+	/* ignore file changed notification when the file is written */
+	doc->priv->file_disk_status = FILE_IGNORE;
+
+	if (async && ! main_status.quitting &&
+		(job->length >= SAVE_ASYNC_MIN_SIZE || doc->priv->is_remote))
+	{
+		/* the text is read from the Scintilla buffer while saving */
+		sci_set_readonly(doc->editor->sci, TRUE);
+		doc->priv->save_job = job;
+		job->timeout_id = g_timeout_add(SAVE_TIMEOUT, on_save_timeout, job);
+		ui_set_statusbar(TRUE, _("Saving %s..."), doc->file_name);
+		return TRUE;
+	}
+
+	/* actually write the content of the document to the file on disk */
+	save_job_run(job);
+	return save_job_finish(job);
+}
+
+
+/**
+ *  Saves the document.
+ *  Also shows the Save As dialog if necessary.
+ *  If the file is not modified, this function may do nothing unless @a force is set to @c TRUE.
+ *
+ *  Saving may include replacing tabs by spaces,
+ *  stripping trailing spaces and adding a final new line at the end of the file, depending
+ *  on user preferences. Then the @c "document-before-save" signal is emitted,
+ *  allowing plugins to modify the document before it is saved, and data is
+ *  actually written to disk.
+ *
+ *  On successful saving:
+ *  - GeanyDocument::real_path is set.
+ *  - The filetype is set again or auto-detected if it wasn't set yet.
+ *  - The @c "document-save" signal is emitted for plugins.
+ *
+ *  @warning You should ensure @c doc->file_name has an absolute path unless you want the
+ *  Save As dialog to be shown. A @c NULL value also shows the dialog. This behaviour was
+ *  added in Geany 1.22.
+ *
+ *  @param doc The document to save.
+ *  @param force Whether to save the file even if it is not modified.
+ *
+ *  @return @c TRUE if the file was saved or @c FALSE if the file could not or should not be saved.
+ **/
+gboolean document_save_file(GeanyDocument *doc, gboolean force)
+{
+	return save_file(doc, force, FALSE);
+}
+
+
+/* Like document_save_file(), but large and remote files are written in the background.
+ * The document is read-only until then, and is only marked saved once the file
+ * has been written.
+ * @return @c TRUE if the file was saved or is being saved. */
+gboolean document_save_file_async(GeanyDocument *doc, gboolean force)
+{
+	return save_file(doc, force, TRUE);
+}
+
+
 /* special search function, used from the find entry in the toolbar
  * return TRUE if text was found otherwise FALSE
  * return also TRUE if text is empty  */
@@ -2250,6 +2781,8 @@ void document_update_tags(GeanyDocument *doc)
 			tm_work_object_free(doc->tm_file);
 			doc->tm_file = NULL;
 		}
+		else if (doc->tm_file)
+			project_index_file_opened(doc->tm_file->file_name);
 	}
 
 	/* early out if there's no work object and we couldn't create one */
@@ -2524,7 +3057,25 @@ void document_undo_add(GeanyDocument *doc, guint type, gpointer data)
 	if (type != UNDO_SCINTILLA || !doc->changed)
 		document_set_text_changed(doc, TRUE);
 
-	ui_update_popup_reundo_items(doc);
+	ui_queue_update(GEANY_UI_UPDATE_REUNDO_ITEMS);
+}
+
+
+/* Scintilla forgets its oldest undo actions when the undo memory limit is reached, so
+ * Scintilla actions left on our stack once it can't undo anymore are stale. */
+static void drop_stale_undo_actions(GeanyDocument *doc)
+{
+	undo_action *action;
+
+	if (sci_can_undo(doc->editor->sci))
+		return;
+
+	action = g_trash_stack_peek(&doc->priv->undo_actions);
+	while (action != NULL && action->type == UNDO_SCINTILLA)
+	{
+		g_free(g_trash_stack_pop(&doc->priv->undo_actions));
+		action = g_trash_stack_peek(&doc->priv->undo_actions);
+	}
 }
 
 
@@ -2532,6 +3083,8 @@ gboolean document_can_undo(GeanyDocument *doc)
 {
 	g_return_val_if_fail(doc != NULL, FALSE);
 
+	drop_stale_undo_actions(doc);
+
 	if (g_trash_stack_height(&doc->priv->undo_actions) > 0 || sci_can_undo(doc->editor->sci))
 		return TRUE;
 	else
@@ -2555,6 +3108,7 @@ void document_undo(GeanyDocument *doc)
 
 	g_return_if_fail(doc != NULL);
 
+	drop_stale_undo_actions(doc);
 	action = g_trash_stack_pop(&doc->priv->undo_actions);
 
 	if (G_UNLIKELY(action == NULL))
@@ -2690,7 +3244,7 @@ static void document_redo_add(GeanyDocument *doc, guint type, gpointer data)
 	if (type != UNDO_SCINTILLA || !doc->changed)
 		document_set_text_changed(doc, TRUE);
 
-	ui_update_popup_reundo_items(doc);
+	ui_queue_update(GEANY_UI_UPDATE_REUNDO_ITEMS);
 }
 
 
@@ -2855,6 +3409,8 @@ gboolean document_account_for_unsaved(void)
 	{
 		GeanyDocument *doc = document_get_from_page(p);
 
+		if (DOC_VALID(doc))
+			document_wait_for_save(doc);
 		if (DOC_VALID(doc) && doc->changed)
 		{
 			if (! dialogs_show_unsaved_file(doc))
@@ -2960,6 +3516,224 @@ static gboolean monitor_resave_missing_file(GeanyDocument *doc)
 }
 
 
+typedef struct ReloadJob
+{
+	GeanyDocument *doc;
+	guint doc_id;			/* to notice if doc was closed while its file was read */
+	gchar *locale_filename;
+	gchar *display_filename;
+	FileData filedata;
+	struct ReloadBatch *batch;
+}
+ReloadJob;
+
+/* Documents reloaded together by reload_files(). */
+typedef struct ReloadBatch
+{
+	GThreadPool *pool;
+	ReloadJob *jobs;
+	guint n_jobs;
+	volatile gint pending;	/* files not yet read */
+}
+ReloadBatch;
+
+
+static gboolean on_reload_files_read(gpointer data)
+{
+	ReloadBatch *batch = data;
+	guint i;
+
+	/* all the files have been read, this only joins the idle threads */
+	if (batch->pool != NULL)
+		g_thread_pool_free(batch->pool, FALSE, TRUE);
+
+	for (i = 0; i < batch->n_jobs; i++)
+	{
+		ReloadJob *job = &batch->jobs[i];
+		GeanyDocument *doc = job->doc;
+
+		if (DOC_VALID(doc) && doc->id == job->doc_id)
+		{
+			gint pos = sci_get_current_position(doc->editor->sci);
+
+			doc->priv->reloading = FALSE;
+			sci_set_readonly(doc->editor->sci, doc->readonly);
+			if (open_file(doc, NULL, pos, doc->readonly, doc->file_type, doc->encoding,
+					&job->filedata) != NULL)
+			{
+				doc->priv->file_disk_status = FILE_OK;
+				ui_update_tab_status(doc);
+			}
+		}
+		else
+		{
+			g_free(job->filedata.data);
+			g_free(job->filedata.error);
+		}
+		g_free(job->locale_filename);
+		g_free(job->display_filename);
+	}
+	g_free(batch->jobs);
+	g_free(batch);
+	return FALSE;
+}
+
+
+static void read_reload_job(gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+	ReloadJob *job = data;
+
+	read_text_file(job->locale_filename, job->display_filename, &job->filedata);
+	/* the last file read finishes the reload on the main thread */
+	if (g_atomic_int_dec_and_test(&job->batch->pending))
+		g_idle_add(on_reload_files_read, job->batch);
+}
+
+
+/* Reloads several documents, reading their files in parallel. Setting the text and parsing
+ * the tags is still done on the main thread, the ctags parsers are not thread safe.
+ * The documents are read-only until then. */
+static void reload_files(GPtrArray *docs)
+{
+	ReloadBatch *batch = g_new0(ReloadBatch, 1);
+	guint i;
+
+	batch->n_jobs = docs->len;
+	batch->jobs = g_new0(ReloadJob, docs->len);
+	batch->pending = docs->len;
+	for (i = 0; i < docs->len; i++)
+	{
+		ReloadJob *job = &batch->jobs[i];
+
+		job->doc = g_ptr_array_index(docs, i);
+		job->doc_id = job->doc->id;
+		job->locale_filename = utils_get_locale_from_utf8(job->doc->file_name);
+		job->display_filename = utils_str_middle_truncate(job->doc->file_name, 100);
+		job->batch = batch;
+		job->doc->priv->reloading = TRUE;
+		sci_set_readonly(job->doc->editor->sci, TRUE);
+	}
+
+	batch->pool = g_thread_pool_new(read_reload_job, NULL, RELOAD_THREADS, FALSE, NULL);
+	for (i = 0; i < batch->n_jobs; i++)
+	{
+		if (batch->pool != NULL)
+			g_thread_pool_push(batch->pool, &batch->jobs[i], NULL);
+		else
+			read_reload_job(&batch->jobs[i], NULL);
+	}
+}
+
+
+static gboolean prompt_reload_files(GPtrArray *docs)
+{
+	GString *names = g_string_new(NULL);
+	guint i;
+	gint ret;
+
+	for (i = 0; i < docs->len && i < RELOAD_PROMPT_NAMES; i++)
+	{
+		gchar *base_name = g_path_get_basename(DOC_FILENAME(g_ptr_array_index(docs, i)));
+
+		g_string_append_printf(names, "%s\n", base_name);
+		g_free(base_name);
+	}
+	if (docs->len > RELOAD_PROMPT_NAMES)
+		g_string_append_printf(names, _("and %u more"), docs->len - RELOAD_PROMPT_NAMES);
+	else
+		g_string_truncate(names, names->len - 1);
+
+	ret = dialogs_show_prompt(NULL,
+		NULL, GTK_RESPONSE_NONE,
+		GTK_STOCK_NO, GTK_RESPONSE_CANCEL,
+		_("_Reload All"), GTK_RESPONSE_ACCEPT,
+		names->str,
+		_("%u files on the disk are more recent than their buffers. Do you want to reload them?"),
+		docs->len);
+	g_string_free(names, TRUE);
+	return ret == GTK_RESPONSE_ACCEPT;
+}
+
+
+/* Keeps the buffers of docs after the user declined to reload them, so that they are
+ * not prompted for again until their files change once more. */
+static void ignore_changed_files(GPtrArray *docs)
+{
+	GeanyDocument *doc;
+	guint i;
+
+	foreach_ptr_array(doc, i, docs)
+	{
+		gchar *locale_filename = utils_get_locale_from_utf8(doc->file_name);
+		struct stat st;
+
+		if (g_stat(locale_filename, &st) == 0)
+			doc->priv->mtime = st.st_mtime;
+		g_free(locale_filename);
+		doc->priv->file_disk_status = FILE_OK;
+		ui_update_tab_status(doc);
+	}
+}
+
+
+/* Called by filewatch.c with the documents whose files may have changed on disk.
+ * When several unmodified documents have changed, they are reloaded together instead
+ * of prompting for each of them. */
+void document_files_changed(GPtrArray *docs)
+{
+	GPtrArray *reload;
+	GeanyDocument *doc;
+	guint i;
+
+	if (file_prefs.disk_check_timeout == 0)
+		return;
+
+	reload = g_ptr_array_new();
+	foreach_ptr_array(doc, i, docs)
+	{
+		gchar *locale_filename;
+		struct stat st;
+		gboolean missing;
+
+		if (! DOC_VALID(doc) || ! doc->priv->watched || doc->real_path == NULL ||
+			doc->priv->save_job != NULL || doc->priv->reloading)
+			continue;
+
+		locale_filename = utils_get_locale_from_utf8(doc->file_name);
+		missing = (g_stat(locale_filename, &st) != 0);
+		g_free(locale_filename);
+		if (! missing && doc->priv->mtime >= st.st_mtime)
+			continue;
+
+		doc->priv->file_disk_status = FILE_CHANGED;
+		ui_update_tab_status(doc);
+		/* missing files and documents with unsaved changes are still prompted for one by one */
+		if (! missing && ! doc->changed)
+			g_ptr_array_add(reload, doc);
+	}
+
+	if (reload->len > 1)
+	{
+		if (prompt_reload_files(reload))
+			reload_files(reload);
+		else
+			ignore_changed_files(reload);
+	}
+	else
+		g_ptr_array_set_size(reload, 0);
+
+	/* other documents are checked when switching to them */
+	doc = document_get_current();
+	if (doc != NULL && doc->priv->file_disk_status == FILE_CHANGED)
+	{
+		for (i = 0; i < reload->len && g_ptr_array_index(reload, i) != doc; i++);
+		if (i == reload->len)
+			document_check_disk_status(doc, FALSE);
+	}
+	g_ptr_array_free(reload, TRUE);
+}
+
+
 /* Set force to force a disk check, otherwise it is ignored if there was a check
  * in the last file_prefs.disk_check_timeout seconds.
  * @return @c TRUE if the file has changed. */
@@ -2974,12 +3748,13 @@ gboolean document_check_disk_status(GeanyDocument *doc, gboolean force)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
-	/* ignore remote files and documents that have never been saved to disk */
+	/* ignore remote files, documents that have never been saved to disk and files
+	 * still being read by reload_files() */
 	if (notebook_switch_in_progress() || file_prefs.disk_check_timeout == 0
-			|| doc->real_path == NULL || doc->priv->is_remote)
+			|| doc->real_path == NULL || doc->priv->is_remote || doc->priv->reloading)
 		return FALSE;
 
-	use_gio_filemon = (doc->priv->monitor != NULL);
+	use_gio_filemon = (doc->priv->monitor != NULL || doc->priv->watched);
 
 	if (use_gio_filemon)
 	{
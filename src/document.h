@@ -243,6 +243,10 @@ void document_set_encoding(GeanyDocument *doc, const gchar *new_encoding);
 
 gboolean document_check_disk_status(GeanyDocument *doc, gboolean force);
 
+void document_files_changed(GPtrArray *docs);
+
+gboolean document_save_file_async(GeanyDocument *doc, gboolean force);
+
 /* own Undo / Redo implementation to be able to undo / redo changes
  * to the encoding or the Unicode BOM (which are Scintilla independent).
  * All Scintilla events are stored in the undo / redo buffer and are passed through. */
@@ -60,6 +60,12 @@ typedef struct GeanyDocumentPrivate
 	GtkWidget		*tag_tree;
 	/* GtkTreeStore object for this document within the Symbols treeview of the sidebar. */
 	GtkTreeStore	*tag_store;
+	/* Tags shown in tag_store and their rows, see symbols.c. */
+	struct SymbolRows	*symbol_rows;
+	/* When the symbol list was last shown, to keep the lists of recently shown documents. */
+	guint			 symbol_list_shown;
+	/* Rows collapsed in the symbol list before it was freed, see sidebar.c. */
+	gchar			**symbol_list_collapsed;
 	/* Iter for this document within the Open Files treeview of the sidebar. */
 	GtkTreeIter		 iter;
 	/* Used by the Undo/Redo management code. */
@@ -77,12 +83,18 @@ typedef struct GeanyDocumentPrivate
 	FileDiskStatus	 file_disk_status;
 	/* Reference to a GFileMonitor object, only used when GIO file monitoring is used. */
 	gpointer		 monitor;
+	/* Whether the file is watched for changes by filewatch.c instead of being polled. */
+	gboolean		 watched;
 	/* Time of the last disk check, only used when legacy file monitoring is used. */
 	time_t			 last_check;
-	/* Modification time of the document on disk, only used when legacy file monitoring is used. */
+	/* Modification time of the document on disk, not used when GIO file monitoring is used. */
 	time_t			 mtime;
 	/* ID of the idle callback updating the tag list */
 	guint			 tag_list_update_source;
+	/* The save in progress in the background, see document_save_file_async() */
+	struct SaveJob	*save_job;
+	/* Whether the file is being read in the background, see document.c:reload_files() */
+	gboolean		 reloading;
 }
 GeanyDocumentPrivate;
 
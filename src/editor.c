@@ -60,12 +60,16 @@
 #include "projectprivate.h"
 #include "main.h"
 #include "highlighting.h"
+#include "pluginutils.h"
 
 
 /* Note: use sciwrappers.h instead where possible.
  * Do not use SSM in files unrelated to scintilla. */
 #define SSM(s, m, w, l) scintilla_send_message(s, m, w, l)
 
+/* how long fuzzy completion may look for matching tags after each keystroke, in seconds */
+#define FUZZY_COMPLETION_TIME 0.02
+
 
 static GHashTable *snippet_hash = NULL;
 static GQueue *snippet_offsets = NULL;
@@ -92,6 +96,21 @@ static struct
 	ScintillaObject *sci;
 } calltip = {NULL, FALSE, NULL, 0, 0, NULL};
 
+/* the last autocompletion list shown, which Scintilla narrows down itself while the
+ * word it was made for is typed on */
+static struct
+{
+	ScintillaObject *sci;
+	gint start;			/* start position of the word */
+	gchar *root;		/* the word, or NULL if the list has to be rebuilt */
+	gchar *words;		/* the list, starting with a newline */
+	GTimer *timer;		/* per keystroke latency, only measured in debug mode */
+	guint idle_id;
+	guint keystrokes;
+	gdouble total_time;
+	gdouble max_time;
+} autocompletion = {NULL, -1, NULL, NULL, NULL, 0, 0, 0.0, 0.0};
+
 static gchar indent[100];
 
 
@@ -525,13 +544,11 @@ static void on_update_ui(GeanyEditor *editor, G_GNUC_UNUSED SCNotification *nt)
 	if (! (nt->updated & SC_UPDATE_CONTENT) && ! (nt->updated & SC_UPDATE_SELECTION))
 		return;
 
-	/* undo / redo menu update */
-	ui_update_popup_reundo_items(editor->document);
-
 	/* brace highlighting */
 	editor_highlight_braces(editor, pos);
 
-	ui_update_statusbar(editor->document, pos);
+	/* undo / redo menu and statusbar update, once for many notifications */
+	ui_queue_update(GEANY_UI_UPDATE_REUNDO_ITEMS | GEANY_UI_UPDATE_STATUSBAR);
 
 #if 0
 	/** experimental code for inverting selections */
@@ -607,8 +624,19 @@ static void check_line_breaking(GeanyEditor *editor, gint pos, gchar c)
 }
 
 
-static void show_autocomplete(ScintillaObject *sci, gsize rootlen, GString *words)
+/* ranked lists are in the order of how well the items match instead of sorted */
+static void show_autocomplete(ScintillaObject *sci, gsize rootlen, GString *words, gboolean ranked)
 {
+	gint pos = sci_get_current_position(sci);
+	/* a list cut at autocompletion_max_entries ends with "..." */
+	gboolean complete = ! (utils_str_equal(words->str, "...") ||
+		g_str_has_suffix(words->str, "\n..."));
+
+	g_free(autocompletion.root);
+	g_free(autocompletion.words);
+	autocompletion.root = NULL;
+	autocompletion.words = NULL;
+
 	/* hide autocompletion if only option is already typed */
 	if (rootlen >= words->len ||
 		(words->str[rootlen] == '?' && rootlen >= words->len - 2))
@@ -618,11 +646,83 @@ static void show_autocomplete(ScintillaObject *sci, gsize rootlen, GString *word
 	}
 	/* store whether a calltip is showing, so we can reshow it after autocompletion */
 	calltip.set = (gboolean) SSM(sci, SCI_CALLTIPACTIVE, 0, 0);
+	SSM(sci, SCI_AUTOCSETORDER, ranked ? SC_ORDER_CUSTOM : SC_ORDER_PRESORTED, 0);
+	/* only a complete list can be narrowed down without asking for the matches again,
+	 * and a ranked one not at all as its items needn't start with the word */
+	if (ranked)
+		complete = FALSE;
+	SSM(sci, SCI_AUTOCSETFILTER, complete, 0);
 	SSM(sci, SCI_AUTOCSHOW, rootlen, (sptr_t) words->str);
+
+	if (complete && rootlen > 0)
+	{
+		autocompletion.sci = sci;
+		autocompletion.start = pos - (gint) rootlen;
+		autocompletion.root = sci_get_contents_range(sci, autocompletion.start, pos);
+		autocompletion.words = g_strconcat("\n", words->str, NULL);
+	}
+}
+
+
+/* Whether the shown autocompletion list was made for a word @a root continues, so
+ * Scintilla can narrow it down instead of it being rebuilt for every keystroke. */
+static gboolean autocomplete_list_matches(ScintillaObject *sci, gint pos,
+		const gchar *root, gsize rootlen)
+{
+	gchar *item;
+	gboolean found;
+
+	if (autocompletion.root == NULL || autocompletion.sci != sci ||
+		autocompletion.start != pos - (gint) rootlen ||
+		! g_str_has_prefix(root, autocompletion.root) ||
+		! SSM(sci, SCI_AUTOCACTIVE, 0, 0))
+		return FALSE;
+
+	/* when nothing in the list matches any more other completions should be tried */
+	item = g_strconcat("\n", root, NULL);
+	found = strstr(autocompletion.words, item) != NULL;
+	g_free(item);
+	return found;
+}
+
+
+static void autocomplete_report_latency(void)
+{
+	if (autocompletion.keystrokes > 0)
+	{
+		geany_debug("Autocompletion list updated for %u keystrokes in %.1f ms on average, "
+			"%.1f ms at most", autocompletion.keystrokes,
+			autocompletion.total_time * 1000 / autocompletion.keystrokes,
+			autocompletion.max_time * 1000);
+		autocompletion.keystrokes = 0;
+		autocompletion.total_time = 0.0;
+		autocompletion.max_time = 0.0;
+	}
 }
 
 
-static void show_tags_list(GeanyEditor *editor, const GPtrArray *tags, gsize rootlen)
+/* Runs once the list is updated and redrawn after a keystroke. */
+static gboolean on_autocomplete_idle(gpointer data)
+{
+	GeanyDocument *doc = document_get_current();
+
+	autocompletion.idle_id = 0;
+	if (doc != NULL && SSM(doc->editor->sci, SCI_AUTOCACTIVE, 0, 0))
+	{
+		gdouble elapsed = g_timer_elapsed(autocompletion.timer, NULL);
+
+		autocompletion.keystrokes++;
+		autocompletion.total_time += elapsed;
+		autocompletion.max_time = MAX(autocompletion.max_time, elapsed);
+	}
+	else
+		autocomplete_report_latency();
+	return FALSE;
+}
+
+
+static void show_tags_list(GeanyEditor *editor, const GPtrArray *tags, gsize rootlen,
+		gboolean ranked)
 {
 	ScintillaObject *sci = editor->sci;
 
@@ -653,7 +753,7 @@ static void show_tags_list(GeanyEditor *editor, const GPtrArray *tags, gsize roo
 			else
 				g_string_append(words, "?1");
 		}
-		show_autocomplete(sci, rootlen, words);
+		show_autocomplete(sci, rootlen, words, ranked);
 		g_string_free(words, TRUE);
 	}
 }
@@ -746,7 +846,7 @@ static void autocomplete_scope(GeanyEditor *editor)
 		tags = tm_workspace_find_scope_members(obj ? obj->tags_array : NULL,
 			name, TRUE, FALSE);
 		if (tags)
-			show_tags_list(editor, tags, 0);
+			show_tags_list(editor, tags, 0, FALSE);
 	}
 }
 
@@ -1009,6 +1109,16 @@ void editor_sci_notify_cb(G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED gint sc
 
 	g_return_if_fail(editor != NULL);
 
+#ifdef HAVE_PLUGINS
+	{
+		SCNotification *nt = scnt;
+
+		/* record changes first, a handler returning TRUE stops the emission */
+		if (nt->nmhdr.code == SCN_MODIFIED &&
+			(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+			plugin_document_changes_add(editor->document, nt->position, nt->linesAdded);
+	}
+#endif
 	g_signal_emit_by_name(geany_object, "editor-notify", editor, scnt, &retval);
 }
 
@@ -1103,6 +1213,7 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *edi
 			/* now that autocomplete is finishing or was cancelled, reshow calltips
 			 * if they were showing */
 			request_reshowing_calltip(nt);
+			autocomplete_report_latency();
 			break;
 
 #ifdef GEANY_DEBUG
@@ -1506,46 +1617,14 @@ static void auto_close_chars(ScintillaObject *sci, gint pos, gchar c)
 }
 
 
-/* Finds a corresponding matching brace to the given pos
- * (this is taken from Scintilla Editor.cxx,
- * fit to work with close_block) */
+/* Finds a corresponding matching brace to the given pos */
 static gint brace_match(ScintillaObject *sci, gint pos)
 {
-	gchar chBrace = sci_get_char_at(sci, pos);
-	gchar chSeek = utils_brace_opposite(chBrace);
-	gchar chAtPos;
-	gint direction = -1;
-	gint styBrace;
-	gint depth = 1;
-	gint styAtPos;
-
 	/* Hack: we need the style at @p pos but it isn't computed yet, so force styling
 	 * of this very position */
 	sci_colourise(sci, pos, pos + 1);
 
-	styBrace = sci_get_style_at(sci, pos);
-
-	if (utils_is_opening_brace(chBrace, editor_prefs.brace_match_ltgt))
-		direction = 1;
-
-	pos += direction;
-	while ((pos >= 0) && (pos < sci_get_length(sci)))
-	{
-		chAtPos = sci_get_char_at(sci, pos);
-		styAtPos = sci_get_style_at(sci, pos);
-
-		if ((pos > sci_get_end_styled(sci)) || (styAtPos == styBrace))
-		{
-			if (chAtPos == chBrace)
-				depth++;
-			if (chAtPos == chSeek)
-				depth--;
-			if (depth == 0)
-				return pos;
-		}
-		pos += direction;
-	}
-	return -1;
+	return sci_find_matching_brace(sci, pos);
 }
 
 
@@ -2023,13 +2102,40 @@ autocomplete_html(ScintillaObject *sci, const gchar *root, gsize rootlen)
 		}
 	}
 	if (found)
-		show_autocomplete(sci, rootlen, words);
+		show_autocomplete(sci, rootlen, words, FALSE);
 
 	g_string_free(words, TRUE);
 	return found;
 }
 
 
+/* Tags containing the characters of root in order, best matches first */
+static gboolean
+autocomplete_tags_fuzzy(GeanyEditor *editor, const gchar *root, gsize rootlen)
+{
+	GeanyDocument *doc = editor->document;
+	const GPtrArray *tags;
+	const gchar *scope = NULL;
+
+	/* members of the class or function being edited rank higher */
+	if (symbols_get_current_scope(doc, &scope) < 0)
+		scope = NULL;
+
+	tags = tm_workspace_find_fuzzy(root, tm_tag_max_t, doc->file_type->lang,
+		TM_SOURCE_FILE(doc->tm_file), scope,
+		editor_prefs.autocompletion_max_entries, FUZZY_COMPLETION_TIME);
+	if (tags && tags->len > 0)
+	{
+		show_tags_list(editor, tags, rootlen, TRUE);
+		return TRUE;
+	}
+	/* a ranked list isn't hidden by Scintilla when nothing matches any more */
+	if (SSM(editor->sci, SCI_AUTOCACTIVE, 0, 0))
+		SSM(editor->sci, SCI_AUTOCCANCEL, 0, 0);
+	return FALSE;
+}
+
+
 /* Current document & global tags autocompletion */
 static gboolean
 autocomplete_tags(GeanyEditor *editor, const gchar *root, gsize rootlen)
@@ -2042,10 +2148,13 @@ autocomplete_tags(GeanyEditor *editor, const gchar *root, gsize rootlen)
 
 	doc = editor->document;
 
+	if (editor_prefs.autocomplete_fuzzy)
+		return autocomplete_tags_fuzzy(editor, root, rootlen);
+
 	tags = tm_workspace_find(root, tm_tag_max_t, attrs, TRUE, doc->file_type->lang);
 	if (tags)
 	{
-		show_tags_list(editor, tags, rootlen);
+		show_tags_list(editor, tags, rootlen, FALSE);
 		return tags->len > 0;
 	}
 	return FALSE;
@@ -2172,7 +2281,7 @@ static gboolean autocomplete_doc_word(GeanyEditor *editor, gchar *root, gsize ro
 
 	g_slist_free(words);
 
-	show_autocomplete(sci, rootlen, str);
+	show_autocomplete(sci, rootlen, str, FALSE);
 	g_string_free(str, TRUE);
 	return TRUE;
 }
@@ -2208,6 +2317,17 @@ gboolean editor_start_auto_complete(GeanyEditor *editor, gint pos, gboolean forc
 	if (!force && !highlighting_is_code_style(lexer, style))
 		return FALSE;
 
+	if (G_UNLIKELY(app->debug_mode))
+	{
+		/* measure until the list is redrawn, which happens before idle callbacks */
+		if (autocompletion.timer == NULL)
+			autocompletion.timer = g_timer_new();
+		else
+			g_timer_start(autocompletion.timer);
+		if (autocompletion.idle_id == 0)
+			autocompletion.idle_id = g_idle_add(on_autocomplete_idle, NULL);
+	}
+
 	autocomplete_scope(editor);
 	ret = autocomplete_check_html(editor, style, pos);
 
@@ -2237,8 +2357,11 @@ gboolean editor_start_auto_complete(GeanyEditor *editor, gint pos, gboolean forc
 			 * editor_prefs.symbolcompletion_min_chars'th char */
 			if (force || rootlen >= editor_prefs.symbolcompletion_min_chars)
 			{
+				/* the list is narrowed down by Scintilla as the word grows */
+				if (!force && autocomplete_list_matches(sci, pos, root, rootlen))
+					ret = TRUE;
 				/* complete tags, except if forcing when completion is already visible */
-				if (!(force && SSM(sci, SCI_AUTOCACTIVE, 0, 0)))
+				else if (!(force && SSM(sci, SCI_AUTOCACTIVE, 0, 0)))
 					ret = autocomplete_tags(editor, root, rootlen);
 
 				/* If forcing and there's nothing else to show, complete from words in document */
@@ -2620,6 +2743,7 @@ void editor_show_macro_list(GeanyEditor *editor)
 	if (words == NULL)
 		return;
 
+	SSM(editor->sci, SCI_AUTOCSETORDER, SC_ORDER_PRESORTED, 0);
 	SSM(editor->sci, SCI_USERLISTSHOW, 1, (sptr_t) words->str);
 	g_string_free(words, TRUE);
 }
@@ -3314,38 +3438,24 @@ void editor_do_comment(GeanyEditor *editor, gint line, gboolean allow_empty_line
 }
 
 
-static gboolean brace_timeout_active = FALSE;
-
-static gboolean delay_match_brace(G_GNUC_UNUSED gpointer user_data)
+static void editor_highlight_braces(GeanyEditor *editor, gint cur_pos)
 {
-	GeanyDocument *doc = document_get_current();
-	GeanyEditor *editor;
-	gint brace_pos = GPOINTER_TO_INT(user_data);
-	gint end_pos, cur_pos;
-
-	brace_timeout_active = FALSE;
-	if (!doc)
-		return FALSE;
+	gint brace_pos = cur_pos - 1;
+	gint end_pos;
 
-	editor = doc->editor;
-	cur_pos = sci_get_current_position(editor->sci) - 1;
+	SSM(editor->sci, SCI_SETHIGHLIGHTGUIDE, 0, 0);
+	SSM(editor->sci, SCI_BRACEBADLIGHT, (uptr_t)-1, 0);
 
-	if (cur_pos != brace_pos)
+	if (! utils_isbrace(sci_get_char_at(editor->sci, brace_pos), editor_prefs.brace_match_ltgt))
 	{
-		cur_pos++;
-		if (cur_pos != brace_pos)
+		brace_pos++;
+		if (! utils_isbrace(sci_get_char_at(editor->sci, brace_pos), editor_prefs.brace_match_ltgt))
 		{
-			/* we have moved past the original brace_pos, but after the timeout
-			 * we may now be on a new brace, so check again */
-			editor_highlight_braces(editor, cur_pos);
-			return FALSE;
+			return;
 		}
 	}
-	if (!utils_isbrace(sci_get_char_at(editor->sci, brace_pos), editor_prefs.brace_match_ltgt))
-	{
-		editor_highlight_braces(editor, cur_pos);
-		return FALSE;
-	}
+	/* Scintilla keeps an index of the braces on each line, so this doesn't scan the text
+	 * up to the matching brace and needn't be delayed while scrolling */
 	end_pos = sci_find_matching_brace(editor->sci, brace_pos);
 
 	if (end_pos >= 0)
@@ -3360,31 +3470,6 @@ static gboolean delay_match_brace(G_GNUC_UNUSED gpointer user_data)
 		SSM(editor->sci, SCI_SETHIGHLIGHTGUIDE, 0, 0);
 		SSM(editor->sci, SCI_BRACEBADLIGHT, brace_pos, 0);
 	}
-	return FALSE;
-}
-
-
-static void editor_highlight_braces(GeanyEditor *editor, gint cur_pos)
-{
-	gint brace_pos = cur_pos - 1;
-
-	SSM(editor->sci, SCI_SETHIGHLIGHTGUIDE, 0, 0);
-	SSM(editor->sci, SCI_BRACEBADLIGHT, (uptr_t)-1, 0);
-
-	if (! utils_isbrace(sci_get_char_at(editor->sci, brace_pos), editor_prefs.brace_match_ltgt))
-	{
-		brace_pos++;
-		if (! utils_isbrace(sci_get_char_at(editor->sci, brace_pos), editor_prefs.brace_match_ltgt))
-		{
-			return;
-		}
-	}
-	if (!brace_timeout_active)
-	{
-		brace_timeout_active = TRUE;
-		/* delaying matching makes scrolling faster e.g. holding down arrow keys */
-		g_timeout_add(100, delay_match_brace, GINT_TO_POINTER(brace_pos));
-	}
 }
 
 
@@ -3813,32 +3898,192 @@ void editor_select_indent_block(GeanyEditor *editor)
 }
 
 
-/* simple indentation to indent the current line with the same indent as the previous one */
-static void smart_line_indentation(GeanyEditor *editor, gint first_line, gint last_line)
+/* Writes the new text of @a line into @a out, given its current @a text without the line
+ * ending. Returns FALSE to leave the line unchanged. */
+typedef gboolean (*LineTransformFunc) (const gchar *text, gsize len, gint line, GString *out,
+		gpointer data);
+
+typedef struct TextEdit
 {
-	gint i, sel_start = 0, sel_end = 0;
+	gint	start;		/* range to replace */
+	gint	end;
+	gsize	offset;		/* of the replacement in the inserted text */
+	gsize	length;
+}
+TextEdit;
 
-	/* get previous line and use it for read_indent to use that line
-	 * (otherwise it would fail on a line only containing "{" in advanced indentation mode) */
-	read_indent(editor, sci_get_position_from_line(editor->sci, first_line - 1));
 
-	for (i = first_line; i <= last_line; i++)
+static gboolean is_utf8_continuation(gchar c)
+{
+	return ((guchar) c & 0xC0) == 0x80;
+}
+
+
+/* Runs @a func over the lines from @a first_line to @a last_line, reading the text in place,
+ * and replaces only the parts of each line that differ. The replacements are one undo action
+ * and only the first one is sent as a modification notification, so bulk commands don't pay
+ * for handling a notification per edit.
+ * Returns whether the text was changed. */
+static gboolean transform_lines(GeanyEditor *editor, gint first_line, gint last_line,
+		LineTransformFunc func, gpointer data)
+{
+	ScintillaObject *sci = editor->sci;
+	gint first_pos, last_pos, line, i;
+	const gchar *buffer;
+	GString *out, *inserted;
+	GArray *edits;
+	gboolean changed;
+
+	first_pos = sci_get_position_from_line(sci, first_line);
+	last_pos = sci_get_line_end_position(sci, last_line);
+	/* valid until the text is modified */
+	buffer = (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, first_pos, last_pos - first_pos);
+
+	out = g_string_new(NULL);
+	inserted = g_string_new(NULL);
+	edits = g_array_new(FALSE, FALSE, sizeof(TextEdit));
+	for (line = first_line; line <= last_line; line++)
 	{
-		/* skip the first line or if the indentation of the previous and current line are equal */
-		if (i == 0 ||
-			SSM(editor->sci, SCI_GETLINEINDENTATION, i - 1, 0) ==
-			SSM(editor->sci, SCI_GETLINEINDENTATION, i, 0))
+		gint start = sci_get_position_from_line(sci, line);
+		gsize len = sci_get_line_end_position(sci, line) - start;
+		const gchar *text = buffer + start - first_pos;
+		gsize prefix = 0, suffix = 0;
+		TextEdit edit;
+
+		g_string_truncate(out, 0);
+		if (! func(text, len, line, out, data) ||
+			(out->len == len && memcmp(out->str, text, len) == 0))
 			continue;
 
-		sel_start = SSM(editor->sci, SCI_POSITIONFROMLINE, i, 0);
-		sel_end = SSM(editor->sci, SCI_GETLINEINDENTPOSITION, i, 0);
-		if (sel_start < sel_end)
+		/* only replace the differing part, keeping whole characters */
+		while (prefix < len && prefix < out->len && text[prefix] == out->str[prefix])
+			prefix++;
+		while (prefix > 0 && prefix < len && is_utf8_continuation(text[prefix]))
+			prefix--;
+		while (suffix < len - prefix && suffix < out->len - prefix &&
+			text[len - 1 - suffix] == out->str[out->len - 1 - suffix])
+			suffix++;
+		while (suffix > 0 && is_utf8_continuation(text[len - suffix]))
+			suffix--;
+
+		edit.start = start + prefix;
+		edit.end = start + len - suffix;
+		edit.offset = inserted->len;
+		edit.length = out->len - prefix - suffix;
+		g_string_append_len(inserted, out->str + prefix, edit.length);
+		g_array_append_val(edits, edit);
+	}
+
+	changed = edits->len > 0;
+	if (changed)
+	{
+		gint mask = SSM(sci, SCI_GETMODEVENTMASK, 0, 0);
+		gint line_count = sci_get_line_count(sci);
+#ifdef HAVE_PLUGINS
+		gint length = sci_get_length(sci);
+#endif
+		TextEdit *edit;
+
+		/* the edit starting the undo action is still notified so it is added to the
+		 * document's undo stack, and fold level changes so on_editor_notify() keeps
+		 * the fold state consistent, e.g. expanding a removed fold point */
+		SSM(sci, SCI_SETMODEVENTMASK, SC_STARTACTION | SC_MOD_CHANGEFOLD, 0);
+		sci_start_undo_action(sci);
+		/* from the end so the positions of the remaining edits stay valid */
+		for (i = edits->len - 1; i >= 0; i--)
 		{
-			sci_set_selection(editor->sci, sel_start, sel_end);
-			sci_replace_sel(editor->sci, "");
+			edit = &g_array_index(edits, TextEdit, i);
+			sci_set_target_start(sci, edit->start);
+			sci_set_target_end(sci, edit->end);
+			SSM(sci, SCI_REPLACETARGET, edit->length, (sptr_t) (inserted->str + edit->offset));
 		}
-		sci_insert_text(editor->sci, sel_start, indent);
+		sci_end_undo_action(sci);
+		SSM(sci, SCI_SETMODEVENTMASK, mask, 0);
+
+		/* what on_editor_notify() does for each modification */
+		if (editor_prefs.show_linenumber_margin && sci_get_line_count(sci) != line_count)
+			auto_update_margin_width(editor);
+		document_update_tag_list_in_idle(editor->document);
+#ifdef HAVE_PLUGINS
+		/* edit is now the first edit; add the changed range from it to the end of the last */
+		plugin_document_changes_add(editor->document, edit->start,
+			sci_get_line_count(sci) - line_count);
+		edit = &g_array_index(edits, TextEdit, edits->len - 1);
+		plugin_document_changes_add(editor->document,
+			edit->end + sci_get_length(sci) - length, 0);
+#endif
 	}
+	g_array_free(edits, TRUE);
+	g_string_free(inserted, TRUE);
+	g_string_free(out, TRUE);
+	return changed;
+}
+
+
+/* Returns the width of the indentation of @a text, setting @a indent_len to its length. */
+static gint get_text_indent_width(const gchar *text, gsize len, gint tab_width, gsize *indent_len)
+{
+	gint width = 0;
+	gsize i;
+
+	for (i = 0; i < len; i++)
+	{
+		if (text[i] == ' ')
+			width++;
+		else if (text[i] == '\t')
+			width = (width / tab_width + 1) * tab_width;
+		else
+			break;
+	}
+	*indent_len = i;
+	return width;
+}
+
+
+typedef struct SmartIndentData
+{
+	gint tab_width;
+	gint indent_width;	/* of the indent buffer */
+	gint prev_width;	/* of the previous line, after it was transformed */
+}
+SmartIndentData;
+
+
+static gboolean smart_indent_line(const gchar *text, gsize len, gint line, GString *out,
+		gpointer data)
+{
+	SmartIndentData *sid = data;
+	gsize indent_len;
+	gint width = get_text_indent_width(text, len, sid->tab_width, &indent_len);
+	gint prev_width = sid->prev_width;
+
+	sid->prev_width = width;
+	/* skip the first line or if the indentation of the previous and current line are equal */
+	if (line == 0 || width == prev_width)
+		return FALSE;
+
+	g_string_append(out, indent);
+	g_string_append_len(out, text + indent_len, len - indent_len);
+	sid->prev_width = sid->indent_width;
+	return TRUE;
+}
+
+
+/* simple indentation to indent the current line with the same indent as the previous one */
+static void smart_line_indentation(GeanyEditor *editor, gint first_line, gint last_line)
+{
+	SmartIndentData sid;
+	gsize indent_len;
+
+	/* get previous line and use it for read_indent to use that line
+	 * (otherwise it would fail on a line only containing "{" in advanced indentation mode) */
+	read_indent(editor, sci_get_position_from_line(editor->sci, first_line - 1));
+
+	sid.tab_width = sci_get_tab_width(editor->sci);
+	sid.indent_width = get_text_indent_width(indent, strlen(indent), sid.tab_width, &indent_len);
+	sid.prev_width = (first_line > 0) ?
+		sci_get_line_indentation(editor->sci, first_line - 1) : 0;
+	transform_lines(editor, first_line, last_line, smart_indent_line, &sid);
 }
 
 
@@ -4259,24 +4504,19 @@ const gchar *editor_get_eol_char(GeanyEditor *editor)
 
 static void fold_all(GeanyEditor *editor, gboolean want_fold)
 {
-	gint lines, first, i;
+	gint first;
 
 	if (editor == NULL || ! editor_prefs.folding)
 		return;
 
-	lines = sci_get_line_count(editor->sci);
 	first = sci_get_first_visible_line(editor->sci);
 
-	for (i = 0; i < lines; i++)
-	{
-		gint level = sci_get_fold_level(editor->sci, i);
+	/* Scintilla styles the whole document and updates all the fold points at once */
+	if (want_fold)
+		sci_fold_to_level(editor->sci, 0);	/* nested fold points too */
+	else
+		sci_fold_all(editor->sci, SC_FOLDACTION_EXPAND);
 
-		if (level & SC_FOLDLEVELHEADERFLAG)
-		{
-			if (sci_get_fold_expanded(editor->sci, i) == want_fold)
-					sci_toggle_fold(editor->sci, i);
-		}
-	}
 	editor_scroll_to_line(editor, first, 0.0F);
 }
 
@@ -4293,50 +4533,79 @@ void editor_fold_all(GeanyEditor *editor)
 }
 
 
-void editor_replace_tabs(GeanyEditor *editor)
+static gboolean replace_tabs_line(const gchar *text, gsize len, gint line, GString *out,
+		gpointer data)
 {
-	gint search_pos, pos_in_line, current_tab_true_length;
-	gint tab_len;
-	gchar *tab_str;
-	struct Sci_TextToFind ttf;
+	gint tab_len = GPOINTER_TO_INT(data);
+	gint column = 0;
+	gsize i;
+
+	if (memchr(text, '\t', len) == NULL)
+		return FALSE;
 
+	for (i = 0; i < len; i++)
+	{
+		if (text[i] == '\t')
+		{
+			gint spaces = tab_len - (column % tab_len);
+
+			column += spaces;
+			while (spaces-- > 0)
+				g_string_append_c(out, ' ');
+		}
+		else
+		{
+			/* columns count characters, not bytes */
+			if (! is_utf8_continuation(text[i]))
+				column++;
+			g_string_append_c(out, text[i]);
+		}
+	}
+	return TRUE;
+}
+
+
+void editor_replace_tabs(GeanyEditor *editor)
+{
 	g_return_if_fail(editor != NULL);
 
-	sci_start_undo_action(editor->sci);
-	tab_len = sci_get_tab_width(editor->sci);
-	ttf.chrg.cpMin = 0;
-	ttf.chrg.cpMax = sci_get_length(editor->sci);
-	ttf.lpstrText = (gchar*) "\t";
+	transform_lines(editor, 0, sci_get_line_count(editor->sci) - 1, replace_tabs_line,
+		GINT_TO_POINTER(sci_get_tab_width(editor->sci)));
+}
 
-	while (TRUE)
-	{
-		search_pos = sci_find_text(editor->sci, SCFIND_MATCHCASE, &ttf);
-		if (search_pos == -1)
-			break;
 
-		pos_in_line = sci_get_col_from_position(editor->sci, search_pos);
-		current_tab_true_length = tab_len - (pos_in_line % tab_len);
-		tab_str = g_strnfill(current_tab_true_length, ' ');
-		sci_set_target_start(editor->sci, search_pos);
-		sci_set_target_end(editor->sci, search_pos + 1);
-		sci_replace_target(editor->sci, tab_str, FALSE);
-		/* next search starts after replacement */
-		ttf.chrg.cpMin = search_pos + current_tab_true_length - 1;
-		/* update end of range now text has changed */
-		ttf.chrg.cpMax += current_tab_true_length - 1;
-		g_free(tab_str);
+static gboolean replace_spaces_line(const gchar *text, gsize len, gint line, GString *out,
+		gpointer data)
+{
+	gsize tab_len = GPOINTER_TO_INT(data);
+	gsize i = 0, j;
+	gboolean changed = FALSE;
+
+	/* only replace indentation because otherwise we can mess up alignment */
+	while (i < len && (text[i] == ' ' || text[i] == '\t'))
+	{
+		j = i;
+		while (j < len && j < i + tab_len && text[j] == ' ')
+			j++;
+		if (j == i + tab_len)
+		{
+			g_string_append_c(out, '\t');
+			i = j;
+			changed = TRUE;
+		}
+		else
+			g_string_append_c(out, text[i++]);
 	}
-	sci_end_undo_action(editor->sci);
+	g_string_append_len(out, text + i, len - i);
+	return changed;
 }
 
 
 /* Replaces all occurrences all spaces of the length of a given tab_width. */
 void editor_replace_spaces(GeanyEditor *editor)
 {
-	gint search_pos;
 	static gdouble tab_len_f = -1.0; /* keep the last used value */
 	gint tab_len;
-	struct Sci_TextToFind ttf;
 
 	g_return_if_fail(editor != NULL);
 
@@ -4352,91 +4621,67 @@ void editor_replace_spaces(GeanyEditor *editor)
 	}
 	tab_len = (gint) tab_len_f;
 
-	sci_start_undo_action(editor->sci);
-	ttf.chrg.cpMin = 0;
-	ttf.chrg.cpMax = sci_get_length(editor->sci);
-	ttf.lpstrText = g_strnfill(tab_len, ' ');
-
-	while (TRUE)
-	{
-		search_pos = sci_find_text(editor->sci, SCFIND_MATCHCASE, &ttf);
-		if (search_pos == -1)
-			break;
-		/* only replace indentation because otherwise we can mess up alignment */
-		if (search_pos > sci_get_line_indent_position(editor->sci,
-			sci_get_line_from_position(editor->sci, search_pos)))
-		{
-			ttf.chrg.cpMin = search_pos + tab_len;
-			continue;
-		}
-		sci_set_target_start(editor->sci, search_pos);
-		sci_set_target_end(editor->sci, search_pos + tab_len);
-		sci_replace_target(editor->sci, "\t", FALSE);
-		ttf.chrg.cpMin = search_pos;
-		/* update end of range now text has changed */
-		ttf.chrg.cpMax -= tab_len - 1;
-	}
-	sci_end_undo_action(editor->sci);
-	g_free(ttf.lpstrText);
+	transform_lines(editor, 0, sci_get_line_count(editor->sci) - 1, replace_spaces_line,
+		GINT_TO_POINTER(tab_len));
 }
 
 
-void editor_strip_line_trailing_spaces(GeanyEditor *editor, gint line)
+static gboolean strip_trailing_spaces_line(const gchar *text, gsize len, gint line, GString *out,
+		gpointer data)
 {
-	gint line_start = sci_get_position_from_line(editor->sci, line);
-	gint line_end = sci_get_line_end_position(editor->sci, line);
-	gint i = line_end - 1;
-	gchar ch = sci_get_char_at(editor->sci, i);
+	gsize end = len;
 
+	while (end > 0 && (text[end - 1] == ' ' || text[end - 1] == '\t'))
+		end--;
+	if (end == len)
+		return FALSE;
+
+	g_string_append_len(out, text, end);
+	return TRUE;
+}
+
+
+static void strip_trailing_spaces(GeanyEditor *editor, gint first_line, gint last_line)
+{
 	/* Diff hunks should keep trailing spaces */
 	if (sci_get_lexer(editor->sci) == SCLEX_DIFF)
 		return;
 
-	while ((i >= line_start) && ((ch == ' ') || (ch == '\t')))
-	{
-		i--;
-		ch = sci_get_char_at(editor->sci, i);
-	}
-	if (i < (line_end - 1))
-	{
-		sci_set_target_start(editor->sci, i + 1);
-		sci_set_target_end(editor->sci, line_end);
-		sci_replace_target(editor->sci, "", FALSE);
-	}
+	transform_lines(editor, first_line, last_line, strip_trailing_spaces_line, NULL);
+}
+
+
+void editor_strip_line_trailing_spaces(GeanyEditor *editor, gint line)
+{
+	strip_trailing_spaces(editor, line, line);
 }
 
 
 void editor_strip_trailing_spaces(GeanyEditor *editor)
 {
-	gint max_lines = sci_get_line_count(editor->sci);
-	gint line;
+	strip_trailing_spaces(editor, 0, sci_get_line_count(editor->sci) - 1);
+}
 
-	sci_start_undo_action(editor->sci);
 
-	for (line = 0; line < max_lines; line++)
-	{
-		editor_strip_line_trailing_spaces(editor, line);
-	}
-	sci_end_undo_action(editor->sci);
+static gboolean append_newline_line(const gchar *text, gsize len, gint line, GString *out,
+		gpointer data)
+{
+	/* a document with only one line always gets a newline */
+	if (len == 0 && line > 0)
+		return FALSE;
+
+	g_string_append_len(out, text, len);
+	g_string_append(out, data);
+	return TRUE;
 }
 
 
 void editor_ensure_final_newline(GeanyEditor *editor)
 {
-	gint max_lines = sci_get_line_count(editor->sci);
-	gboolean append_newline = (max_lines == 1);
-	gint end_document = sci_get_position_from_line(editor->sci, max_lines);
-
-	if (max_lines > 1)
-	{
-		append_newline = end_document > sci_get_position_from_line(editor->sci, max_lines - 1);
-	}
-	if (append_newline)
-	{
-		const gchar *eol = editor_get_eol_char(editor);
+	gint last_line = sci_get_line_count(editor->sci) - 1;
 
-		sci_insert_text(editor->sci, end_document, eol);
-	}
+	transform_lines(editor, last_line, last_line, append_newline_line,
+		(gpointer) editor_get_eol_char(editor));
 }
 
 
@@ -4601,6 +4846,23 @@ on_editor_scroll_event(GtkWidget *widget, GdkEventScroll *event, gpointer user_d
 }
 
 
+/* Colourises the text up to a screen beyond the visible area from scratch. The rest of the
+ * document is styled later in idle time (see SCI_SETIDLESTYLING in create_new_sci()), so
+ * switching to a huge document doesn't block until the whole document is lexed. */
+static void colourise_visible(ScintillaObject *sci)
+{
+	gint vis_first = SSM(sci, SCI_GETFIRSTVISIBLELINE, 0, 0);
+	gint los = SSM(sci, SCI_LINESONSCREEN, 0, 0);
+	/* the widget may not be allocated yet, so colourise a reasonable amount anyway */
+	gint last_line = SSM(sci, SCI_DOCLINEFROMVISIBLE, vis_first + MAX(los, 50) * 2, 0);
+
+	if (last_line + 1 >= sci_get_line_count(sci))
+		sci_colourise(sci, 0, -1);
+	else
+		sci_colourise(sci, 0, sci_get_position_from_line(sci, last_line + 1));
+}
+
+
 static gboolean editor_check_colourise(GeanyEditor *editor)
 {
 	GeanyDocument *doc = editor->document;
@@ -4609,12 +4871,12 @@ static gboolean editor_check_colourise(GeanyEditor *editor)
 		return FALSE;
 
 	doc->priv->colourise_needed = FALSE;
-	sci_colourise(editor->sci, 0, -1);
+	colourise_visible(editor->sci);
 
-	/* now that the current document is colourised, fold points are now accurate,
+	/* now that the visible part of the document is colourised, fold points there are accurate,
 	 * so force an update of the current function/tag. */
 	symbols_get_current_function(NULL, NULL);
-	ui_update_statusbar(NULL, -1);
+	ui_queue_update(GEANY_UI_UPDATE_STATUSBAR);
 
 	return TRUE;
 }
@@ -4750,6 +5012,8 @@ static ScintillaObject *create_new_sci(GeanyEditor *editor)
 	/*sci_set_caret_policy_y(sci, CARET_JUMPS | CARET_EVEN, 0);*/
 	SSM(sci, SCI_AUTOCSETSEPARATOR, '\n', 0);
 	SSM(sci, SCI_SETSCROLLWIDTHTRACKING, 1, 0);
+	/* style the part of the document after the visible area in the background */
+	SSM(sci, SCI_SETIDLESTYLING, SC_IDLESTYLING_AFTERVISIBLE, 0);
 
 	/* tag autocompletion images */
 	register_named_icon(sci, 1, "classviewer-var");
@@ -4993,6 +5257,9 @@ void editor_apply_update_prefs(GeanyEditor *editor)
 	sci_set_scroll_stop_at_last_line(sci, editor_prefs.scroll_stop_at_last_line);
 
 	sci_set_scrollbar_mode(sci, editor_prefs.show_scrollbars);
+
+	sci_set_undo_memory_limit(sci, MIN(editor_prefs.undo_memory_limit, G_MAXINT / (1024 * 1024))
+		* 1024 * 1024);
 }
 
 
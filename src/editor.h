@@ -148,6 +148,9 @@ typedef struct GeanyEditorPrefs
 	/* This setting may be overridden when a project is opened. Use @c editor_get_prefs(). */
 	gboolean	long_line_enabled;
 	gint		autocompletion_update_freq;
+	gint		undo_memory_limit;	/* in MiB, 0 for no limit (hidden pref) */
+	gboolean	autocomplete_fuzzy;	/* hidden pref */
+	gint		chunked_storage_size;	/* in MiB, 0 to never store text in chunks (hidden pref) */
 }
 GeanyEditorPrefs;
 
@@ -0,0 +1,273 @@
+/*
+ *      filewatch.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Watches the files of open documents for changes on disk.
+ *
+ * There is one GIO directory monitor (inotify based on Linux) for each directory containing
+ * open files, rather than a monitor for each file, so that files replaced by renaming are
+ * still noticed. Change events are collected until there have been none for a short while
+ * and then passed to document_files_changed() together, so that e.g. checking out a branch
+ * touching many open files asks only once whether to reload them.
+ */
+
+#include "geany.h"
+
+#include <string.h>
+#include <gio/gio.h>
+
+#include "filewatch.h"
+#include "document.h"
+
+
+#define WATCH_DELAY 250			/* milliseconds without events before reporting changes */
+#define WATCH_MAX_DELAY 2.0		/* seconds to report changes after at the latest */
+
+
+typedef struct WatchedDir
+{
+	gchar *path;			/* locale encoding */
+	GFile *file;
+	GFileMonitor *monitor;
+	GHashTable *docs;		/* base name -> GeanyDocument */
+}
+WatchedDir;
+
+typedef struct WatchedFile
+{
+	WatchedDir *dir;
+	gchar *name;
+}
+WatchedFile;
+
+static struct
+{
+	GHashTable *dirs;		/* directory path -> WatchedDir */
+	GHashTable *files;		/* GeanyDocument -> WatchedFile */
+	GHashTable *pending;	/* GeanyDocuments with changes not yet reported */
+	GTimer *pending_timer;	/* since the first pending change */
+	guint timeout_id;
+	gboolean reporting;
+}
+state;
+
+
+static void free_dir(gpointer data)
+{
+	WatchedDir *dir = data;
+
+	g_file_monitor_cancel(dir->monitor);
+	g_object_unref(dir->monitor);
+	g_object_unref(dir->file);
+	g_hash_table_destroy(dir->docs);
+	g_free(dir->path);
+	g_free(dir);
+}
+
+
+static void free_file(gpointer data)
+{
+	WatchedFile *file = data;
+
+	g_free(file->name);
+	g_free(file);
+}
+
+
+static gboolean on_watch_timeout(gpointer data)
+{
+	GPtrArray *docs;
+	GHashTableIter iter;
+	gpointer doc;
+
+	/* the changes reported last are still being handled, e.g. in a prompt */
+	if (state.reporting)
+		return TRUE;
+
+	state.timeout_id = 0;
+	docs = g_ptr_array_sized_new(g_hash_table_size(state.pending));
+	g_hash_table_iter_init(&iter, state.pending);
+	while (g_hash_table_iter_next(&iter, &doc, NULL))
+		g_ptr_array_add(docs, doc);
+	g_hash_table_remove_all(state.pending);
+
+	state.reporting = TRUE;
+	document_files_changed(docs);
+	state.reporting = FALSE;
+
+	g_ptr_array_free(docs, TRUE);
+	return FALSE;
+}
+
+
+static void add_pending(GeanyDocument *doc)
+{
+	if (g_hash_table_size(state.pending) == 0)
+		g_timer_start(state.pending_timer);
+	g_hash_table_insert(state.pending, doc, doc);
+
+	/* wait for the events to stop, but not forever if a file keeps changing */
+	if (state.timeout_id != 0)
+	{
+		if (g_timer_elapsed(state.pending_timer, NULL) > WATCH_MAX_DELAY)
+			return;
+		g_source_remove(state.timeout_id);
+	}
+	state.timeout_id = g_timeout_add(WATCH_DELAY, on_watch_timeout, NULL);
+}
+
+
+static void on_dir_changed(G_GNUC_UNUSED GFileMonitor *monitor, GFile *file,
+		G_GNUC_UNUSED GFile *other_file, GFileMonitorEvent event, gpointer user_data)
+{
+	WatchedDir *dir = user_data;
+
+	switch (event)
+	{
+		case G_FILE_MONITOR_EVENT_CHANGED:
+		case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+		case G_FILE_MONITOR_EVENT_DELETED:
+		case G_FILE_MONITOR_EVENT_CREATED:
+			break;
+		default:
+			return;
+	}
+
+	if (g_file_equal(file, dir->file))
+	{
+		GHashTableIter iter;
+		gpointer doc;
+
+		/* the directory itself was deleted or replaced */
+		g_hash_table_iter_init(&iter, dir->docs);
+		while (g_hash_table_iter_next(&iter, NULL, &doc))
+			add_pending(doc);
+	}
+	else
+	{
+		gchar *name = g_file_get_basename(file);
+		GeanyDocument *doc = g_hash_table_lookup(dir->docs, name);
+
+		if (doc != NULL)
+			add_pending(doc);
+		g_free(name);
+	}
+}
+
+
+static WatchedDir *get_dir(const gchar *path)
+{
+	WatchedDir *dir = g_hash_table_lookup(state.dirs, path);
+	GFileMonitor *monitor;
+	GFile *file;
+
+	if (dir != NULL)
+		return dir;
+
+	file = g_file_new_for_path(path);
+	monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, NULL);
+	if (monitor == NULL)
+	{
+		g_object_unref(file);
+		return NULL;
+	}
+	dir = g_new0(WatchedDir, 1);
+	dir->path = g_strdup(path);
+	dir->file = file;
+	dir->monitor = monitor;
+	dir->docs = g_hash_table_new(g_str_hash, g_str_equal);
+	g_signal_connect(monitor, "changed", G_CALLBACK(on_dir_changed), dir);
+	g_hash_table_insert(state.dirs, dir->path, dir);
+	return dir;
+}
+
+
+/* Starts watching the file of doc, replacing any previous watch of it.
+ * @return @c FALSE if the file can't be watched and has to be checked by polling instead. */
+gboolean file_watch_add(GeanyDocument *doc)
+{
+	WatchedDir *dir;
+	WatchedFile *file;
+	gchar *dir_path, *name;
+
+	g_return_val_if_fail(doc != NULL, FALSE);
+
+	file_watch_remove(doc);
+	if (doc->real_path == NULL)
+		return FALSE;
+
+	if (state.dirs == NULL)
+	{
+		state.dirs = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_dir);
+		state.files = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_file);
+		state.pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+		state.pending_timer = g_timer_new();
+	}
+
+	dir_path = g_path_get_dirname(doc->real_path);
+	name = g_path_get_basename(doc->real_path);
+	dir = get_dir(dir_path);
+	g_free(dir_path);
+	/* two documents can have the same real path through symlinks */
+	if (dir == NULL || g_hash_table_lookup(dir->docs, name) != NULL)
+	{
+		g_free(name);
+		return FALSE;
+	}
+
+	file = g_new0(WatchedFile, 1);
+	file->dir = dir;
+	file->name = name;
+	g_hash_table_insert(dir->docs, file->name, doc);
+	g_hash_table_insert(state.files, doc, file);
+	return TRUE;
+}
+
+
+void file_watch_remove(GeanyDocument *doc)
+{
+	WatchedFile *file;
+	WatchedDir *dir;
+
+	if (state.files == NULL || (file = g_hash_table_lookup(state.files, doc)) == NULL)
+		return;
+
+	g_hash_table_remove(state.pending, doc);
+	dir = file->dir;
+	g_hash_table_remove(dir->docs, file->name);
+	if (g_hash_table_size(dir->docs) == 0)
+		g_hash_table_remove(state.dirs, dir->path);
+	g_hash_table_remove(state.files, doc);
+}
+
+
+void file_watch_finalize(void)
+{
+	if (state.timeout_id != 0)
+		g_source_remove(state.timeout_id);
+	if (state.dirs == NULL)
+		return;
+
+	g_hash_table_destroy(state.files);
+	g_hash_table_destroy(state.dirs);
+	g_hash_table_destroy(state.pending);
+	g_timer_destroy(state.pending_timer);
+	memset(&state, 0, sizeof(state));
+}
@@ -469,11 +469,12 @@ static GString *get_global_typenames(gint lang)
 
 	if (app->tm_workspace)
 	{
-		GPtrArray *tags_array = app->tm_workspace->global_tags;
+		/* only the tags of lang are needed */
+		const GPtrArray *tags_array = tm_workspace_get_global_tags(lang);
 
 		if (tags_array)
 		{
-			s = symbols_find_tags_as_string(tags_array, TM_GLOBAL_TYPE_MASK, lang);
+			s = symbols_find_tags_as_string((GPtrArray *) tags_array, TM_GLOBAL_TYPE_MASK, lang);
 		}
 	}
 	return s;
@@ -72,6 +72,23 @@ static GeanyKeyBinding binding_ids[GEANY_KEYS_COUNT];
 static GtkAccelGroup *kb_accel_group = NULL;
 static const gboolean swap_alt_tab_order = FALSE;
 
+/* A binding with its group, see get_key_table() */
+typedef struct KeyBindingRef
+{
+	GeanyKeyGroup	*group;
+	GeanyKeyBinding	*kb;
+}
+KeyBindingRef;
+
+/* KEY_TABLE_HASH(keyval, mods):GArray<KeyBindingRef> of the bindings in visual order,
+ * rebuilt on the first key press after key_table_dirty is set */
+static GHashTable *key_table = NULL;
+static gboolean key_table_dirty = TRUE;
+
+#define KEY_TABLE_HASH(keyval, mods) GUINT_TO_POINTER((keyval) ^ ((guint) (mods) << 16))
+
+static guint disk_check_source = 0;
+
 
 /* central keypress event handler, almost all keypress events go to this function */
 static gboolean on_key_press_event(GtkWidget *widget, GdkEventKey *event, gpointer user_data);
@@ -175,6 +192,7 @@ GeanyKeyBinding *keybindings_set_item(GeanyKeyGroup *group, gsize key_id,
 	kb->callback = callback;
 	kb->menu_item = menu_item;
 	kb->id = key_id;
+	key_table_dirty = TRUE;
 	return kb;
 }
 
@@ -189,6 +207,7 @@ static void add_kb_group(GeanyKeyGroup *group,
 	group->callback = callback;
 	group->plugin = plugin;
 	group->key_items = g_ptr_array_new();
+	key_table_dirty = TRUE;
 }
 
 
@@ -660,6 +679,7 @@ static void load_kb(GeanyKeyGroup *group, GeanyKeyBinding *kb, gpointer user_dat
 		gtk_accelerator_parse(val, &key, &mods);
 		kb->key = key;
 		kb->mods = mods;
+		key_table_dirty = TRUE;
 		g_free(val);
 	}
 }
@@ -808,6 +828,11 @@ void keybindings_free(void)
 		keybindings_free_group(group);
 
 	g_ptr_array_free(keybinding_groups, TRUE);
+
+	if (key_table != NULL)
+		g_hash_table_destroy(key_table);
+	if (disk_check_source != 0)
+		g_source_remove(disk_check_source);
 }
 
 
@@ -1186,21 +1211,81 @@ gboolean keybindings_check_event(GdkEventKey *ev, GeanyKeyBinding *kb)
 }
 
 
+static void free_key_table_value(gpointer data)
+{
+	g_array_free(data, TRUE);
+}
+
+
+/* returns the table of bindings by key combination, so that a key press doesn't have to
+ * compare itself with every binding */
+static GHashTable *get_key_table(void)
+{
+	gsize g, i;
+	GeanyKeyGroup *group;
+	GeanyKeyBinding *kb;
+
+	if (! key_table_dirty)
+		return key_table;
+
+	if (key_table != NULL)
+		g_hash_table_destroy(key_table);
+	key_table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_key_table_value);
+
+	foreach_ptr_array(group, g, keybinding_groups)
+	{
+		foreach_ptr_array(kb, i, group->key_items)
+		{
+			gpointer hash = KEY_TABLE_HASH(kb->key, kb->mods);
+			GArray *refs;
+			KeyBindingRef ref;
+
+			if (kb->key == 0)
+				continue;
+
+			refs = g_hash_table_lookup(key_table, hash);
+			if (refs == NULL)
+			{
+				refs = g_array_new(FALSE, FALSE, sizeof(KeyBindingRef));
+				g_hash_table_insert(key_table, hash, refs);
+			}
+			ref.group = group;
+			ref.kb = kb;
+			g_array_append_val(refs, ref);
+		}
+	}
+	key_table_dirty = FALSE;
+	return key_table;
+}
+
+
+static gboolean check_disk_status_timeout(G_GNUC_UNUSED gpointer data)
+{
+	GeanyDocument *doc = document_get_current();
+
+	disk_check_source = 0;
+	if (doc != NULL)
+		document_check_disk_status(doc, FALSE);
+	return FALSE;
+}
+
+
 /* central keypress event handler, almost all keypress events go to this function */
 static gboolean on_key_press_event(GtkWidget *widget, GdkEventKey *ev, gpointer user_data)
 {
 	guint state, keyval;
-	gsize g, i;
+	guint i;
 	GeanyDocument *doc;
-	GeanyKeyGroup *group;
-	GeanyKeyBinding *kb;
+	GArray *refs;
 
 	if (ev->keyval == 0)
 		return FALSE;
 
 	doc = document_get_current();
-	if (doc)
-		document_check_disk_status(doc, FALSE);
+	/* check the document on disk after handling the key press rather than on each of them */
+	if (doc && disk_check_source == 0)
+		disk_check_source = g_timeout_add_full(G_PRIORITY_LOW, 500, check_disk_status_timeout,
+			NULL, NULL);
 
 	keyval = ev->keyval;
 	state = ev->state & gtk_accelerator_get_default_mod_mask();
@@ -1222,27 +1307,29 @@ static gboolean on_key_press_event(GtkWidget *widget, GdkEventKey *ev, gpointer
 	if (check_menu_key(doc, keyval, state, ev->time))
 		return TRUE;
 
-	foreach_ptr_array(group, g, keybinding_groups)
+	refs = g_hash_table_lookup(get_key_table(), KEY_TABLE_HASH(keyval, state));
+	for (i = 0; refs != NULL && i < refs->len; i++)
 	{
-		foreach_ptr_array(kb, i, group->key_items)
+		KeyBindingRef *ref = &g_array_index(refs, KeyBindingRef, i);
+		GeanyKeyGroup *group = ref->group;
+		GeanyKeyBinding *kb = ref->kb;
+
+		if (keyval == kb->key && state == kb->mods)
 		{
-			if (keyval == kb->key && state == kb->mods)
+			/* call the corresponding callback function for this shortcut */
+			if (kb->callback)
 			{
-				/* call the corresponding callback function for this shortcut */
-				if (kb->callback)
-				{
-					kb->callback(kb->id);
+				kb->callback(kb->id);
+				return TRUE;
+			}
+			else if (group->callback)
+			{
+				if (group->callback(kb->id))
 					return TRUE;
-				}
-				else if (group->callback)
-				{
-					if (group->callback(kb->id))
-						return TRUE;
-					else
-						continue;	/* not handled */
-				}
-				g_warning("No callback for keybinding %s: %s!", group->name, kb->name);
+				else
+					continue;	/* not handled */
 			}
+			g_warning("No callback for keybinding %s: %s!", group->name, kb->name);
 		}
 	}
 	/* fixed keybindings can be overridden by user bindings, so check them last */
@@ -2456,6 +2543,7 @@ void keybindings_update_combo(GeanyKeyBinding *kb, guint key, GdkModifierType mo
 
 	kb->key = key;
 	kb->mods = mods;
+	key_table_dirty = TRUE;
 
 	if (widget && kb->key)
 		gtk_widget_add_accelerator(widget, "activate", kb_accel_group,
@@ -2482,6 +2570,7 @@ GeanyKeyGroup *keybindings_set_group(GeanyKeyGroup *group, const gchar *section_
 	group->plugin_keys = g_new0(GeanyKeyBinding, count);
 	group->plugin_key_count = count;
 	g_ptr_array_set_size(group->key_items, 0);
+	key_table_dirty = TRUE;
 	return group;
 }
 
@@ -2491,6 +2580,7 @@ void keybindings_free_group(GeanyKeyGroup *group)
 	GeanyKeyBinding *kb;
 
 	g_ptr_array_free(group->key_items, TRUE);
+	key_table_dirty = TRUE;
 
 	if (group->plugin)
 	{
@@ -83,6 +83,8 @@
 #define GEANY_TOGGLE_MARK				"~ "
 #define GEANY_MAX_AUTOCOMPLETE_WORDS	30
 #define GEANY_MAX_SYMBOLS_UPDATE_FREQ	250
+#define GEANY_DEFAULT_UNDO_MEMORY_LIMIT	256
+#define GEANY_DEFAULT_CHUNKED_STORAGE_SIZE	64
 #define GEANY_DEFAULT_FILETYPE_REGEX    "-\\*-\\s*([^\\s]+)\\s*-\\*-"
 
 
@@ -214,6 +216,12 @@ static void init_pref_groups(void)
 		"use_gtk_word_boundaries", TRUE);
 	stash_group_add_boolean(group, &editor_prefs.complete_snippets_whilst_editing,
 		"complete_snippets_whilst_editing", FALSE);
+	stash_group_add_integer(group, &editor_prefs.undo_memory_limit,
+		"undo_memory_limit", GEANY_DEFAULT_UNDO_MEMORY_LIMIT);
+	stash_group_add_boolean(group, &editor_prefs.autocomplete_fuzzy,
+		"autocomplete_fuzzy", FALSE);
+	stash_group_add_integer(group, &editor_prefs.chunked_storage_size,
+		"chunked_storage_size", GEANY_DEFAULT_CHUNKED_STORAGE_SIZE);
 	stash_group_add_boolean(group, &file_prefs.use_safe_file_saving,
 		atomic_file_saving_key, FALSE);
 	stash_group_add_boolean(group, &file_prefs.gio_unsafe_save_backup,
@@ -227,6 +235,8 @@ static void init_pref_groups(void)
 		"find_selection_type", GEANY_FIND_SEL_CURRENT_WORD);
 	stash_group_add_string(group, &file_prefs.extract_filetype_regex,
 		"extract_filetype_regex", GEANY_DEFAULT_FILETYPE_REGEX);
+	stash_group_add_boolean(group, &project_prefs.project_index_files,
+		"project_index_files", TRUE);
 
 	/* Note: Interface-related various prefs are in ui_init_prefs() */
 
@@ -108,6 +108,7 @@ static gchar *lib_vte = NULL;
 #endif
 static gboolean generate_tags = FALSE;
 static gboolean no_preprocessing = FALSE;
+static gint generate_tags_jobs = 1;
 static gboolean ft_names = FALSE;
 static gboolean print_prefix = FALSE;
 #ifdef HAVE_PLUGINS
@@ -128,6 +129,7 @@ static GOptionEntry entries[] =
 	{ "socket-file", 0, 0, G_OPTION_ARG_FILENAME, &cl_options.socket_filename, N_("Use this socket filename for communication with a running Geany instance"), NULL },
 	{ "list-documents", 0, 0, G_OPTION_ARG_NONE, &cl_options.list_documents, N_("Return a list of open documents in a running Geany instance"), NULL },
 #endif
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &generate_tags_jobs, N_("Use this many processes to parse files when generating tags"), NULL },
 	{ "line", 'l', 0, G_OPTION_ARG_INT, &cl_options.goto_line, N_("Set initial line number for the first opened file"), NULL },
 	{ "no-msgwin", 'm', 0, G_OPTION_ARG_NONE, &no_msgwin, N_("Don't show message window at startup"), NULL },
 	{ "no-ctags", 'n', 0, G_OPTION_ARG_NONE, &ignore_global_tags, N_("Don't load auto completion data (see documentation)"), NULL },
@@ -604,7 +606,7 @@ static void parse_command_line_options(gint *argc, gchar ***argv)
 		gboolean ret;
 
 		filetypes_init_types();
-		ret = symbols_generate_global_tags(*argc, *argv, ! no_preprocessing);
+		ret = symbols_generate_global_tags(*argc, *argv, ! no_preprocessing, generate_tags_jobs);
 		filetypes_free_types();
 		wait_for_input_on_windows();
 		exit(ret);
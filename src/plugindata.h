@@ -54,7 +54,7 @@ G_BEGIN_DECLS
  * @warning You should not test for values below 200 as previously
  * @c GEANY_API_VERSION was defined as an enum value, not a macro.
  */
-#define GEANY_API_VERSION 216
+#define GEANY_API_VERSION 218
 
 /** The Application Binary Interface (ABI) version, incremented whenever
  * existing fields in the plugin data types have to be changed or reordered.
@@ -200,6 +200,27 @@ typedef struct PluginCallback
 PluginCallback;
 
 
+/** Lines changed in a document, passed to a @ref GeanyDocumentChangesFunc.
+ * @see plugin_document_changes_connect().
+ * @since 1.23, plugin API 218. */
+typedef struct GeanyDocumentChanges
+{
+	struct GeanyDocument	*document;	/**< The changed document. */
+	gint	start_line;		/**< The first changed line. */
+	gint	end_line;		/**< The last changed line, in the current text. */
+	gint	lines_added;	/**< The number of lines added, negative if lines were removed. */
+}
+GeanyDocumentChanges;
+
+/** Callback for plugin_document_changes_connect().
+ * @param changes The changed documents, each one listed once.
+ * @param count The number of @a changes.
+ * @param user_data The user data passed to plugin_document_changes_connect().
+ * @since 1.23, plugin API 218. */
+typedef void (*GeanyDocumentChangesFunc) (const GeanyDocumentChanges *changes, guint count,
+		gpointer user_data);
+
+
 /** @deprecated Use @ref ui_add_document_sensitive() instead.
  * Flags to be set by plugins in PluginFields struct. */
 typedef enum
@@ -594,6 +615,8 @@ typedef struct TagManagerFuncs
 					 gboolean recurse, gboolean update_parent);
 	void			(*tm_work_object_free) (gpointer work_object);
 	gboolean		(*tm_workspace_remove_object) (TMWorkObject *w, gboolean do_free, gboolean update);
+	const TMTag*	(*tm_source_file_get_tag_at_line) (TMWorkObject *source_file, gulong line,
+					 guint tag_types);
 }
 TagManagerFuncs;
 
@@ -658,6 +681,8 @@ typedef struct PluginFuncs
 	guint	(*plugin_timeout_add_seconds) (GeanyPlugin *plugin, guint interval,
 		GSourceFunc function, gpointer data);
 	guint	(*plugin_idle_add) (GeanyPlugin *plugin, GSourceFunc function, gpointer data);
+	void	(*plugin_document_changes_connect) (GeanyPlugin *plugin, guint interval,
+		GeanyDocumentChangesFunc callback, gpointer user_data);
 }
 PluginFuncs;
 
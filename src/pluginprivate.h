@@ -55,6 +55,12 @@ typedef struct GeanyPluginPrivate
 	GeanyAutoSeparator	toolbar_separator;
 	GArray			*signal_ids;			/* SignalConnection's to disconnect when unloading */
 	GList			*sources;				/* GSources to destroy when unloading */
+	/* time spent in the plugin's signal handlers and document changes callbacks */
+	guint			dispatch_count;
+	gdouble			dispatch_time;			/* seconds */
+	gdouble			dispatch_max_time;
+	guint			dispatch_depth;
+	gdouble			dispatch_start;
 }
 GeanyPluginPrivate;
 
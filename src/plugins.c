@@ -86,7 +86,8 @@ static PluginFuncs plugin_funcs = {
 	&plugin_show_configure,
 	&plugin_timeout_add,
 	&plugin_timeout_add_seconds,
-	&plugin_idle_add
+	&plugin_idle_add,
+	&plugin_document_changes_connect
 };
 
 static DocumentFuncs doc_funcs = {
@@ -293,7 +294,8 @@ static TagManagerFuncs tagmanager_funcs = {
 	&tm_workspace_add_object,
 	&tm_source_file_update,
 	&tm_work_object_free,
-	&tm_workspace_remove_object
+	&tm_workspace_remove_object,
+	&tm_source_file_get_tag_at_line
 };
 
 static SearchFuncs search_funcs = {
@@ -816,6 +818,7 @@ plugin_cleanup(Plugin *plugin)
 
 	remove_callbacks(plugin);
 	remove_sources(plugin);
+	plugin_document_changes_remove(&plugin->public);
 
 	if (plugin->key_group)
 		keybindings_free_group(plugin->key_group);
@@ -1172,6 +1175,7 @@ typedef struct
 	GtkWidget *plugin_label;
 	GtkWidget *filename_label;
 	GtkWidget *author_label;
+	GtkWidget *time_label;
 	GtkWidget *configure_button;
 	GtkWidget *help_button;
 }
@@ -1214,6 +1218,14 @@ static void pm_selection_changed(GtkTreeSelection *selection, gpointer user_data
 			gtk_label_set_text(GTK_LABEL(pm_widgets.author_label), pi->author);
 			g_free(text);
 
+			if (is_active_plugin(p))
+				text = g_strdup_printf(_("%u calls, %.1f ms in total, %.1f ms at most"),
+					p->dispatch_count, p->dispatch_time * 1000, p->dispatch_max_time * 1000);
+			else
+				text = NULL;
+			gtk_label_set_text(GTK_LABEL(pm_widgets.time_label), text);
+			g_free(text);
+
 			pm_update_buttons(p);
 		}
 	}
@@ -1448,17 +1460,20 @@ static void pm_show_dialog(GtkMenuItem *menuitem, gpointer user_data)
 	gtk_label_set_use_markup(GTK_LABEL(label2), TRUE);
 	gtk_misc_set_alignment(GTK_MISC(label2), 0, 0.5);
 
-	table = gtk_table_new(3, 2, FALSE);
+	table = gtk_table_new(4, 2, FALSE);
 	gtk_table_set_col_spacings(GTK_TABLE(table), 6);
 	pm_widgets.plugin_label = geany_wrap_label_new(NULL);
 	pm_widgets.filename_label = geany_wrap_label_new(NULL);
 	pm_widgets.author_label = geany_wrap_label_new(NULL);
+	pm_widgets.time_label = geany_wrap_label_new(NULL);
 	gtk_table_attach(GTK_TABLE(table), create_table_label(_("Plugin:")), 0, 1, 0, 1, GTK_FILL, GTK_FILL, 0, 0);
 	gtk_table_attach(GTK_TABLE(table), create_table_label(_("Author(s):")), 0, 1, 1, 2, GTK_FILL, GTK_FILL, 0, 0);
 	gtk_table_attach(GTK_TABLE(table), create_table_label(_("Filename:")), 0, 1, 2, 3, GTK_FILL, GTK_FILL, 0, 0);
+	gtk_table_attach(GTK_TABLE(table), create_table_label(_("Dispatch time:")), 0, 1, 3, 4, GTK_FILL, GTK_FILL, 0, 0);
 	gtk_table_attach(GTK_TABLE(table), pm_widgets.plugin_label, 1, 2, 0, 1, GTK_EXPAND | GTK_FILL, GTK_FILL, 0, 0);
 	gtk_table_attach(GTK_TABLE(table), pm_widgets.author_label, 1, 2, 1, 2, GTK_EXPAND | GTK_FILL, GTK_FILL, 0, 0);
 	gtk_table_attach(GTK_TABLE(table), pm_widgets.filename_label, 1, 2, 2, 3, GTK_EXPAND | GTK_FILL, GTK_FILL, 0, 0);
+	gtk_table_attach(GTK_TABLE(table), pm_widgets.time_label, 1, 2, 3, 4, GTK_EXPAND | GTK_FILL, GTK_FILL, 0, 0);
 
 	desc_win = gtk_scrolled_window_new(NULL, NULL);
 	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(desc_win),
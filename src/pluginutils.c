@@ -35,6 +35,16 @@
 #include "utils.h"
 #include "support.h"
 #include "plugins.h"
+#include "document.h"
+#include "geanyobject.h"
+#include "sciwrappers.h"
+
+
+/* plugin handlers taking longer than this, in seconds, are logged */
+#define SLOW_DISPATCH_TIME 0.05
+
+/* measures the time spent in plugin code called from Geany */
+static GTimer *dispatch_timer = NULL;
 
 
 /** Inserts a toolbar item before the Quit button, or after the previous plugin toolbar item.
@@ -94,6 +104,38 @@ void plugin_module_make_resident(GeanyPlugin *plugin)
 }
 
 
+static void on_dispatch_begin(gpointer data, GClosure *closure)
+{
+	Plugin *plugin = data;
+
+	if (!dispatch_timer)
+		dispatch_timer = g_timer_new();
+
+	/* a handler can cause another of its handlers to be called, only time the outer one */
+	if (plugin->dispatch_depth++ == 0)
+		plugin->dispatch_start = g_timer_elapsed(dispatch_timer, NULL);
+}
+
+
+static void on_dispatch_end(gpointer data, GClosure *closure)
+{
+	Plugin *plugin = data;
+	gdouble elapsed;
+
+	if (--plugin->dispatch_depth > 0)
+		return;
+
+	elapsed = g_timer_elapsed(dispatch_timer, NULL) - plugin->dispatch_start;
+	plugin->dispatch_count++;
+	plugin->dispatch_time += elapsed;
+	if (elapsed > plugin->dispatch_max_time)
+		plugin->dispatch_max_time = elapsed;
+	if (elapsed > SLOW_DISPATCH_TIME)
+		geany_debug("Plugin '%s' took %.0f ms to handle an event.",
+			plugin->info.name, elapsed * 1000);
+}
+
+
 /** Connects a signal which will be disconnected on unloading the plugin, to prevent a possible segfault.
  * @param plugin Must be @ref geany_plugin.
  * @param object Object to connect to, or @c NULL when using @link pluginsignals.c Geany signals @endlink.
@@ -110,13 +152,16 @@ void plugin_signal_connect(GeanyPlugin *plugin,
 {
 	gulong id;
 	SignalConnection sc;
+	GClosure *closure;
 
 	if (!object)
 		object = geany_object;
 
-	id = after ?
-		g_signal_connect_after(object, signal_name, callback, user_data) :
-		g_signal_connect(object, signal_name, callback, user_data);
+	/* the guards time the handler for the Plugin Manager dialog */
+	closure = g_cclosure_new(callback, user_data, NULL);
+	g_closure_add_marshal_guards(closure, plugin->priv, on_dispatch_begin,
+		plugin->priv, on_dispatch_end);
+	id = g_signal_connect_closure(object, signal_name, closure, after);
 
 	if (!plugin->priv->signal_ids)
 		plugin->priv->signal_ids = g_array_new(FALSE, FALSE, sizeof(SignalConnection));
@@ -254,6 +299,168 @@ guint plugin_idle_add(GeanyPlugin *plugin, GSourceFunc function, gpointer data)
 }
 
 
+typedef struct ChangeSubscription
+{
+	Plugin		*plugin;
+	guint		interval;
+	GeanyDocumentChangesFunc	callback;
+	gpointer	user_data;
+	GHashTable	*changes;	/* GeanyDocument -> GeanyDocumentChanges not yet passed to callback */
+	guint		source_id;
+}
+ChangeSubscription;
+
+static GList *change_subscriptions = NULL;
+
+
+static gboolean on_changes_timeout(gpointer data)
+{
+	ChangeSubscription *sub = data;
+	Plugin *plugin = sub->plugin;
+	GArray *changes;
+	GHashTableIter iter;
+	gpointer value;
+
+	changes = g_array_sized_new(FALSE, FALSE, sizeof(GeanyDocumentChanges),
+		g_hash_table_size(sub->changes));
+	g_hash_table_iter_init(&iter, sub->changes);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		g_array_append_vals(changes, value, 1);
+	g_hash_table_remove_all(sub->changes);
+	sub->source_id = 0;
+
+	if (changes->len > 0)
+	{
+		on_dispatch_begin(plugin, NULL);
+		sub->callback((GeanyDocumentChanges *) changes->data, changes->len, sub->user_data);
+		on_dispatch_end(plugin, NULL);
+	}
+	g_array_free(changes, TRUE);
+	return FALSE;
+}
+
+
+static void on_changes_document_close(GObject *obj, GeanyDocument *doc, gpointer user_data)
+{
+	GList *node;
+
+	foreach_list(node, change_subscriptions)
+	{
+		ChangeSubscription *sub = node->data;
+
+		g_hash_table_remove(sub->changes, doc);
+	}
+}
+
+
+/* Adds the lines from @a line to @a line + @a lines_added to the changes pending for @a doc,
+ * moving the pending lines after @a line by @a lines_added. */
+static void add_change(ChangeSubscription *sub, GeanyDocument *doc, gint line, gint lines_added)
+{
+	GeanyDocumentChanges *changes = g_hash_table_lookup(sub->changes, doc);
+	gint end_line = line + MAX(lines_added, 0);
+
+	if (changes == NULL)
+	{
+		changes = g_new(GeanyDocumentChanges, 1);
+		changes->document = doc;
+		changes->start_line = line;
+		changes->end_line = end_line;
+		changes->lines_added = lines_added;
+		g_hash_table_insert(sub->changes, doc, changes);
+	}
+	else
+	{
+		if (changes->start_line > line)
+			changes->start_line = MAX(changes->start_line + lines_added, line);
+		if (changes->end_line > line)
+			changes->end_line = MAX(changes->end_line + lines_added, line);
+		changes->start_line = MIN(changes->start_line, line);
+		changes->end_line = MAX(changes->end_line, end_line);
+		changes->lines_added += lines_added;
+	}
+
+	if (sub->source_id == 0)
+		sub->source_id = g_timeout_add(sub->interval, on_changes_timeout, sub);
+}
+
+
+/* Called by the editor when text is inserted or deleted at @a position. */
+void plugin_document_changes_add(GeanyDocument *doc, gint position, gint lines_added)
+{
+	GList *node;
+	gint line;
+
+	if (change_subscriptions == NULL)
+		return;
+
+	line = sci_get_line_from_position(doc->editor->sci, position);
+	foreach_list(node, change_subscriptions)
+		add_change(node->data, doc, line, lines_added);
+}
+
+
+/** Calls @a callback with the lines changed in documents since the previous call, at most once
+ * every @a interval milliseconds.
+ * Unlike handling the @c "editor-notify" signal, many modifications made in a short time are
+ * merged into one range of lines per document, so the plugin only does its work once.
+ * The callback is removed when unloading the plugin.
+ *
+ * @param plugin Must be @ref geany_plugin.
+ * @param interval The minimum time between calls to @a callback, in milliseconds.
+ * @param callback The function to call with the changes.
+ * @param user_data The user data passed to @a callback.
+ *
+ * @since 1.23, plugin API 218.
+ */
+void plugin_document_changes_connect(GeanyPlugin *plugin, guint interval,
+		GeanyDocumentChangesFunc callback, gpointer user_data)
+{
+	static gboolean connected = FALSE;
+	ChangeSubscription *sub;
+
+	g_return_if_fail(plugin);
+	g_return_if_fail(callback);
+
+	if (!connected)
+	{
+		g_signal_connect(geany_object, "document-close", G_CALLBACK(on_changes_document_close), NULL);
+		connected = TRUE;
+	}
+
+	sub = g_new0(ChangeSubscription, 1);
+	sub->plugin = plugin->priv;
+	sub->interval = interval;
+	sub->callback = callback;
+	sub->user_data = user_data;
+	sub->changes = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+	change_subscriptions = g_list_append(change_subscriptions, sub);
+}
+
+
+/* Removes the callbacks added by @a plugin with plugin_document_changes_connect(). */
+void plugin_document_changes_remove(GeanyPlugin *plugin)
+{
+	GList *node = change_subscriptions;
+
+	while (node != NULL)
+	{
+		GList *next = node->next;
+		ChangeSubscription *sub = node->data;
+
+		if (sub->plugin == plugin->priv)
+		{
+			if (sub->source_id != 0)
+				g_source_remove(sub->source_id);
+			g_hash_table_destroy(sub->changes);
+			g_free(sub);
+			change_subscriptions = g_list_delete_link(change_subscriptions, node);
+		}
+		node = next;
+	}
+}
+
+
 /** Sets up or resizes a keybinding group for the plugin.
  * You should then call keybindings_set_item() for each keybinding in the group.
  * @param plugin Must be @ref geany_plugin.
@@ -30,6 +30,8 @@
 
 /* avoid including plugindata.h otherwise this redefines the GEANY() macro */
 struct GeanyPlugin;
+struct GeanyDocument;
+struct GeanyDocumentChanges;
 
 
 void plugin_add_toolbar_item(struct GeanyPlugin *plugin, GtkToolItem *item);
@@ -53,5 +55,13 @@ struct GeanyKeyGroup *plugin_set_key_group(struct GeanyPlugin *plugin,
 
 void plugin_show_configure(struct GeanyPlugin *plugin);
 
+void plugin_document_changes_connect(struct GeanyPlugin *plugin, guint interval,
+		void (*callback) (const struct GeanyDocumentChanges *changes, guint count,
+		gpointer user_data), gpointer user_data);
+
+void plugin_document_changes_add(struct GeanyDocument *doc, gint position, gint lines_added);
+
+void plugin_document_changes_remove(struct GeanyPlugin *plugin);
+
 #endif /* HAVE_PLUGINS */
 #endif /* GEANY_PLUGINUTILS_H */
@@ -46,6 +46,7 @@
 #include "stash.h"
 #include "sidebar.h"
 #include "filetypes.h"
+#include "projectindex.h"
 
 
 ProjectPrefs project_prefs = { NULL, FALSE, FALSE };
@@ -358,6 +359,7 @@ void project_close(gboolean open_default)
 		if (!document_close_all())
 			return;
 	}
+	project_index_stop();
 	ui_set_statusbar(TRUE, _("Project \"%s\" closed."), app->project->name);
 
 	/* remove project filetypes build entries */
@@ -792,6 +794,8 @@ static gboolean update_config(const PropertyDialogElements *e, gboolean new_proj
 	}
 
 	update_ui();
+	/* the base path or file patterns may have changed */
+	project_index_start();
 
 	return TRUE;
 }
@@ -1009,6 +1013,7 @@ static gboolean load_config(const gchar *filename)
 	g_key_file_free(config);
 
 	update_ui();
+	project_index_start();
 	return TRUE;
 }
 
@@ -1251,4 +1256,5 @@ void project_init(void)
 
 void project_finalize(void)
 {
+	project_index_stop();
 }
@@ -0,0 +1,808 @@
+/*
+ *      projectindex.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Symbol index of the files of the open project.
+ *
+ * A pool of worker threads walks the project base path and reads the files matching
+ * the project file patterns. The files are parsed on the main thread in short time slices,
+ * because the ctags parsers are not thread safe, and their work objects are added to the
+ * tag manager workspace like those of open documents.
+ *
+ * The tags are kept in a cache file so that re-opening a project only re-parses the files
+ * whose modification time or size has changed since.
+ */
+
+#include "geany.h"
+
+#include <string.h>
+#include <stdlib.h>
+/* gstdio.h also includes sys/stat.h */
+#include <glib/gstdio.h>
+
+#include "projectindex.h"
+#include "project.h"
+#include "document.h"
+#include "filetypes.h"
+#include "main.h"
+#include "support.h"
+#include "ui_utils.h"
+#include "utils.h"
+
+
+#define INDEX_THREADS 3
+/* stop reading files ahead while this many are waiting to be parsed */
+#define INDEX_MAX_QUEUED 64
+#define INDEX_QUEUE_WAIT 10000		/* microseconds */
+#define INDEX_TIMEOUT 40			/* milliseconds */
+#define INDEX_TIME_SLICE 0.025		/* seconds spent parsing per timeout */
+#define INDEX_UPDATE_INTERVAL 2.0	/* seconds between workspace updates while scanning */
+
+#define CACHE_HEADER "# Geany project index 1"
+/* language name of files without tags support */
+#define CACHE_NO_LANG "-"
+
+
+typedef struct IndexStamp
+{
+	time_t mtime;
+	gint64 size;
+}
+IndexStamp;
+
+/* A project file, owned by the main thread. */
+typedef struct IndexedFile
+{
+	gchar *path;			/* locale encoding, as found by the scan */
+	IndexStamp stamp;		/* of the file contents the tags come from */
+	TMWorkObject *tm_file;	/* NULL for file types without tags support */
+	gboolean in_workspace;	/* FALSE while the file is open in a document */
+	gboolean seen;			/* found by the current scan */
+	gboolean recheck;		/* queued in state.recheck */
+}
+IndexedFile;
+
+/* Passed from the workers to the main thread. */
+typedef struct IndexResult
+{
+	gchar *path;			/* NULL when the scan has finished */
+	IndexStamp stamp;
+	gchar *contents;		/* NULL if the file is unchanged since the last scan */
+	gsize length;
+}
+IndexResult;
+
+/* State shared with the worker threads. */
+typedef struct IndexScan
+{
+	GThreadPool *pool;
+	GAsyncQueue *results;
+	GPatternSpec **patterns;
+	GHashTable *stamps;		/* path -> IndexStamp of the indexed files, read-only */
+	volatile gint pending;	/* directories pushed to the pool and not yet scanned */
+	volatile gint cancelled;
+}
+IndexScan;
+
+static struct
+{
+	GHashTable *files;		/* path -> IndexedFile */
+	GHashTable *real_paths;	/* work object file name -> IndexedFile */
+	gchar *cache_file;
+	gboolean cache_changed;
+	IndexScan *scan;
+	GQueue *recheck;		/* IndexedFiles of closed documents */
+	GPtrArray *stale;		/* work objects whose tags the workspace may still refer to */
+	gboolean workspace_changed;
+	GTimer *update_timer;
+	guint timeout_id;
+	guint n_files;
+	guint n_parsed;
+}
+state;
+
+
+static gboolean match_patterns(GPatternSpec **patterns, const gchar *name)
+{
+	GPatternSpec **pattern;
+
+	for (pattern = patterns; *pattern != NULL; pattern++)
+	{
+		if (g_pattern_match_string(*pattern, name))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+/* Runs in a worker thread. Takes ownership of path. */
+static void scan_file(IndexScan *scan, gchar *path, const struct stat *st)
+{
+	IndexResult *result = g_new0(IndexResult, 1);
+	const IndexStamp *stamp = g_hash_table_lookup(scan->stamps, path);
+
+	result->path = path;
+	result->stamp.mtime = st->st_mtime;
+	result->stamp.size = st->st_size;
+	if (stamp == NULL || stamp->mtime != result->stamp.mtime || stamp->size != result->stamp.size)
+	{
+		if (! g_file_get_contents(path, &result->contents, &result->length, NULL))
+		{
+			g_free(result->path);
+			g_free(result);
+			return;
+		}
+	}
+	/* don't read files faster than they can be parsed */
+	while (g_async_queue_length(scan->results) > INDEX_MAX_QUEUED &&
+		! g_atomic_int_get(&scan->cancelled))
+		g_usleep(INDEX_QUEUE_WAIT);
+
+	g_async_queue_push(scan->results, result);
+}
+
+
+/* Runs in a worker thread for each directory of the project. */
+static void scan_directory(gpointer data, gpointer user_data)
+{
+	IndexScan *scan = user_data;
+	gchar *dir_path = data;
+	GDir *dir = NULL;
+	const gchar *name;
+
+	if (! g_atomic_int_get(&scan->cancelled))
+		dir = g_dir_open(dir_path, 0, NULL);
+
+	while (dir != NULL && ! g_atomic_int_get(&scan->cancelled) &&
+		(name = g_dir_read_name(dir)) != NULL)
+	{
+		gchar *path;
+		struct stat st;
+
+		/* skip hidden files and version control directories */
+		if (*name == '.')
+			continue;
+
+		path = g_build_filename(dir_path, name, NULL);
+		if (g_lstat(path, &st) != 0)
+			g_free(path);
+		/* symlinked directories are not followed to avoid cycles */
+		else if (S_ISDIR(st.st_mode))
+		{
+			g_atomic_int_inc(&scan->pending);
+			g_thread_pool_push(scan->pool, path, NULL);
+		}
+		else if (match_patterns(scan->patterns, name) &&
+			(S_ISREG(st.st_mode) || (g_stat(path, &st) == 0 && S_ISREG(st.st_mode))))
+			scan_file(scan, path, &st);
+		else
+			g_free(path);
+	}
+	if (dir != NULL)
+		g_dir_close(dir);
+	g_free(dir_path);
+
+	/* the last directory tells the main thread the scan has finished */
+	if (g_atomic_int_dec_and_test(&scan->pending))
+		g_async_queue_push(scan->results, g_new0(IndexResult, 1));
+}
+
+
+static void free_result(IndexResult *result)
+{
+	g_free(result->path);
+	g_free(result->contents);
+	g_free(result);
+}
+
+
+static GPatternSpec **get_patterns(void)
+{
+	GPtrArray *specs = g_ptr_array_new();
+	gchar **pattern;
+	guint i;
+
+	foreach_strv(pattern, app->project->file_patterns)
+	{
+		if (NZV(*pattern))
+			g_ptr_array_add(specs, g_pattern_spec_new(*pattern));
+	}
+	/* without project file patterns, index all files with tags support */
+	if (specs->len == 0)
+	{
+		for (i = 0; i < filetypes_array->len; i++)
+		{
+			if (! filetype_has_tags(filetypes[i]))
+				continue;
+			foreach_strv(pattern, filetypes[i]->pattern)
+				g_ptr_array_add(specs, g_pattern_spec_new(*pattern));
+		}
+	}
+	g_ptr_array_add(specs, NULL);
+	return (GPatternSpec **) g_ptr_array_free(specs, FALSE);
+}
+
+
+static IndexScan *scan_new(const gchar *base_path)
+{
+	IndexScan *scan = g_new0(IndexScan, 1);
+	GHashTableIter iter;
+	gpointer value;
+	GError *error = NULL;
+
+	scan->results = g_async_queue_new();
+	scan->patterns = get_patterns();
+	scan->stamps = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	g_hash_table_iter_init(&iter, state.files);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		IndexedFile *file = value;
+
+		g_hash_table_insert(scan->stamps, g_strdup(file->path),
+			g_memdup(&file->stamp, sizeof(IndexStamp)));
+	}
+	scan->pending = 1;
+	scan->pool = g_thread_pool_new(scan_directory, scan, INDEX_THREADS, FALSE, &error);
+	if (scan->pool == NULL)
+	{
+		geany_debug("Could not start the project index threads: %s", error->message);
+		g_error_free(error);
+		g_async_queue_push(scan->results, g_new0(IndexResult, 1));
+	}
+	else
+		g_thread_pool_push(scan->pool, g_strdup(base_path), NULL);
+	return scan;
+}
+
+
+/* Waits for the workers if they are still running and frees the scan. */
+static void scan_free(IndexScan *scan, gboolean finished)
+{
+	IndexResult *result;
+	GPatternSpec **pattern;
+
+	if (! finished)
+	{
+		g_atomic_int_set(&scan->cancelled, 1);
+		/* once the last directory is done no more tasks can be pushed to the pool */
+		while ((result = g_async_queue_pop(scan->results))->path != NULL)
+			free_result(result);
+		g_free(result);
+	}
+	if (scan->pool != NULL)
+		g_thread_pool_free(scan->pool, FALSE, TRUE);
+
+	while ((result = g_async_queue_try_pop(scan->results)) != NULL)
+		free_result(result);
+	g_async_queue_unref(scan->results);
+
+	for (pattern = scan->patterns; *pattern != NULL; pattern++)
+		g_pattern_spec_free(*pattern);
+	g_free(scan->patterns);
+	g_hash_table_destroy(scan->stamps);
+	g_free(scan);
+}
+
+
+/* Replaces the work object of file, adding it to the workspace unless the file is
+ * open in a document. */
+static void set_work_object(IndexedFile *file, TMWorkObject *tm_file)
+{
+	if (file->tm_file != NULL)
+	{
+		g_hash_table_remove(state.real_paths, file->tm_file->file_name);
+		if (file->in_workspace)
+		{
+			tm_workspace_remove_object(file->tm_file, FALSE, FALSE);
+			/* the workspace tags array still points to its tags until it is updated */
+			g_ptr_array_add(state.stale, file->tm_file);
+			state.workspace_changed = TRUE;
+		}
+		else
+			tm_work_object_free(file->tm_file);
+	}
+	file->tm_file = tm_file;
+	file->in_workspace = FALSE;
+
+	if (tm_file != NULL)
+	{
+		g_hash_table_insert(state.real_paths, tm_file->file_name, file);
+		if (document_find_by_real_path(tm_file->file_name) == NULL)
+		{
+			tm_workspace_add_object(tm_file);
+			file->in_workspace = TRUE;
+			state.workspace_changed = TRUE;
+		}
+	}
+}
+
+
+static void update_workspace(void)
+{
+	guint i;
+
+	if (state.workspace_changed)
+		tm_workspace_update(TM_WORK_OBJECT(app->tm_workspace), TRUE, FALSE, FALSE);
+	state.workspace_changed = FALSE;
+
+	for (i = 0; i < state.stale->len; i++)
+		tm_work_object_free(g_ptr_array_index(state.stale, i));
+	g_ptr_array_set_size(state.stale, 0);
+	g_timer_start(state.update_timer);
+}
+
+
+static IndexedFile *add_file(const gchar *path, const IndexStamp *stamp)
+{
+	IndexedFile *file = g_hash_table_lookup(state.files, path);
+
+	if (file == NULL)
+	{
+		file = g_new0(IndexedFile, 1);
+		file->path = g_strdup(path);
+		g_hash_table_insert(state.files, file->path, file);
+	}
+	file->stamp = *stamp;
+	state.cache_changed = TRUE;
+	return file;
+}
+
+
+static void remove_file(IndexedFile *file)
+{
+	set_work_object(file, NULL);
+	if (file->recheck)
+		g_queue_remove(state.recheck, file);
+	/* frees file */
+	g_hash_table_remove(state.files, file->path);
+	state.cache_changed = TRUE;
+}
+
+
+static void free_file(gpointer data)
+{
+	IndexedFile *file = data;
+
+	g_free(file->path);
+	g_free(file);
+}
+
+
+static void parse_file(IndexedFile *file, const gchar *contents, gsize length)
+{
+	gchar *utf8_path = utils_get_utf8_from_locale(file->path);
+	GeanyFiletype *ft = filetypes_detect_from_extension(utf8_path);
+	TMWorkObject *tm_file = NULL;
+
+	if (filetype_has_tags(ft))
+	{
+		/* lookup the name rather than using filetype name to support custom filetypes */
+		tm_file = tm_source_file_new(file->path, FALSE, tm_source_file_get_lang_name(ft->lang));
+		/* tm_source_file_buffer_update() doesn't support 0-length data */
+		if (tm_file != NULL && length > 0)
+			tm_source_file_buffer_update(tm_file, (guchar *) contents, length, FALSE);
+	}
+	set_work_object(file, tm_file);
+	state.n_parsed++;
+	g_free(utf8_path);
+}
+
+
+static void add_result(IndexResult *result)
+{
+	IndexedFile *file = g_hash_table_lookup(state.files, result->path);
+
+	if (result->contents != NULL)
+	{
+		file = add_file(result->path, &result->stamp);
+		parse_file(file, result->contents, result->length);
+	}
+	/* the file has been removed since the scan started */
+	else if (file == NULL)
+		return;
+	file->seen = TRUE;
+	state.n_files++;
+}
+
+
+/* Checks a file again when the document it was open in has been closed. */
+static void recheck_file(IndexedFile *file)
+{
+	struct stat st;
+	gchar *contents;
+	gsize length;
+
+	if (g_stat(file->path, &st) != 0 || ! S_ISREG(st.st_mode))
+		remove_file(file);
+	else if (st.st_mtime != file->stamp.mtime || st.st_size != file->stamp.size)
+	{
+		IndexStamp stamp;
+
+		stamp.mtime = st.st_mtime;
+		stamp.size = st.st_size;
+		if (g_file_get_contents(file->path, &contents, &length, NULL))
+		{
+			add_file(file->path, &stamp);
+			parse_file(file, contents, length);
+			g_free(contents);
+		}
+		else
+			remove_file(file);
+	}
+	else if (file->tm_file != NULL && ! file->in_workspace &&
+		document_find_by_real_path(file->tm_file->file_name) == NULL)
+	{
+		tm_workspace_add_object(file->tm_file);
+		file->in_workspace = TRUE;
+		state.workspace_changed = TRUE;
+	}
+}
+
+
+static void save_cache(void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	gchar *dir;
+	FILE *fp;
+	guint i;
+
+	if (! state.cache_changed)
+		return;
+
+	dir = g_path_get_dirname(state.cache_file);
+	utils_mkdir(dir, TRUE);
+	g_free(dir);
+
+	fp = g_fopen(state.cache_file, "w");
+	if (fp == NULL)
+	{
+		geany_debug("Could not write the project index cache %s", state.cache_file);
+		return;
+	}
+	fprintf(fp, "%s\n", CACHE_HEADER);
+
+	g_hash_table_iter_init(&iter, state.files);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		IndexedFile *file = value;
+		TMWorkObject *tm_file = file->tm_file;
+		GPtrArray *tags = (tm_file != NULL) ? tm_file->tags_array : NULL;
+
+		fprintf(fp, "F\t%ld\t%" G_GINT64_FORMAT "\t%s\t%u\t%s\n",
+			(glong) file->stamp.mtime, file->stamp.size,
+			(tm_file != NULL) ?
+				tm_source_file_get_lang_name(TM_SOURCE_FILE(tm_file)->lang) : CACHE_NO_LANG,
+			(tags != NULL) ? tags->len : 0, file->path);
+
+		for (i = 0; tags != NULL && i < tags->len; i++)
+			tm_tag_write(TM_TAG(tags->pdata[i]), fp, tm_tag_attr_max_t);
+	}
+	fclose(fp);
+	state.cache_changed = FALSE;
+}
+
+
+/* Reads the tags of a cached file. Returns FALSE if the cache is corrupt. */
+static gboolean load_cached_tags(FILE *fp, TMWorkObject *tm_file, guint n_tags)
+{
+	TMTag *tag;
+	guint i;
+
+	if (tm_file != NULL && tm_file->tags_array == NULL)
+		tm_file->tags_array = g_ptr_array_sized_new(n_tags);
+
+	for (i = 0; i < n_tags; i++)
+	{
+		tag = tm_tag_new_from_file(TM_SOURCE_FILE(tm_file), fp, 0, FALSE);
+		if (tag == NULL)
+			return FALSE;
+		if (tm_file != NULL)
+			g_ptr_array_add(tm_file->tags_array, tag);
+		else
+			tm_tag_unref(tag);
+	}
+	return TRUE;
+}
+
+
+/* Cached tags are shown straight away; the scan then replaces those of changed files. */
+static void load_cache(void)
+{
+	gchar buf[BUFSIZ];
+	FILE *fp = g_fopen(state.cache_file, "r");
+
+	if (fp == NULL)
+		return;
+
+	if (fgets(buf, sizeof(buf), fp) != NULL && g_str_has_prefix(buf, CACHE_HEADER "\n"))
+	{
+		while (fgets(buf, sizeof(buf), fp) != NULL)
+		{
+			gchar **fields;
+			gsize len = strlen(buf);
+			gboolean ok;
+
+			if (len == 0 || buf[len - 1] != '\n')
+				break;
+			buf[len - 1] = '\0';
+
+			fields = g_strsplit(buf, "\t", 6);
+			ok = g_strv_length(fields) == 6 && utils_str_equal(fields[0], "F");
+			if (ok)
+			{
+				IndexStamp stamp;
+				TMWorkObject *tm_file = NULL;
+				gboolean has_tags = ! utils_str_equal(fields[3], CACHE_NO_LANG);
+
+				stamp.mtime = strtol(fields[1], NULL, 10);
+				stamp.size = g_ascii_strtoll(fields[2], NULL, 10);
+				/* fails if the file has been removed */
+				if (has_tags)
+					tm_file = tm_source_file_new(fields[5], FALSE, fields[3]);
+
+				ok = load_cached_tags(fp, tm_file, strtoul(fields[4], NULL, 10));
+				if (ok && (tm_file != NULL || ! has_tags))
+					set_work_object(add_file(fields[5], &stamp), tm_file);
+				else if (tm_file != NULL)
+					tm_work_object_free(tm_file);
+			}
+			g_strfreev(fields);
+			if (! ok)
+			{
+				geany_debug("Project index cache %s is corrupt", state.cache_file);
+				break;
+			}
+		}
+	}
+	fclose(fp);
+	state.cache_changed = FALSE;
+	update_workspace();
+}
+
+
+static void finish_scan(void)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	scan_free(state.scan, TRUE);
+	state.scan = NULL;
+
+	/* forget the files which have been removed from the project */
+	g_hash_table_iter_init(&iter, state.files);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		IndexedFile *file = value;
+
+		if (file->seen)
+			continue;
+		set_work_object(file, NULL);
+		if (file->recheck)
+			g_queue_remove(state.recheck, file);
+		g_hash_table_iter_remove(&iter);
+		state.cache_changed = TRUE;
+	}
+	update_workspace();
+	save_cache();
+
+	ui_set_statusbar(TRUE, _("Indexed %u project files (%u parsed)."),
+		state.n_files, state.n_parsed);
+}
+
+
+static gboolean on_index_timeout(gpointer data)
+{
+	GTimer *timer = g_timer_new();
+	IndexResult *result;
+
+	while (g_timer_elapsed(timer, NULL) < INDEX_TIME_SLICE)
+	{
+		if (! g_queue_is_empty(state.recheck))
+		{
+			IndexedFile *file = g_queue_pop_head(state.recheck);
+
+			file->recheck = FALSE;
+			recheck_file(file);
+		}
+		else if (state.scan == NULL ||
+			(result = g_async_queue_try_pop(state.scan->results)) == NULL)
+			break;
+		else if (result->path == NULL)
+		{
+			g_free(result);
+			finish_scan();
+		}
+		else
+		{
+			add_result(result);
+			free_result(result);
+		}
+	}
+	g_timer_destroy(timer);
+
+	if (state.scan != NULL)
+	{
+		if (g_timer_elapsed(state.update_timer, NULL) > INDEX_UPDATE_INTERVAL)
+			update_workspace();
+		ui_set_statusbar(FALSE, _("Indexing project files (%u)..."), state.n_files);
+		return TRUE;
+	}
+	update_workspace();
+	if (! g_queue_is_empty(state.recheck))
+		return TRUE;
+
+	state.timeout_id = 0;
+	return FALSE;
+}
+
+
+static void start_timeout(void)
+{
+	if (state.timeout_id == 0)
+		state.timeout_id = g_timeout_add(INDEX_TIMEOUT, on_index_timeout, NULL);
+}
+
+
+static gchar *get_cache_file(void)
+{
+	gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_MD5, app->project->file_name, -1);
+	gchar *name = g_strconcat(checksum, ".cache", NULL);
+	gchar *path = g_build_filename(app->configdir, "project_index", name, NULL);
+
+	g_free(checksum);
+	g_free(name);
+	return path;
+}
+
+
+/* Starts indexing the files of the open project, or re-scans them after the project
+ * properties have changed. */
+void project_index_start(void)
+{
+	gchar *base_path, *locale_path;
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail(app->project != NULL);
+
+	if (! project_prefs.project_index_files)
+		return;
+
+	base_path = project_get_base_path();
+	locale_path = (base_path != NULL) ? utils_get_locale_from_utf8(base_path) : NULL;
+	g_free(base_path);
+	if (locale_path == NULL || ! g_file_test(locale_path, G_FILE_TEST_IS_DIR))
+	{
+		g_free(locale_path);
+		project_index_stop();
+		return;
+	}
+
+	if (state.scan != NULL)
+	{
+		scan_free(state.scan, FALSE);
+		state.scan = NULL;
+	}
+	if (state.files == NULL)
+	{
+		state.files = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_file);
+		state.real_paths = g_hash_table_new(g_str_hash, g_str_equal);
+		state.recheck = g_queue_new();
+		state.stale = g_ptr_array_new();
+		state.update_timer = g_timer_new();
+		state.cache_file = get_cache_file();
+		load_cache();
+	}
+
+	g_hash_table_iter_init(&iter, state.files);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		((IndexedFile *) value)->seen = FALSE;
+	state.n_files = 0;
+	state.n_parsed = 0;
+
+	state.scan = scan_new(locale_path);
+	g_free(locale_path);
+	start_timeout();
+}
+
+
+/* Stops indexing and removes the project files from the workspace. */
+void project_index_stop(void)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	if (state.files == NULL)
+		return;
+
+	if (state.timeout_id != 0)
+	{
+		g_source_remove(state.timeout_id);
+		state.timeout_id = 0;
+	}
+	if (state.scan != NULL)
+	{
+		scan_free(state.scan, FALSE);
+		state.scan = NULL;
+	}
+	save_cache();
+
+	g_hash_table_iter_init(&iter, state.files);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		IndexedFile *file = value;
+
+		if (file->in_workspace)
+		{
+			tm_workspace_remove_object(file->tm_file, FALSE, FALSE);
+			g_ptr_array_add(state.stale, file->tm_file);
+			state.workspace_changed = TRUE;
+		}
+		else if (file->tm_file != NULL)
+			tm_work_object_free(file->tm_file);
+	}
+	update_workspace();
+
+	g_hash_table_destroy(state.files);
+	g_hash_table_destroy(state.real_paths);
+	g_queue_free(state.recheck);
+	g_ptr_array_free(state.stale, TRUE);
+	g_timer_destroy(state.update_timer);
+	g_free(state.cache_file);
+	memset(&state, 0, sizeof(state));
+}
+
+
+/* Called when a document creates its own work object for a file, whose tags then
+ * replace those of the index. */
+void project_index_file_opened(const gchar *real_path)
+{
+	IndexedFile *file;
+
+	if (state.real_paths == NULL || real_path == NULL)
+		return;
+
+	file = g_hash_table_lookup(state.real_paths, real_path);
+	if (file != NULL && file->in_workspace)
+	{
+		/* the document updates the workspace when it has parsed the file */
+		tm_workspace_remove_object(file->tm_file, FALSE, FALSE);
+		file->in_workspace = FALSE;
+	}
+}
+
+
+/* Called when a document is closed, to index the file again if it has been changed. */
+void project_index_file_closed(const gchar *real_path)
+{
+	IndexedFile *file;
+
+	if (state.real_paths == NULL || real_path == NULL || main_status.quitting)
+		return;
+
+	file = g_hash_table_lookup(state.real_paths, real_path);
+	if (file != NULL && ! file->recheck)
+	{
+		file->recheck = TRUE;
+		g_queue_push_tail(state.recheck, file);
+		start_timeout();
+	}
+}
@@ -247,6 +247,29 @@ void sci_empty_undo_buffer(ScintillaObject *sci)
 }
 
 
+/* The oldest undo actions are dropped when the undo history uses more than bytes.
+ * 0 means no limit. */
+void sci_set_undo_memory_limit(ScintillaObject *sci, gint bytes)
+{
+	SSM(sci, SCI_SETUNDOMEMORYLIMIT, (uptr_t) bytes, 0);
+}
+
+
+/* Text stored in chunks is slower to read but cheap to edit anywhere and to snapshot,
+ * which matters for large documents. */
+void sci_set_chunked_storage(ScintillaObject *sci, gboolean chunked)
+{
+	SSM(sci, SCI_SETDOCUMENTSTORAGE,
+		chunked ? SC_DOCUMENTSTORAGE_CHUNKED : SC_DOCUMENTSTORAGE_GAP, 0);
+}
+
+
+gint sci_get_undo_memory(ScintillaObject *sci)
+{
+	return (gint) SSM(sci, SCI_GETUNDOMEMORY, 0, 0);
+}
+
+
 gboolean sci_is_modified(ScintillaObject *sci)
 {
 	return (SSM(sci, SCI_GETMODIFY, 0, 0) != 0);
@@ -698,6 +721,20 @@ gboolean sci_get_fold_expanded(ScintillaObject *sci, gint line)
 }
 
 
+/* action is one of SC_FOLDACTION_CONTRACT, SC_FOLDACTION_EXPAND or SC_FOLDACTION_TOGGLE */
+void sci_fold_all(ScintillaObject *sci, gint action)
+{
+	SSM(sci, SCI_FOLDALL, (uptr_t) action, 0);
+}
+
+
+/* Contracts the fold points nested level deep or deeper and expands the others */
+void sci_fold_to_level(ScintillaObject *sci, gint level)
+{
+	SSM(sci, SCI_FOLDTOLEVEL, (uptr_t) level, 0);
+}
+
+
 void sci_colourise(ScintillaObject *sci, gint start, gint end)
 {
 	SSM(sci, SCI_COLOURISE, (uptr_t) start, end);
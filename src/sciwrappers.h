@@ -94,6 +94,9 @@ gint				sci_get_line_count			(ScintillaObject *sci);
 gint				sci_get_position_from_xy	(ScintillaObject *sci, gint x, gint y, gboolean nearby);
 
 void 				sci_set_undo_collection		(ScintillaObject *sci, gboolean set);
+void				sci_set_undo_memory_limit	(ScintillaObject *sci, gint bytes);
+gint				sci_get_undo_memory			(ScintillaObject *sci);
+void				sci_set_chunked_storage		(ScintillaObject *sci, gboolean chunked);
 
 gint				sci_get_line_end_position	(ScintillaObject *sci, gint line);
 
@@ -105,6 +108,8 @@ gint				sci_get_fold_parent			(ScintillaObject *sci, gint start_line);
 
 void 				sci_set_folding_margin_visible (ScintillaObject *sci, gboolean set);
 gboolean			sci_get_fold_expanded		(ScintillaObject *sci, gint line);
+void				sci_fold_all				(ScintillaObject *sci, gint action);
+void				sci_fold_to_level			(ScintillaObject *sci, gint level);
 
 void				sci_colourise				(ScintillaObject *sci, gint start, gint end);
 void				sci_clear_all				(ScintillaObject *sci);
@@ -46,9 +46,15 @@
 #include <gdk/gdkkeysyms.h>
 
 
+/* number of hidden documents whose symbol lists are kept, the others are built again
+ * when they are shown */
+#define KEPT_SYMBOL_LISTS 8
+
 SidebarTreeviews tv = {NULL, NULL, NULL};
 /* while typeahead searching, editor should not get focus */
 static gboolean may_steal_focus = FALSE;
+/* incremented each time a symbol list is shown */
+static guint symbol_list_stamp = 0;
 
 static struct
 {
@@ -103,6 +109,42 @@ static void sidebar_tabs_show_hide(GtkNotebook *notebook, GtkWidget *child,
 								   guint page_num, gpointer data);
 
 
+/* the tooltip of a symbol is only built when it is shown */
+static gboolean on_taglist_query_tooltip(GtkWidget *widget, gint x, gint y, gboolean keyboard_mode,
+		GtkTooltip *tooltip, gpointer user_data)
+{
+	GtkTreeView *tree_view = GTK_TREE_VIEW(widget);
+	GeanyDocument *doc = document_get_current();
+	GtkTreeModel *model;
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	TMTag *tag;
+	gchar *text = NULL;
+
+	if (doc == NULL ||
+		! gtk_tree_view_get_tooltip_context(tree_view, &x, &y, keyboard_mode, &model, &path, &iter))
+		return FALSE;
+
+	gtk_tree_model_get(model, &iter, SYMBOLS_COLUMN_TAG, &tag, -1);
+	if (tag)
+	{
+		text = symbols_get_tag_tooltip(doc, tag);
+		tm_tag_unref(tag);
+	}
+	if (text)
+	{
+		gtk_tooltip_set_markup(tooltip, text);
+		gtk_tree_view_set_tooltip_row(tree_view, tooltip, path);
+	}
+	gtk_tree_path_free(path);
+
+	if (! text)
+		return FALSE;
+	g_free(text);
+	return TRUE;
+}
+
+
 /* the prepare_* functions are document-related, but I think they fit better here than in document.c */
 static void prepare_taglist(GtkWidget *tree, GtkTreeStore *store)
 {
@@ -140,7 +182,8 @@ static void prepare_taglist(GtkWidget *tree, GtkTreeStore *store)
 	if (! interface_prefs.show_symbol_list_expanders)
 		gtk_tree_view_set_level_indentation(GTK_TREE_VIEW(tree), 10);
 	/* Tooltips */
-	gtk_tree_view_set_tooltip_column(GTK_TREE_VIEW(tree), SYMBOLS_COLUMN_TOOLTIP);
+	gtk_widget_set_has_tooltip(tree, TRUE);
+	g_signal_connect(tree, "query-tooltip", G_CALLBACK(on_taglist_query_tooltip), NULL);
 
 	/* selection handling */
 	selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(tree));
@@ -182,7 +225,132 @@ static void create_default_tag_tree(void)
 }
 
 
-/* update = rescan the tags for doc->filename */
+/* appends to collapsed the rows below parent which are collapsed, as the names of the rows
+ * from the top of the tree separated by newlines */
+static void get_collapsed_rows(GtkTreeView *view, GtkTreeIter *parent, const gchar *prefix,
+		GPtrArray *collapsed)
+{
+	GtkTreeModel *model = gtk_tree_view_get_model(view);
+	GtkTreeIter iter;
+	gboolean cont = gtk_tree_model_iter_children(model, &iter, parent);
+
+	while (cont)
+	{
+		if (gtk_tree_model_iter_has_child(model, &iter))
+		{
+			GtkTreePath *path = gtk_tree_model_get_path(model, &iter);
+			gchar *name, *key;
+
+			gtk_tree_model_get(model, &iter, SYMBOLS_COLUMN_NAME, &name, -1);
+			key = g_strconcat(prefix, "\n", name, NULL);
+			/* collapsing a row also collapses the rows below it */
+			if (gtk_tree_view_row_expanded(view, path))
+			{
+				get_collapsed_rows(view, &iter, key, collapsed);
+				g_free(key);
+			}
+			else
+				g_ptr_array_add(collapsed, key);
+			g_free(name);
+			gtk_tree_path_free(path);
+		}
+		cont = gtk_tree_model_iter_next(model, &iter);
+	}
+}
+
+
+/* collapses the rows saved by get_collapsed_rows() */
+static void collapse_rows(GtkTreeView *view, GtkTreeIter *parent, const gchar *prefix,
+		gchar **collapsed)
+{
+	GtkTreeModel *model = gtk_tree_view_get_model(view);
+	GtkTreeIter iter;
+	gboolean cont = gtk_tree_model_iter_children(model, &iter, parent);
+
+	while (cont)
+	{
+		if (gtk_tree_model_iter_has_child(model, &iter))
+		{
+			gchar *name, *key;
+			gchar **row;
+
+			gtk_tree_model_get(model, &iter, SYMBOLS_COLUMN_NAME, &name, -1);
+			key = g_strconcat(prefix, "\n", name, NULL);
+			for (row = collapsed; *row != NULL && ! utils_str_equal(*row, key); row++);
+			if (*row != NULL)
+			{
+				GtkTreePath *path = gtk_tree_model_get_path(model, &iter);
+
+				gtk_tree_view_collapse_row(view, path);
+				gtk_tree_path_free(path);
+			}
+			else
+				collapse_rows(view, &iter, key, collapsed);
+			g_free(name);
+			g_free(key);
+		}
+		cont = gtk_tree_model_iter_next(model, &iter);
+	}
+}
+
+
+/* frees the symbol list of doc, it is built again when the document is shown.
+ * Set keep_state to restore the collapsed rows then. */
+static void release_tag_list(GeanyDocument *doc, gboolean keep_state)
+{
+	if (GTK_IS_WIDGET(doc->priv->tag_tree))
+	{
+		if (keep_state)
+		{
+			GPtrArray *collapsed = g_ptr_array_new();
+
+			get_collapsed_rows(GTK_TREE_VIEW(doc->priv->tag_tree), NULL, "", collapsed);
+			g_ptr_array_add(collapsed, NULL);
+			g_strfreev(doc->priv->symbol_list_collapsed);
+			doc->priv->symbol_list_collapsed = (gchar **) g_ptr_array_free(collapsed, FALSE);
+		}
+		gtk_widget_destroy(doc->priv->tag_tree); /* make GTK release its references, if any */
+		/* Because it was ref'd in sidebar_update_tag_list, it needs unref'ing */
+		g_object_unref(doc->priv->tag_tree);
+		doc->priv->tag_tree = NULL;
+		/* the store was owned by the tree view */
+		doc->priv->tag_store = NULL;
+	}
+	symbols_free_tag_rows(doc);
+}
+
+
+/* frees the symbol lists of the hidden documents shown least recently, keeping a few */
+static void release_old_tag_lists(GeanyDocument *current)
+{
+	GeanyDocument *oldest;
+	guint i, kept;
+
+	do
+	{
+		oldest = NULL;
+		kept = 0;
+		foreach_document(i)
+		{
+			GeanyDocument *doc = documents[i];
+
+			if (doc == current || doc->priv->tag_tree == NULL)
+				continue;
+			kept++;
+			if (oldest == NULL || doc->priv->symbol_list_shown < oldest->priv->symbol_list_shown)
+				oldest = doc;
+		}
+		if (kept > KEPT_SYMBOL_LISTS)
+			release_tag_list(oldest, TRUE);
+	}
+	while (kept > KEPT_SYMBOL_LISTS);
+}
+
+
+/* update = rescan the tags for doc->filename
+ * Only the current document and the last few shown have a symbol list, the ones of other
+ * documents are built when they are shown, which saves memory and time with many open
+ * documents. */
 void sidebar_update_tag_list(GeanyDocument *doc, gboolean update)
 {
 	GtkWidget *child = gtk_bin_get_child(GTK_BIN(tag_window));
@@ -198,6 +366,7 @@ void sidebar_update_tag_list(GeanyDocument *doc, gboolean update)
 				if (child) \
 					gtk_container_remove(GTK_CONTAINER(tag_window), child); \
 				gtk_container_add(GTK_CONTAINER(tag_window), new_child); \
+				release_old_tag_lists(doc); \
 			} \
 		} G_STMT_END
 
@@ -211,12 +380,24 @@ void sidebar_update_tag_list(GeanyDocument *doc, gboolean update)
 		return;
 	}
 
-	if (update)
+	if (doc != document_get_current())
+	{
+		if (update && doc->priv->tag_tree != NULL)
+			doc->has_tags = symbols_recreate_tag_list(doc, SYMBOLS_SORT_USE_PREVIOUS);
+		else if (update)
+		{
+			doc->has_tags = (doc->tm_file != NULL && doc->tm_file->tags_array != NULL &&
+				doc->tm_file->tags_array->len > 0);
+		}
+		return;
+	}
+
+	if (update || doc->priv->tag_tree == NULL)
 	{	/* updating the tag list in the left tag window */
 		if (doc->priv->tag_tree == NULL)
 		{
 			doc->priv->tag_store = gtk_tree_store_new(
-				SYMBOLS_N_COLUMNS, GDK_TYPE_PIXBUF, G_TYPE_STRING, TM_TYPE_TAG, G_TYPE_STRING);
+				SYMBOLS_N_COLUMNS, GDK_TYPE_PIXBUF, G_TYPE_STRING, TM_TYPE_TAG);
 			doc->priv->tag_tree = gtk_tree_view_new();
 			prepare_taglist(doc->priv->tag_tree, doc->priv->tag_store);
 			gtk_widget_show(doc->priv->tag_tree);
@@ -224,10 +405,18 @@ void sidebar_update_tag_list(GeanyDocument *doc, gboolean update)
 		}
 
 		doc->has_tags = symbols_recreate_tag_list(doc, SYMBOLS_SORT_USE_PREVIOUS);
+		if (doc->priv->symbol_list_collapsed != NULL)
+		{
+			collapse_rows(GTK_TREE_VIEW(doc->priv->tag_tree), NULL, "",
+				doc->priv->symbol_list_collapsed);
+			g_strfreev(doc->priv->symbol_list_collapsed);
+			doc->priv->symbol_list_collapsed = NULL;
+		}
 	}
 
 	if (doc->has_tags)
 	{
+		doc->priv->symbol_list_shown = ++symbol_list_stamp;
 		CHANGE_TREE(doc->priv->tag_tree);
 	}
 	else
@@ -544,14 +733,9 @@ void sidebar_openfiles_update_all()
 void sidebar_remove_document(GeanyDocument *doc)
 {
 	openfiles_remove(doc);
-
-	if (GTK_IS_WIDGET(doc->priv->tag_tree))
-	{
-		gtk_widget_destroy(doc->priv->tag_tree); /* make GTK release its references, if any */
-		/* Because it was ref'd in sidebar_update_tag_list, it needs unref'ing */
-		g_object_unref(doc->priv->tag_tree);
-		doc->priv->tag_tree = NULL;
-	}
+	release_tag_list(doc, FALSE);
+	g_strfreev(doc->priv->symbol_list_collapsed);
+	doc->priv->symbol_list_collapsed = NULL;
 }
 
 
@@ -802,7 +986,7 @@ static void document_action(GeanyDocument *doc, gint action)
 		}
 		case OPENFILES_ACTION_SAVE:
 		{
-			document_save_file(doc, FALSE);
+			document_save_file_async(doc, FALSE);
 			break;
 		}
 		case OPENFILES_ACTION_RELOAD:
@@ -40,7 +40,6 @@ enum
 	SYMBOLS_COLUMN_ICON,
 	SYMBOLS_COLUMN_NAME,
 	SYMBOLS_COLUMN_TAG,
-	SYMBOLS_COLUMN_TOOLTIP,
 	SYMBOLS_N_COLUMNS
 };
 
@@ -94,6 +94,9 @@ static TagFileInfo tag_file_info[GTF_MAX] =
 
 static GPtrArray *top_level_iter_names = NULL;
 
+/* source updating the current tag once the current line is styled */
+static guint current_line_styled_id = 0;
+
 static struct
 {
 	GtkWidget *expand_all;
@@ -1078,7 +1081,8 @@ static const gchar *get_symbol_name(GeanyDocument *doc, const TMTag *tag, gboole
 }
 
 
-static gchar *get_symbol_tooltip(GeanyDocument *doc, const TMTag *tag)
+/* Returns: the markup of the symbol list tooltip for tag, or NULL */
+gchar *symbols_get_tag_tooltip(GeanyDocument *doc, const TMTag *tag)
 {
 	gchar *utf8_name = editor_get_calltip_text(doc->editor, tag);
 
@@ -1278,6 +1282,36 @@ static gboolean tree_store_remove_row(GtkTreeStore *store, GtkTreeIter *iter)
 }
 
 
+/* appends a row for @tag under @parent, with the icon of its @type_iter group */
+static void tree_store_append_tag(GeanyDocument *doc, GtkTreeIter *iter, GtkTreeIter *parent,
+		GtkTreeIter *type_iter, const TMTag *tag, gboolean found_parent)
+{
+	GtkTreeStore *store = doc->priv->tag_store;
+	GdkPixbuf *icon = get_child_icon(store, type_iter);
+	gboolean expand;
+	const gchar *name;
+
+	/* only expand to the iter if the parent was empty, otherwise we let the
+	 * folding as it was before (already expanded, or closed by the user) */
+	expand = ! gtk_tree_model_iter_has_child(GTK_TREE_MODEL(store), parent);
+
+	/* insert the new element */
+	gtk_tree_store_append(store, iter, parent);
+	name = get_symbol_name(doc, tag, found_parent);
+	/* the tooltip is only built when shown, see sidebar.c */
+	gtk_tree_store_set(store, iter,
+			SYMBOLS_COLUMN_NAME, name,
+			SYMBOLS_COLUMN_ICON, icon,
+			SYMBOLS_COLUMN_TAG, tag,
+			-1);
+	if (G_LIKELY(icon))
+		g_object_unref(icon);
+
+	if (expand)
+		tree_view_expand_to_iter(GTK_TREE_VIEW(doc->priv->tag_tree), iter);
+}
+
+
 /* adds a new element in the parent table if it's key is known.
  * duplicates are kept */
 static void update_parents_table(GHashTable *table, const TMTag *tag, const gchar *parent_name,
@@ -1488,11 +1522,8 @@ static void update_tree_tags(GeanyDocument *doc, GList **tags)
 			geany_debug("Missing symbol-tree parent iter for type %d!", tag->type);
 		else
 		{
-			gboolean expand;
-			const gchar *name;
+			GtkTreeIter *type_iter = parent;
 			const gchar *parent_name;
-			gchar *tooltip;
-			GdkPixbuf *icon = get_child_icon(store, parent);
 
 			parent_name = get_parent_name(tag, doc->file_type->id);
 			if (parent_name)
@@ -1531,28 +1562,9 @@ static void update_tree_tags(GeanyDocument *doc, GList **tags)
 					parent_name = NULL;
 			}
 
-			/* only expand to the iter if the parent was empty, otherwise we let the
-			 * folding as it was before (already expanded, or closed by the user) */
-			expand = ! gtk_tree_model_iter_has_child(model, parent);
-
-			/* insert the new element */
-			gtk_tree_store_append(store, &iter, parent);
-			name = get_symbol_name(doc, tag, parent_name != NULL);
-			tooltip = get_symbol_tooltip(doc, tag);
-			gtk_tree_store_set(store, &iter,
-					SYMBOLS_COLUMN_NAME, name,
-					SYMBOLS_COLUMN_TOOLTIP, tooltip,
-					SYMBOLS_COLUMN_ICON, icon,
-					SYMBOLS_COLUMN_TAG, tag,
-					-1);
-			g_free(tooltip);
-			if (G_LIKELY(icon))
-				g_object_unref(icon);
+			tree_store_append_tag(doc, &iter, parent, type_iter, tag, parent_name != NULL);
 
 			update_parents_table(parents_table, tag, parent_name, &iter);
-
-			if (expand)
-				tree_view_expand_to_iter(GTK_TREE_VIEW(doc->priv->tag_tree), &iter);
 		}
 	}
 
@@ -1561,6 +1573,351 @@ static void update_tree_tags(GeanyDocument *doc, GList **tags)
 }
 
 
+/* The tags shown in a document's symbol list, so that the next update only has to change
+ * the rows of the tags which differ */
+struct SymbolRows
+{
+	GPtrArray	*tags;	/* referenced tags of the last update, sorted by compare_tag_rows() */
+	GHashTable	*iters;	/* TMTag:GtkTreeIter, for the tags which have a row */
+	filetype_id	 ft_id;
+};
+
+
+/* sort by the fields tag_equal() matches rows with */
+static gint compare_tag_identity(const TMTag *tag_a, const TMTag *tag_b)
+{
+	gint ret;
+
+	ret = strcmp(tag_a->name, tag_b->name);
+	if (ret == 0)
+		ret = tag_a->type - tag_b->type;
+	if (ret == 0)
+		ret = g_strcmp0(tag_a->atts.entry.scope, tag_b->atts.entry.scope);
+	if (ret == 0)
+		ret = g_strcmp0(tag_a->atts.entry.arglist, tag_b->atts.entry.arglist);
+	return ret;
+}
+
+
+/* sort by identity, then line */
+static gint compare_tag_rows(gconstpointer a, gconstpointer b)
+{
+	const TMTag *tag_a = *((const TMTag **) a);
+	const TMTag *tag_b = *((const TMTag **) b);
+	gint ret;
+
+	ret = compare_tag_identity(tag_a, tag_b);
+	if (ret == 0)
+		ret = tag_a->atts.entry.line - tag_b->atts.entry.line;
+	return ret;
+}
+
+
+/* whether the row of @tag_a can be kept as it is for @tag_b, which has the same identity */
+static gboolean tag_row_equal(const TMTag *tag_a, const TMTag *tag_b)
+{
+	return (tag_a->atts.entry.line == tag_b->atts.entry.line &&
+			tag_a->atts.entry.local == tag_b->atts.entry.local &&
+			tag_a->atts.entry.pointerOrder == tag_b->atts.entry.pointerOrder &&
+			tag_a->atts.entry.access == tag_b->atts.entry.access &&
+			tag_a->atts.entry.impl == tag_b->atts.entry.impl &&
+			utils_str_equal(tag_a->atts.entry.var_type, tag_b->atts.entry.var_type) &&
+			utils_str_equal(tag_a->atts.entry.inheritance, tag_b->atts.entry.inheritance));
+}
+
+
+static void free_iter_slice(gpointer data)
+{
+	g_slice_free(GtkTreeIter, data);
+}
+
+
+static void free_tag_rows_array(GPtrArray *tags)
+{
+	TMTag *tag;
+	guint i;
+
+	foreach_ptr_array(tag, i, tags)
+		tm_tag_unref(tag);
+	g_ptr_array_free(tags, TRUE);
+}
+
+
+/* returns the document tags, referenced and sorted by compare_tag_rows() */
+static GPtrArray *get_tag_rows_array(GeanyDocument *doc)
+{
+	GPtrArray *tags_array = doc->tm_file->tags_array;
+	GPtrArray *tags = g_ptr_array_sized_new(tags_array->len);
+	TMTag *tag;
+	guint i;
+
+	foreach_ptr_array(tag, i, tags_array)
+		g_ptr_array_add(tags, tm_tag_ref(tag));
+	g_ptr_array_sort(tags, compare_tag_rows);
+	return tags;
+}
+
+
+void symbols_free_tag_rows(GeanyDocument *doc)
+{
+	struct SymbolRows *rows = doc->priv->symbol_rows;
+
+	if (rows == NULL)
+		return;
+
+	free_tag_rows_array(rows->tags);
+	g_hash_table_destroy(rows->iters);
+	g_free(rows);
+	doc->priv->symbol_rows = NULL;
+}
+
+
+/* remembers the rows built by update_tree_tags() for @tags */
+static void set_tag_rows(GeanyDocument *doc, GPtrArray *tags)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(doc->priv->tag_store);
+	struct SymbolRows *rows;
+	GtkTreeIter iter;
+	gboolean cont;
+
+	symbols_free_tag_rows(doc);
+	rows = g_new0(struct SymbolRows, 1);
+	rows->tags = tags;
+	rows->iters = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_iter_slice);
+	rows->ft_id = doc->file_type->id;
+
+	cont = gtk_tree_model_get_iter_first(model, &iter);
+	while (cont)
+	{
+		TMTag *tag;
+
+		gtk_tree_model_get(model, &iter, SYMBOLS_COLUMN_TAG, &tag, -1);
+		if (tag)
+		{
+			g_hash_table_insert(rows->iters, tag, g_slice_dup(GtkTreeIter, &iter));
+			tm_tag_unref(tag);
+		}
+		cont = next_iter(model, &iter, TRUE);
+	}
+	doc->priv->symbol_rows = rows;
+}
+
+
+/* finds the row of the tag named @parent_name, like the second pass of update_tree_tags().
+ * if there are more than one, takes the one that has the closest line number before @tag */
+static GtkTreeIter *find_parent_row(struct SymbolRows *rows, const TMTag *tag,
+		const gchar *parent_name)
+{
+	GPtrArray *tags = rows->tags;
+	GtkTreeIter *parent = NULL;
+	glong delta = G_MAXLONG;
+	guint lower = 0;
+	guint upper = tags->len;
+
+	/* rows->tags is sorted by name first */
+	while (lower < upper)
+	{
+		guint middle = (lower + upper) / 2;
+
+		if (strcmp(TM_TAG(tags->pdata[middle])->name, parent_name) < 0)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+	for (; lower < tags->len; lower++)
+	{
+		const TMTag *candidate = tags->pdata[lower];
+		GtkTreeIter *iter;
+		glong d;
+
+		if (! utils_str_equal(candidate->name, parent_name))
+			break;
+
+		iter = g_hash_table_lookup(rows->iters, candidate);
+		/* prevent Foo::Foo from making parent = child */
+		if (! iter || utils_str_equal(get_parent_name(candidate, rows->ft_id), candidate->name))
+			continue;
+
+		d = tag->atts.entry.line - candidate->atts.entry.line;
+		if (! parent || (d >= 0 && d < delta))
+		{
+			delta = d;
+			parent = iter;
+		}
+	}
+	return parent;
+}
+
+
+/*
+ * Updates the tag tree for a document by only changing the rows of the tags in @tags which
+ * differ from the ones it shows.
+ * @param tags the document tags as returned by get_tag_rows_array().
+ *
+ * Tags are matched like update_tree_tags() does, by comparing both sorted tag arrays.
+ * An unchanged tag keeps its row untouched, so an update which doesn't change any tag does
+ * no tree operation at all.
+ *
+ * @return FALSE without having changed the tree if it should rather be rebuilt with
+ * update_tree_tags(), that is if a removed tag row has children or if there are many new
+ * tags, which are slow to insert one by one in a sorted tree. */
+static gboolean update_tree_tags_delta(GeanyDocument *doc, GPtrArray *tags)
+{
+	struct SymbolRows *rows = doc->priv->symbol_rows;
+	GtkTreeStore *store = doc->priv->tag_store;
+	GtkTreeModel *model = GTK_TREE_MODEL(store);
+	GPtrArray *shown;
+	GPtrArray *removed;
+	GPtrArray *changed;
+	GList *added = NULL;
+	guint added_count = 0;
+	guint i = 0;
+	guint j = 0;
+	TMTag *tag;
+	GList *item;
+
+	shown = g_ptr_array_sized_new(tags->len);
+	removed = g_ptr_array_new();
+	/* pairs of shown and new tags */
+	changed = g_ptr_array_new();
+	while (i < rows->tags->len || j < tags->len)
+	{
+		TMTag *old_tag = (i < rows->tags->len) ? rows->tags->pdata[i] : NULL;
+		TMTag *new_tag = (j < tags->len) ? tags->pdata[j] : NULL;
+		gint cmp;
+
+		if (! old_tag)
+			cmp = 1;
+		else if (! new_tag)
+			cmp = -1;
+		else
+			cmp = compare_tag_identity(old_tag, new_tag);
+
+		if (cmp < 0)
+		{
+			g_ptr_array_add(removed, old_tag);
+			i++;
+		}
+		else if (cmp > 0)
+		{
+			g_ptr_array_add(shown, tm_tag_ref(new_tag));
+			added = g_list_prepend(added, new_tag);
+			added_count++;
+			j++;
+		}
+		else
+		{
+			if (tag_row_equal(old_tag, new_tag))
+				g_ptr_array_add(shown, tm_tag_ref(old_tag));
+			else
+			{
+				g_ptr_array_add(shown, tm_tag_ref(new_tag));
+				g_ptr_array_add(changed, old_tag);
+				g_ptr_array_add(changed, new_tag);
+			}
+			i++;
+			j++;
+		}
+	}
+
+	if (added_count > 32 + tags->len / 16)
+		goto rebuild;
+	foreach_ptr_array(tag, i, removed)
+	{
+		GtkTreeIter *iter = g_hash_table_lookup(rows->iters, tag);
+
+		if (iter && gtk_tree_model_iter_has_child(model, iter))
+			goto rebuild;
+	}
+
+	foreach_ptr_array(tag, i, removed)
+	{
+		GtkTreeIter *iter = g_hash_table_lookup(rows->iters, tag);
+		GtkTreeIter parent;
+		gboolean has_parent;
+
+		if (! iter)
+			continue;
+
+		has_parent = gtk_tree_model_iter_parent(model, &parent, iter);
+		gtk_tree_store_remove(store, iter);
+		g_hash_table_remove(rows->iters, tag);
+		/* remove the toplevel item if it has no children left, like hide_empty_rows() */
+		if (has_parent && gtk_tree_store_iter_depth(store, &parent) == 0 &&
+			! gtk_tree_model_iter_has_child(model, &parent))
+			gtk_tree_store_remove(store, &parent);
+	}
+
+	for (i = 0; i < changed->len; i += 2)
+	{
+		TMTag *old_tag = changed->pdata[i];
+		TMTag *new_tag = changed->pdata[i + 1];
+		GtkTreeIter *iter = g_hash_table_lookup(rows->iters, old_tag);
+
+		if (! iter)
+			continue;
+
+		g_hash_table_steal(rows->iters, old_tag);
+		g_hash_table_insert(rows->iters, new_tag, iter);
+		/* only update fields that (can) have changed (name that holds line
+		 * number, and the tag itself). The scope is only part of the name when
+		 * the row isn't below its parent row */
+		gtk_tree_store_set(store, iter,
+				SYMBOLS_COLUMN_NAME, get_symbol_name(doc, new_tag,
+					gtk_tree_store_iter_depth(store, iter) > 1),
+				SYMBOLS_COLUMN_TAG, new_tag,
+				-1);
+	}
+
+	free_tag_rows_array(rows->tags);
+	rows->tags = shown;
+
+	if (added != NULL)
+	{
+		/* add grandparent type iters */
+		add_top_level_items(doc);
+
+		added = g_list_sort(added, compare_symbol_lines);
+		foreach_list(item, added)
+		{
+			GtkTreeIter *type_iter;
+
+			tag = item->data;
+			type_iter = get_tag_type_iter(tag->type, doc->file_type->id);
+			if (G_UNLIKELY(! type_iter))
+				geany_debug("Missing symbol-tree parent iter for type %d!", tag->type);
+			else
+			{
+				const gchar *parent_name = get_parent_name(tag, doc->file_type->id);
+				GtkTreeIter *parent = NULL;
+				GtkTreeIter iter;
+
+				if (parent_name)
+					parent = find_parent_row(rows, tag, parent_name);
+
+				tree_store_append_tag(doc, &iter, parent ? parent : type_iter, type_iter, tag,
+					parent != NULL);
+				g_hash_table_insert(rows->iters, tag, g_slice_dup(GtkTreeIter, &iter));
+			}
+		}
+		g_list_free(added);
+
+		hide_empty_rows(store);
+	}
+
+	g_ptr_array_free(removed, TRUE);
+	g_ptr_array_free(changed, TRUE);
+	return TRUE;
+
+rebuild:
+	free_tag_rows_array(shown);
+	g_ptr_array_free(removed, TRUE);
+	g_ptr_array_free(changed, TRUE);
+	g_list_free(added);
+	return FALSE;
+}
+
+
 /* we don't want to sort 1st-level nodes, but we can't return 0 because the tree sort
  * is not stable, so the order is already lost. */
 static gint compare_top_level_names(const gchar *a, const gchar *b)
@@ -1665,12 +2022,35 @@ static void sort_tree(GtkTreeStore *store, gboolean sort_by_name)
 gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode)
 {
 	GList *tags;
+	GPtrArray *tag_rows;
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
+	if (doc->tm_file == NULL || doc->tm_file->tags_array == NULL ||
+		doc->tm_file->tags_array->len == 0)
+		return FALSE;
+
+	if (sort_mode == SYMBOLS_SORT_USE_PREVIOUS)
+		sort_mode = doc->priv->symbol_list_sort_mode;
+
+	tag_rows = get_tag_rows_array(doc);
+	/* the tree is kept sorted while changing only the rows of changed tags */
+	if (doc->priv->symbol_rows != NULL &&
+		doc->priv->symbol_rows->ft_id == doc->file_type->id &&
+		sort_mode == doc->priv->symbol_list_sort_mode &&
+		update_tree_tags_delta(doc, tag_rows))
+	{
+		free_tag_rows_array(tag_rows);
+		return TRUE;
+	}
+
+	/* the sorted tag list is only needed to build the tree again */
 	tags = get_tag_list(doc, tm_tag_max_t);
 	if (tags == NULL)
+	{
+		free_tag_rows_array(tag_rows);
 		return FALSE;
+	}
 
 	/* FIXME: Not sure why we detached the model here? */
 
@@ -1686,12 +2066,11 @@ gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode)
 
 	hide_empty_rows(doc->priv->tag_store);
 
-	if (sort_mode == SYMBOLS_SORT_USE_PREVIOUS)
-		sort_mode = doc->priv->symbol_list_sort_mode;
-
 	sort_tree(doc->priv->tag_store, sort_mode == SYMBOLS_SORT_BY_NAME);
 	doc->priv->symbol_list_sort_mode = sort_mode;
 
+	set_tag_rows(doc, tag_rows);
+
 	return TRUE;
 }
 
@@ -1721,7 +2100,7 @@ static GeanyFiletype *detect_global_tags_filetype(const gchar *utf8_filename)
  * the relevant path.
  * Example:
  * CFLAGS=-I/home/user/libname-1.x geany -g libname.d.tags libname.h */
-int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess)
+int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess, gint jobs)
 {
 	/* -E pre-process, -dD output user macros, -p prof info (?) */
 	const char pre_process[] = "gcc -E -dD -p -I.";
@@ -1759,7 +2138,7 @@ int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess
 		geany_debug("Generating %s tags file.", ft->name);
 		tm_get_workspace();
 		status = tm_workspace_create_global_tags(command, (const char **) (argv + 2),
-												 argc - 2, tags_file, ft->lang);
+												 argc - 2, tags_file, ft->lang, jobs);
 		g_free(command);
 		symbols_finalize(); /* free c_tags_ignore data */
 		if (! status)
@@ -1771,7 +2150,7 @@ int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess
 	}
 	else
 	{
-		g_printerr(_("Usage: %s -g <Tag File> <File list>\n\n"), argv[0]);
+		g_printerr(_("Usage: %s -g [-j <Jobs>] <Tag File> <File list>\n\n"), argv[0]);
 		g_printerr(_("Example:\n"
 			"CFLAGS=`pkg-config gtk+-2.0 --cflags` %s -g gtk2.c.tags"
 			" /usr/include/gtk-2.0/gtk/gtk.h\n"), argv[0]);
@@ -2112,7 +2491,7 @@ static gint get_current_tag_name(GeanyDocument *doc, gchar **tagname, guint tag_
 	if (parent >= 0 && doc->tm_file != NULL && doc->tm_file->tags_array != NULL &&
 		(! doc->changed || editor_prefs.autocompletion_update_freq > 0))
 	{
-		const TMTag *tag = tm_get_current_tag(doc->tm_file->tags_array, parent + 1, tag_types);
+		const TMTag *tag = tm_source_file_get_tag_at_line(doc->tm_file, parent + 1, tag_types);
 
 		if (tag)
 		{
@@ -2178,6 +2557,27 @@ static gint get_current_tag_name(GeanyDocument *doc, gchar **tagname, guint tag_
 }
 
 
+/* Updates the statusbar once idle styling has reached the current line. */
+static gboolean on_current_line_styled(gpointer data)
+{
+	GeanyDocument *doc = document_get_current();
+	ScintillaObject *sci;
+
+	if (doc == NULL)
+	{
+		current_line_styled_id = 0;
+		return FALSE;
+	}
+	sci = doc->editor->sci;
+	if (sci_get_line_end_position(sci, sci_get_current_line(sci)) > sci_get_end_styled(sci))
+		return TRUE;
+
+	current_line_styled_id = 0;
+	ui_update_statusbar(doc, -1);
+	return FALSE;
+}
+
+
 static gint get_current_tag_name_cached(GeanyDocument *doc, const gchar **tagname, guint tag_types)
 {
 	static gint tag_line = -1;
@@ -2195,7 +2595,23 @@ static gint get_current_tag_name_cached(GeanyDocument *doc, const gchar **tagnam
 	else
 	{
 		gint line = sci_get_current_line(doc->editor->sci);
-		gint fold_level = sci_get_fold_level(doc->editor->sci, line);
+		gint fold_level;
+
+		/* the rest of the document may still be styled in idle time, so the fold points of
+		 * the current line are not known yet. Rather than styling up to it here, report the
+		 * tag as unknown and update the statusbar once idle styling has reached it */
+		if (sci_get_line_end_position(doc->editor->sci, line) > sci_get_end_styled(doc->editor->sci))
+		{
+			current_tag_changed(NULL, -1, -1, 0);
+			g_free(cur_tag);
+			cur_tag = g_strdup(_("unknown"));
+			*tagname = cur_tag;
+			tag_line = -1;
+			if (current_line_styled_id == 0)
+				current_line_styled_id = g_timeout_add(250, on_current_line_styled, NULL);
+			return tag_line;
+		}
+		fold_level = sci_get_fold_level(doc->editor->sci, line);
 
 		if (current_tag_changed(doc, line, fold_level, tag_types))
 		{
@@ -2358,6 +2774,8 @@ void symbols_init(void)
 
 void symbols_finalize(void)
 {
+	if (current_line_styled_id != 0)
+		g_source_remove(current_line_styled_id);
 	g_strfreev(html_entities);
 	g_strfreev(c_tags_ignore);
 }
@@ -53,7 +53,11 @@ const gchar **symbols_get_html_entities(void);
 
 gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode);
 
-gint symbols_generate_global_tags(gint argc, gchar **argv, gboolean want_preprocess);
+void symbols_free_tag_rows(GeanyDocument *doc);
+
+gchar *symbols_get_tag_tooltip(GeanyDocument *doc, const TMTag *tag);
+
+gint symbols_generate_global_tags(gint argc, gchar **argv, gboolean want_preprocess, gint jobs);
 
 void symbols_show_load_tags_dialog(void);
 
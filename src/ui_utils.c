@@ -86,6 +86,24 @@ static struct
 }
 widgets;
 
+/* names of the GeanyUIUpdateFlags bits, for the debug messages */
+static const gchar *queued_update_names[] = {
+	"statusbar",
+	"undo/redo items",
+	"window title"
+};
+
+static struct
+{
+	guint	flags;		/* GeanyUIUpdateFlags waiting for flush_queued_updates() */
+	guint	source_id;
+	guint	flushes;
+	/* counters per GeanyUIUpdateFlags bit, to see how many updates were saved */
+	guint	requested[G_N_ELEMENTS(queued_update_names)];
+	guint	done[G_N_ELEMENTS(queued_update_names)];
+}
+queued_updates;
+
 enum
 {
 	RECENT_FILE_FILE,
@@ -460,6 +478,61 @@ void ui_update_popup_reundo_items(GeanyDocument *doc)
 }
 
 
+static gboolean flush_queued_updates(G_GNUC_UNUSED gpointer data)
+{
+	GeanyDocument *doc = document_get_current();
+	guint flags = queued_updates.flags;
+	guint i;
+
+	queued_updates.flags = 0;
+	queued_updates.source_id = 0;
+
+	if (main_status.quitting)
+		return FALSE;
+
+	if (flags & GEANY_UI_UPDATE_WINDOW_TITLE)
+		ui_set_window_title(doc);
+	if (flags & GEANY_UI_UPDATE_REUNDO_ITEMS)
+		ui_update_popup_reundo_items(doc);
+	if (flags & GEANY_UI_UPDATE_STATUSBAR)
+		ui_update_statusbar(doc, -1);
+
+	for (i = 0; i < G_N_ELEMENTS(queued_update_names); i++)
+	{
+		if (flags & (1 << i))
+			queued_updates.done[i]++;
+	}
+	if (++queued_updates.flushes % 1000 == 0)
+	{
+		for (i = 0; i < G_N_ELEMENTS(queued_update_names); i++)
+			geany_debug("UI updates of the %s: %u requested, %u done", queued_update_names[i],
+				queued_updates.requested[i], queued_updates.done[i]);
+	}
+	return FALSE;
+}
+
+
+/* Updates the statusbar, the undo/redo items and/or the window title for the current
+ * document later, so that many requests e.g. while a key is held down or a macro runs
+ * cause only one update.
+ * GTK 2 has no frame clock, so the updates are done in an idle callback with a priority
+ * above GTK's resizing and redrawing, i.e. once before each frame. */
+void ui_queue_update(GeanyUIUpdateFlags flags)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(queued_update_names); i++)
+	{
+		if (flags & (1 << i))
+			queued_updates.requested[i]++;
+	}
+	queued_updates.flags |= flags;
+	if (queued_updates.source_id == 0)
+		queued_updates.source_id = g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+			flush_queued_updates, NULL, NULL);
+}
+
+
 void ui_update_popup_copy_items(GeanyDocument *doc)
 {
 	gboolean enable;
@@ -2241,6 +2314,8 @@ void ui_finalize_builder(void)
 
 void ui_finalize(void)
 {
+	if (queued_updates.source_id != 0)
+		g_source_remove(queued_updates.source_id);
 	g_free(statusbar_template);
 }
 
@@ -165,6 +165,17 @@ typedef enum
 GeanyUIEditorFeatures;
 
 
+/* Parts of the interface showing the current document which can be updated together,
+ * see ui_queue_update() */
+typedef enum
+{
+	GEANY_UI_UPDATE_STATUSBAR		= 1 << 0,
+	GEANY_UI_UPDATE_REUNDO_ITEMS	= 1 << 1,
+	GEANY_UI_UPDATE_WINDOW_TITLE	= 1 << 2
+}
+GeanyUIUpdateFlags;
+
+
 #define GEANY_STOCK_SAVE_ALL "geany-save-all"
 #define GEANY_STOCK_CLOSE_ALL "geany-close-all"
 #define GEANY_STOCK_BUILD "geany-build"
@@ -269,6 +280,8 @@ void ui_set_fullscreen(void);
 
 void ui_update_popup_reundo_items(GeanyDocument *doc);
 
+void ui_queue_update(GeanyUIUpdateFlags flags);
+
 void ui_update_popup_copy_items(GeanyDocument *doc);
 
 void ui_update_popup_goto_items(gboolean enable);
@@ -64,6 +64,8 @@ enum pType { PTRN_TAG, PTRN_CALLBACK };
 
 typedef struct {
 	GRegex *pattern;
+	char *literal;  /* contained in every match, or NULL */
+	boolean caseless;
 	enum pType type;
 	union {
 		struct {
@@ -78,9 +80,22 @@ typedef struct {
 
 #endif
 
+/* Aho-Corasick automaton finding the literals of a pattern set in one pass
+ * over a line, so that only the patterns which can match are run.
+ */
+typedef struct {
+	unsigned char classes [256];  /* bytes in literals, ASCII case folded */
+	unsigned int classCount;      /* class 0 is for the other bytes */
+	unsigned int stateCount;
+	int *next;                    /* state after each state and byte class */
+	int **outputs;                /* -1 terminated patterns found at a state */
+	boolean *candidates;          /* patterns which may match the line */
+} patternFilter;
+
 typedef struct {
 	regexPattern *patterns;
 	unsigned int count;
+	patternFilter *filter;  /* built on first use */
 } patternSet;
 
 /*
@@ -97,17 +112,40 @@ static int SetUpper = -1;  /* upper language index in list */
 *   FUNCTION DEFINITIONS
 */
 
+static void freePatternFilter (patternSet* const set)
+{
+	patternFilter* const filter = set->filter;
+	if (filter != NULL)
+	{
+		unsigned int i;
+		for (i = 0  ;  i < filter->stateCount  ;  ++i)
+			if (filter->outputs [i] != NULL)
+				eFree (filter->outputs [i]);
+		eFree (filter->outputs);
+		eFree (filter->next);
+		eFree (filter->candidates);
+		eFree (filter);
+		set->filter = NULL;
+	}
+}
+
 static void clearPatternSet (const langType language)
 {
 	if (language <= SetUpper)
 	{
 		patternSet* const set = Sets + language;
 		unsigned int i;
+		freePatternFilter (set);
 		for (i = 0  ;  i < set->count  ;  ++i)
 		{
 			regexPattern *p = &set->patterns [i];
 			g_regex_unref(p->pattern);
 			p->pattern = NULL;
+			if (p->literal != NULL)
+			{
+				eFree (p->literal);
+				p->literal = NULL;
+			}
 
 			if (p->type == PTRN_TAG)
 			{
@@ -246,6 +284,7 @@ static boolean parseTagRegex (
 
 static void addCompiledTagPattern (
 		const langType language, GRegex* const pattern,
+		char* const literal, const boolean caseless,
 		char* const name, const char kind, char* const kindName,
 		char *const description)
 {
@@ -259,15 +298,19 @@ static void addCompiledTagPattern (
 		{
 			Sets [i].patterns = NULL;
 			Sets [i].count = 0;
+			Sets [i].filter = NULL;
 		}
 		SetUpper = language;
 	}
 	set = Sets + language;
+	freePatternFilter (set);
 	set->patterns = xRealloc (set->patterns, (set->count + 1), regexPattern);
 	ptrn = &set->patterns [set->count];
 	set->count += 1;
 
 	ptrn->pattern = pattern;
+	ptrn->literal = literal;
+	ptrn->caseless = caseless;
 	ptrn->type    = PTRN_TAG;
 	ptrn->u.tag.name_pattern = name;
 	ptrn->u.tag.kind.enabled = TRUE;
@@ -278,6 +321,7 @@ static void addCompiledTagPattern (
 
 static void addCompiledCallbackPattern (
 		const langType language, GRegex* const pattern,
+		char* const literal, const boolean caseless,
 		const regexCallback callback)
 {
 	patternSet* set;
@@ -290,15 +334,19 @@ static void addCompiledCallbackPattern (
 		{
 			Sets [i].patterns = NULL;
 			Sets [i].count = 0;
+			Sets [i].filter = NULL;
 		}
 		SetUpper = language;
 	}
 	set = Sets + language;
+	freePatternFilter (set);
 	set->patterns = xRealloc (set->patterns, (set->count + 1), regexPattern);
 	ptrn = &set->patterns [set->count];
 	set->count += 1;
 
 	ptrn->pattern = pattern;
+	ptrn->literal = literal;
+	ptrn->caseless = caseless;
 	ptrn->type    = PTRN_CALLBACK;
 	ptrn->u.callback.function = callback;
 }
@@ -330,6 +378,178 @@ static GRegex* compileRegex (const char* const regexp, const char* const flags)
 	return result;
 }
 
+static boolean isCaseless (const char* const flags)
+{
+	return (boolean) (flags != NULL  &&  strchr (flags, 'i') != NULL);
+}
+
+/* Returns the last character of the escape sequence starting with the
+ * letter or digit at `p'.
+ */
+static const char* skipEscape (const char* p)
+{
+	const char c = *p;
+	if (p [1] == '{'  &&  strchr ("xopPgkN", c) != NULL)
+	{
+		const char* const end = strchr (p, '}');
+		return (end != NULL) ? end : p + strlen (p) - 1;
+	}
+	switch (c)
+	{
+		case 'x':
+			if (isxdigit ((int) p [1])) ++p;
+			if (isxdigit ((int) p [1])) ++p;
+			break;
+		case 'c': case 'p': case 'P':
+			if (p [1] != '\0') ++p;
+			break;
+		case 'g': case 'k':
+			if (p [1] == '<'  ||  p [1] == '\'')
+			{
+				const char* const end = strchr (p + 2, (p [1] == '<') ? '>' : '\'');
+				if (end != NULL)
+					p = end;
+			}
+			else
+			{
+				if (p [1] == '-'  ||  p [1] == '+') ++p;
+				while (isdigit ((int) p [1])) ++p;
+			}
+			break;
+		default:
+			/* back-references and octal characters */
+			while (isdigit ((int) c)  &&  isdigit ((int) p [1])) ++p;
+			break;
+	}
+	return p;
+}
+
+/* Removes the last, possibly multibyte, character of `string'. */
+static void chopCharacter (vString* const string)
+{
+	while (vStringLength (string) > 0)
+	{
+		const int c = (unsigned char) vStringItem (string, vStringLength (string) - 1);
+		vStringChop (string);
+		if ((c & 0xC0) != 0x80)
+			break;
+	}
+}
+
+static void endLiteralRun (vString* const run, vString* const best)
+{
+	if (vStringLength (run) > vStringLength (best))
+		vStringCopy (best, run);
+	vStringClear (run);
+}
+
+/* Returns the longest string contained in every match of `regexp', in lower
+ * case for caseless patterns, or NULL if none was found. Anything not
+ * understood ends the current run of literal characters, so only strings
+ * which are certainly required are returned.
+ */
+static char* requiredLiteral (const char* const regexp, const boolean caseless)
+{
+	vString* const run = vStringNew ();
+	vString* const best = vStringNew ();
+	boolean usable = TRUE;
+	boolean lastLiteral = FALSE;
+	int depth = 0;
+	const char* p;
+	char* result = NULL;
+
+	for (p = regexp  ;  *p != '\0'  &&  usable  ;  ++p)
+	{
+		int c = (unsigned char) *p;
+		boolean literal = FALSE;
+
+		if (c == '[')
+		{
+			/* skip the character class */
+			++p;
+			if (*p == '^') ++p;
+			if (*p == ']') ++p;
+			while (*p != '\0'  &&  *p != ']')
+			{
+				if (*p == '\\'  &&  p [1] != '\0')
+					++p;
+				else if (*p == '['  &&  p [1] == ':'  &&  strstr (p, ":]") != NULL)
+					p = strstr (p, ":]") + 1;
+				++p;
+			}
+			if (*p == '\0')
+				break;
+		}
+		else if (c == '\\')
+		{
+			c = (unsigned char) *++p;
+			if (c == '\0')
+				break;
+			else if (c == 'Q')
+				usable = FALSE;  /* quoted text isn't parsed */
+			else if (g_ascii_isalnum (c))
+				p = skipEscape (p);
+			else
+				literal = TRUE;
+		}
+		else if (depth > 0)
+		{
+			if (c == '(')
+				++depth;
+			else if (c == ')')
+				--depth;
+		}
+		else if (c == '(')
+		{
+			/* options like (?i) change how the following text matches */
+			if (p [1] == '?'  &&  p [2] != '\0'  &&  strchr ("imsxJUX-", p [2]) != NULL)
+				usable = FALSE;
+			++depth;
+		}
+		else if (c == '|'  ||  c == ')')
+			usable = FALSE;
+		else if (c == '?'  ||  c == '*')
+		{
+			if (lastLiteral)
+				chopCharacter (run);
+		}
+		else if (c == '{')
+		{
+			const char* q = p + 1;
+			while (isdigit ((int) *q)) ++q;
+			if (q > p + 1  &&  *q == ',') ++q;
+			while (isdigit ((int) *q)) ++q;
+			if (q > p + 1  &&  *q == '}')
+			{
+				/* a quantifier, the previous character may not be required */
+				if (lastLiteral  &&  atoi (p + 1) == 0)
+					chopCharacter (run);
+				p = q;
+			}
+		}
+		else if (c != '+'  &&  c != '^'  &&  c != '$'  &&  c != '.')
+			literal = TRUE;
+
+		/* literals inside groups may be optional or alternatives; caseless ASCII
+		 * letters 'k' and 's' also match non-ASCII characters */
+		if (literal  &&  (depth > 0  ||  (caseless  &&
+			(c >= 0x80  ||  strchr ("kKsS", c) != NULL))))
+			literal = FALSE;
+
+		if (literal)
+			vStringPut (run, caseless ? g_ascii_tolower (c) : c);
+		else
+			endLiteralRun (run, best);
+		lastLiteral = literal;
+	}
+	endLiteralRun (run, best);
+	if (usable  &&  vStringLength (best) > 0)
+		result = eStrdup (vStringValue (best));
+	vStringDelete (run);
+	vStringDelete (best);
+	return result;
+}
+
 #endif
 
 static void parseKinds (
@@ -506,6 +726,141 @@ static boolean matchRegexPattern (const vString* const line,
 	return result;
 }
 
+static void addFilterOutput (patternFilter* const filter,
+		const int state, const int* const patterns)
+{
+	int count = 0, added = 0;
+	if (filter->outputs [state] != NULL)
+		while (filter->outputs [state] [count] != -1)
+			++count;
+	while (patterns [added] != -1)
+		++added;
+	filter->outputs [state] = xRealloc (filter->outputs [state], count + added + 1, int);
+	memcpy (filter->outputs [state] + count, patterns, (added + 1) * sizeof (int));
+}
+
+static patternFilter* newPatternFilter (const patternSet* const set)
+{
+	patternFilter* const filter = xCalloc (1, patternFilter);
+	unsigned int maxStates = 1;
+	unsigned int i, c;
+	int *fail, *queue;
+	unsigned int head = 0, tail = 0;
+
+	/* each byte used in a literal gets its own class, matching both cases
+	 * of ASCII letters */
+	filter->classCount = 1;
+	for (i = 0  ;  i < set->count  ;  ++i)
+	{
+		const char* p = set->patterns [i].literal;
+		for ( ;  p != NULL  &&  *p != '\0'  ;  ++p, ++maxStates)
+		{
+			c = (unsigned char) g_ascii_tolower (*p);
+			if (filter->classes [c] == 0)
+			{
+				filter->classes [c] = filter->classCount;
+				filter->classes [(unsigned char) g_ascii_toupper (c)] = filter->classCount;
+				++filter->classCount;
+			}
+		}
+	}
+	filter->next = xMalloc (maxStates * filter->classCount, int);
+	for (i = 0  ;  i < maxStates * filter->classCount  ;  ++i)
+		filter->next [i] = -1;
+	filter->outputs = xCalloc (maxStates, int*);
+	filter->candidates = xMalloc (set->count, boolean);
+
+	/* the trie of the literals */
+	filter->stateCount = 1;
+	for (i = 0  ;  i < set->count  ;  ++i)
+	{
+		const char* p = set->patterns [i].literal;
+		int state = 0;
+		int output [2];
+		if (p == NULL)
+			continue;
+		for ( ;  *p != '\0'  ;  ++p)
+		{
+			int* const next = filter->next + state * filter->classCount +
+				filter->classes [(unsigned char) *p];
+			if (*next == -1)
+				*next = filter->stateCount++;
+			state = *next;
+		}
+		output [0] = i;
+		output [1] = -1;
+		addFilterOutput (filter, state, output);
+	}
+
+	/* complete the transitions with the failure links, breadth first so the
+	 * outputs of shorter suffixes are known when they are added */
+	fail = xMalloc (filter->stateCount, int);
+	queue = xMalloc (filter->stateCount, int);
+	for (c = 0  ;  c < filter->classCount  ;  ++c)
+	{
+		int* const next = filter->next + c;
+		if (*next == -1)
+			*next = 0;
+		else
+		{
+			fail [*next] = 0;
+			queue [tail++] = *next;
+		}
+	}
+	while (head < tail)
+	{
+		const int state = queue [head++];
+		for (c = 0  ;  c < filter->classCount  ;  ++c)
+		{
+			int* const next = filter->next + state * filter->classCount + c;
+			const int fallback = filter->next [fail [state] * filter->classCount + c];
+			if (*next == -1)
+				*next = fallback;
+			else
+			{
+				fail [*next] = fallback;
+				if (filter->outputs [fallback] != NULL)
+					addFilterOutput (filter, *next, filter->outputs [fallback]);
+				queue [tail++] = *next;
+			}
+		}
+	}
+	eFree (fail);
+	eFree (queue);
+	return filter;
+}
+
+/* Marks the patterns of `set' which may match `line': those without a
+ * literal and those whose literal is in the line.
+ */
+static void findCandidatePatterns (const patternSet* const set, const vString* const line)
+{
+	const patternFilter* const filter = set->filter;
+	const char* const text = vStringValue (line);
+	const size_t length = vStringLength (line);
+	unsigned int i;
+	int state = 0;
+
+	for (i = 0  ;  i < set->count  ;  ++i)
+		filter->candidates [i] = (boolean) (set->patterns [i].literal == NULL);
+	for (i = 0  ;  i < length  ;  ++i)
+	{
+		const int* output;
+		state = filter->next [state * filter->classCount +
+			filter->classes [(unsigned char) text [i]]];
+		for (output = filter->outputs [state]  ;
+			 output != NULL  &&  *output != -1  ;  ++output)
+		{
+			const regexPattern* const ptrn = set->patterns + *output;
+			const size_t len = strlen (ptrn->literal);
+			/* the automaton ignores case, check case-sensitive literals */
+			if (ptrn->caseless  ||
+				strncmp (text + i + 1 - len, ptrn->literal, len) == 0)
+				filter->candidates [*output] = TRUE;
+		}
+	}
+}
+
 #endif
 
 /* PUBLIC INTERFACE */
@@ -519,10 +874,14 @@ extern boolean matchRegex (const vString* const line, const langType language)
 	if (language != LANG_IGNORE  &&  language <= SetUpper  &&
 		Sets [language].count > 0)
 	{
-		const patternSet* const set = Sets + language;
+		patternSet* const set = Sets + language;
 		unsigned int i;
+		if (set->filter == NULL)
+			set->filter = newPatternFilter (set);
+		findCandidatePatterns (set, line);
 		for (i = 0  ;  i < set->count  ;  ++i)
-			if (matchRegexPattern (line, set->patterns + i))
+			if (set->filter->candidates [i]  &&
+				matchRegexPattern (line, set->patterns + i))
 				result = TRUE;
 	}
 	return result;
@@ -556,8 +915,9 @@ extern void addTagRegex (
 			char* kindName;
 			char* description;
 			parseKinds (kinds, &kind, &kindName, &description);
-			addCompiledTagPattern (language, cp, eStrdup (name),
-					kind, kindName, description);
+			addCompiledTagPattern (language, cp,
+					requiredLiteral (regex, isCaseless (flags)), isCaseless (flags),
+					eStrdup (name), kind, kindName, description);
 		}
 	}
 #endif
@@ -575,7 +935,9 @@ extern void addCallbackRegex (
 	{
 		GRegex* const cp = compileRegex (regex, flags);
 		if (cp != NULL)
-			addCompiledCallbackPattern (language, cp, callback);
+			addCompiledCallbackPattern (language, cp,
+					requiredLiteral (regex, isCaseless (flags)), isCaseless (flags),
+					callback);
 	}
 #endif
 }
@@ -30,6 +30,18 @@
 inputFile File;			/* globally read through macros */
 static MIOPos StartOfLine;	/* holds deferred position of start of line */
 
+/*  Input held in memory is split into lines directly rather than being read
+ *  a character at a time. The offsets of the next line feed and carriage
+ *  return are remembered so that each is searched for only once.
+ */
+static struct sInputBuffer {
+    const unsigned char *data;	/* contents of the memory stream */
+    size_t size;		/* length of data */
+    size_t position;		/* offset of the next line to scan */
+    size_t nextNewline;		/* offset of next LF at or after position */
+    size_t nextReturn;		/* offset of next CR at or after position */
+} Buffer;
+
 
 
 /* Read a character choosing automatically between file or buffer, depending
@@ -246,17 +258,26 @@ static boolean parseLineDirective (void)
  *   Source file I/O operations
  */
 
+static void resetInputBuffer (void)
+{
+    gsize size = 0;
+
+    Buffer.data = mio_memory_get_data (File.mio, &size);
+    Buffer.size = size;
+    Buffer.position = 0;
+    Buffer.nextNewline = size + 1;	/* not searched yet */
+    Buffer.nextReturn = size + 1;
+}
+
 /*  This function opens a source file, and resets the line counter.  If it
  *  fails, it will display an error message and leave the File.fp set to NULL.
  */
 extern boolean fileOpen (const char *const fileName, const langType language)
 {
-#ifdef VMS
-    const char *const openMode = "r";
-#else
-    const char *const openMode = "rb";
-#endif
     boolean opened = FALSE;
+    gchar *contents;
+    gsize length;
+    GError *err = NULL;
 
     /*	If another file was already open, then close it.
      */
@@ -266,14 +287,27 @@ extern boolean fileOpen (const char *const fileName, const langType language)
 	File.mio = NULL;
     }
 
-    File.mio = mio_new_file_full (fileName, openMode, g_fopen, fclose);
+    /*	Read the whole file at once so that lines can be scanned in memory.
+     */
+    if (g_file_get_contents (fileName, &contents, &length, &err))
+	File.mio = mio_new_memory ((unsigned char *) contents, length, NULL, g_free);
     if (File.mio == NULL)
-	error (WARNING | PERROR, "cannot open \"%s\"", fileName);
+    {
+	/*  errno is not set by g_file_get_contents(), so report its error */
+	if (err != NULL)
+	{
+	    error (WARNING, "cannot open \"%s\": %s", fileName, err->message);
+	    g_error_free (err);
+	}
+	else
+	    error (WARNING, "cannot open \"%s\"", fileName);
+    }
     else
     {
 	opened = TRUE;
 
 	setInputFileName (fileName);
+	resetInputBuffer ();
 	mio_getpos (File.mio, &StartOfLine);
 	mio_getpos (File.mio, &File.filePosition);
 	File.currentLine  = NULL;
@@ -320,6 +354,7 @@ extern boolean bufferOpen (unsigned char *buffer, int buffer_size,
 	    
     File.mio = mio_new_memory (buffer, buffer_size, NULL, NULL);
     setInputFileName (fileName);
+    resetInputBuffer ();
     mio_getpos (File.mio, &StartOfLine);
     mio_getpos (File.mio, &File.filePosition);
     File.currentLine  = NULL;
@@ -431,29 +466,124 @@ extern void fileUngetc (int c)
     File.ungetch = c;
 }
 
+/*  Picks up the stream position, which is moved by the character at a time
+ *  reads and by the source line lookups of parsers.
+ */
+static void syncInputBuffer (void)
+{
+    const size_t position = (size_t) mio_tell (File.mio);
+
+    if (position != Buffer.position)
+    {
+	Buffer.position = position;
+	Buffer.nextNewline = Buffer.size + 1;
+	Buffer.nextReturn = Buffer.size + 1;
+    }
+}
+
+static size_t findInBuffer (size_t *const cached, const int c)
+{
+    if (*cached < Buffer.position  ||  *cached > Buffer.size)
+    {
+	const unsigned char *const found = memchr (Buffer.data + Buffer.position,
+				c, Buffer.size - Buffer.position);
+	*cached = (found == NULL) ? Buffer.size : (size_t) (found - Buffer.data);
+    }
+    return *cached;
+}
+
+/*  Reads the next line of a memory stream into "line", performing the same
+ *  newline canonicalization as iFileGetc (). Returns FALSE at end of input.
+ */
+static boolean readBufferLine (vString *const line)
+{
+    const size_t start = Buffer.position;
+    size_t end, next, length;
+
+    if (start >= Buffer.size)
+    {
+	File.eof = TRUE;
+	return FALSE;
+    }
+    fileNewline ();
+
+    end = findInBuffer (&Buffer.nextNewline, NEWLINE);
+    next = findInBuffer (&Buffer.nextReturn, CRETURN);
+    if (next < end)
+    {
+	end = next;
+	++next;
+	if (next < Buffer.size  &&  Buffer.data [next] == NEWLINE)
+	    ++next;
+    }
+    else
+	next = (end < Buffer.size) ? end + 1 : end;
+
+    length = end - start;
+    while (vStringSize (line) < length + 2)
+	vStringAutoResize (line);
+    memcpy (vStringValue (line), Buffer.data + start, length);
+    line->length = length;
+    if (memchr (vStringValue (line), '\0', length) != NULL)
+    {
+	/*  Null characters are dropped, as vStringPut () does */
+	size_t i, j = 0;
+	for (i = 0  ;  i < length  ;  ++i)
+	    if (vStringItem (line, i) != '\0')
+		vStringItem (line, j++) = vStringItem (line, i);
+	line->length = j;
+    }
+    if (end < Buffer.size)
+    {
+	vStringPut (line, NEWLINE);
+	File.newLine = TRUE;
+    }
+    else
+	File.eof = TRUE;
+    vStringTerminate (line);
+
+    Buffer.position = next;
+    mio_seek (File.mio, (long) next, SEEK_SET);
+    mio_getpos (File.mio, &StartOfLine);
+    DebugStatement ( debugPrintf (DEBUG_RAW, "%s", vStringValue (line)); )
+    return TRUE;
+}
+
 static vString *iFileGetLine (void)
 {
     vString *result = NULL;
+    boolean scan = FALSE;
     int c;
     if (File.line == NULL)
 	File.line = vStringNew ();
     vStringClear (File.line);
-    do
+
+    /*	Lines which may be line directives are read a character at a time.
+     */
+    if (Buffer.data != NULL  &&  File.newLine)
+    {
+	syncInputBuffer ();
+	scan = (boolean) ! (Option.lineDirectives  &&
+		Buffer.position < Buffer.size  &&
+		Buffer.data [Buffer.position] == '#');
+    }
+    if (scan)
+	readBufferLine (File.line);
+    else do
     {
 	c = iFileGetc ();
 	if (c != EOF)
 	    vStringPut (File.line, c);
-	if (c == '\n'  ||  (c == EOF  &&  vStringLength (File.line) > 0))
-	{
-	    vStringTerminate (File.line);
+    } while (c != EOF  &&  c != '\n');
+
+    if (vStringLength (File.line) > 0)
+    {
+	vStringTerminate (File.line);
 #ifdef HAVE_REGEX
-	    if (vStringLength (File.line) > 0)
-		matchRegex (File.line, File.source.language);
+	matchRegex (File.line, File.source.language);
 #endif
-	    result = File.line;
-	    break;
-	}
-    } while (c != EOF);
+	result = File.line;
+    }
     Assert (result != NULL  ||  File.eof);
     return result;
 }
@@ -49,6 +49,7 @@ gboolean tm_source_file_init(TMSourceFile *source_file, const char *file_name
 		return FALSE;
 
 	source_file->inactive = FALSE;
+	source_file->scope_tags = NULL;
 	if (NULL == LanguageTable)
 	{
 		initializeParsing();
@@ -69,6 +70,92 @@ gboolean tm_source_file_init(TMSourceFile *source_file, const char *file_name
 	return TRUE;
 }
 
+static void free_scope_tags(TMSourceFile *source_file)
+{
+	if (NULL != source_file->scope_tags)
+	{
+		g_ptr_array_free(source_file->scope_tags, TRUE);
+		source_file->scope_tags = NULL;
+	}
+}
+
+static gint compare_tag_lines(gconstpointer a, gconstpointer b)
+{
+	const TMTag *t1 = *((const TMTag **) a);
+	const TMTag *t2 = *((const TMTag **) b);
+
+	if (t1->atts.entry.line != t2->atts.entry.line)
+		return (t1->atts.entry.line < t2->atts.entry.line) ? -1 : 1;
+	/* tm_get_current_tag() picks the first of several tags on a line in name order */
+	return strcmp(t1->name, t2->name);
+}
+
+static void build_scope_tags(TMSourceFile *source_file)
+{
+	GPtrArray *tags = source_file->work_object.tags_array;
+	guint i;
+
+	free_scope_tags(source_file);
+	source_file->scope_tags = g_ptr_array_new();
+	if (NULL == tags)
+		return;
+	for (i = 0; i < tags->len; ++i)
+	{
+		TMTag *tag = TM_TAG(tags->pdata[i]);
+
+		if (tag->type & TM_SOURCE_FILE_SCOPE_TYPES)
+			g_ptr_array_add(source_file->scope_tags, tag);
+	}
+	g_ptr_array_sort(source_file->scope_tags, compare_tag_lines);
+}
+
+const TMTag *tm_source_file_get_tag_at_line(TMWorkObject *source_file, gulong line,
+		guint tag_types)
+{
+	TMSourceFile *file = TM_SOURCE_FILE(source_file);
+	GPtrArray *tags;
+	const TMTag *matching_tag = NULL;
+	guint lower = 0;
+	guint upper;
+
+	g_return_val_if_fail(NULL != source_file, NULL);
+
+	/* tags read from a tags file rather than parsed have no index yet */
+	if (NULL == file->scope_tags)
+		build_scope_tags(file);
+	tags = file->scope_tags;
+
+	/* find the first tag after line */
+	upper = tags->len;
+	while (lower < upper)
+	{
+		guint middle = (lower + upper) / 2;
+
+		if (TM_TAG(tags->pdata[middle])->atts.entry.line <= line)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+	while (lower > 0 && NULL == matching_tag)
+	{
+		const TMTag *tag = TM_TAG(tags->pdata[--lower]);
+
+		if (tag->type & tag_types)
+			matching_tag = tag;
+	}
+	/* prefer the first matching tag of the line */
+	while (NULL != matching_tag && lower > 0)
+	{
+		const TMTag *tag = TM_TAG(tags->pdata[--lower]);
+
+		if (tag->atts.entry.line != matching_tag->atts.entry.line)
+			break;
+		if (tag->type & tag_types)
+			matching_tag = tag;
+	}
+	return matching_tag;
+}
+
 TMWorkObject *tm_source_file_new(const char *file_name, gboolean update, const char *name)
 {
 	TMSourceFile *source_file = g_new(TMSourceFile, 1);
@@ -91,6 +178,7 @@ void tm_source_file_destroy(TMSourceFile *source_file)
 		tm_tags_array_free(TM_WORK_OBJECT(source_file)->tags_array, TRUE);
 		TM_WORK_OBJECT(source_file)->tags_array = NULL;
 	}
+	free_scope_tags(source_file);
 	tm_work_object_destroy(&(source_file->work_object));
 }
 
@@ -133,6 +221,7 @@ gboolean tm_source_file_parse(TMSourceFile *source_file)
 	if (source_file->lang < 0 || ! LanguageTable [source_file->lang]->enabled)
 		return status;
 
+	free_scope_tags(source_file);
 	while ((TRUE == status) && (passCount < 3))
 	{
 		if (source_file->work_object.tags_array)
@@ -203,6 +292,8 @@ gboolean tm_source_file_buffer_parse(TMSourceFile *source_file, guchar* text_buf
 	else
 	{
 		int passCount = 0;
+
+		free_scope_tags(source_file);
 		while ((TRUE == status) && (passCount < 3))
 		{
 			if (source_file->work_object.tags_array)
@@ -271,6 +362,7 @@ gboolean tm_source_file_update(TMWorkObject *source_file, gboolean force
 	{
 		tm_source_file_parse(TM_SOURCE_FILE(source_file));
 		tm_tags_sort(source_file->tags_array, NULL, FALSE);
+		build_scope_tags(TM_SOURCE_FILE(source_file));
 		/* source_file->analyze_time = tm_get_file_timestamp(source_file->file_name); */
 		if ((source_file->parent) && update_parent)
 		{
@@ -296,6 +388,7 @@ gboolean tm_source_file_buffer_update(TMWorkObject *source_file, guchar* text_bu
 
 	tm_source_file_buffer_parse (TM_SOURCE_FILE(source_file), text_buf, buf_size);
 	tm_tags_sort(source_file->tags_array, NULL, FALSE);
+	build_scope_tags(TM_SOURCE_FILE(source_file));
 	/* source_file->analyze_time = time(NULL); */
 	if ((source_file->parent) && update_parent)
 	{
@@ -42,8 +42,14 @@ typedef struct
 	TMWorkObject work_object; /*!< The base work object */
 	langType lang; /*!< Programming language used */
 	gboolean inactive; /*!< Whether this file should be scanned for tags */
+	GPtrArray *scope_tags; /*!< Function and scope tags sorted by line, built on demand */
 } TMSourceFile;
 
+/* Tag types which can be looked up with tm_source_file_get_tag_at_line() */
+#define TM_SOURCE_FILE_SCOPE_TYPES (tm_tag_function_t | tm_tag_method_t | tm_tag_class_t | \
+	tm_tag_struct_t | tm_tag_enum_t | tm_tag_union_t | tm_tag_namespace_t | tm_tag_interface_t)
+
+
 
 /* Initializes a TMSourceFile structure from a file name. */
 gboolean tm_source_file_init(TMSourceFile *source_file, const char *file_name,
@@ -150,6 +156,16 @@ const gchar *tm_source_file_get_lang_name(gint lang);
 */
 gint tm_source_file_get_named_lang(const gchar *name);
 
+/* Gets the function or scope tag of one of tag_types which starts nearest before or at
+ line. This is a binary search of an index built after each parse and doesn't allocate.
+ \param source_file The source file to search.
+ \param line The line number.
+ \param tag_types The tag types to accept, a subset of TM_SOURCE_FILE_SCOPE_TYPES.
+ \return The tag, or NULL.
+*/
+const struct _TMTag *tm_source_file_get_tag_at_line(TMWorkObject *source_file, gulong line,
+		guint tag_types);
+
 /* Set the argument list of tag identified by its name */
 void tm_source_file_set_tag_arglist(const char *tag_name, const char *arglist);
 
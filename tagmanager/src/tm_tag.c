@@ -378,7 +378,9 @@ TMTag *tm_tag_new_from_file(TMSourceFile *file, FILE *fp, gint mode, gboolean fo
 		TAG_FREE(tag);
 		return NULL;
 	}
-	tag->atts.file.lang = mode;
+	/* atts.file.lang overlaps atts.entry.line, only set it for tags without a source file */
+	if (NULL == file)
+		tag->atts.file.lang = mode;
 	return tag;
 }
 
@@ -32,6 +32,10 @@
 # include <glob.h>
 #endif
 #include <glib/gstdio.h>
+#ifndef G_OS_WIN32
+# include <sys/wait.h>
+# include <errno.h>
+#endif
 
 #include "tm_tag.h"
 #include "tm_workspace.h"
@@ -41,6 +45,201 @@
 static TMWorkspace *theWorkspace = NULL;
 guint workspace_class_id = 0;
 
+/* Tags which can be members of a scope, see tm_workspace_find_scope_members() */
+#define SCOPE_MEMBER_TYPES (tm_tag_function_t | tm_tag_prototype_t | tm_tag_member_t | \
+	tm_tag_field_t | tm_tag_method_t | tm_tag_enumerator_t | tm_tag_struct_t | \
+	tm_tag_typedef_t | tm_tag_union_t | tm_tag_enum_t)
+
+/* Members of each scope and classes by name, built on demand from a tags array
+ and dropped when the array changes so member completion doesn't scan all tags. */
+typedef struct
+{
+	const GPtrArray *tags_array; /* The array the index was built from */
+	GHashTable *members; /* Scope name -> GPtrArray of the tags in that scope */
+	GHashTable *classes; /* Name -> first class or struct tag of that name */
+} TMScopeIndex;
+
+static TMScopeIndex workspace_index = { NULL, NULL, NULL };
+static TMScopeIndex global_index = { NULL, NULL, NULL };
+
+/* A mask of the characters in each tag name of a tags array, built on demand and
+ dropped like TMScopeIndex, so fuzzy completion skips most tags without reading their names. */
+typedef struct
+{
+	const GPtrArray *tags_array; /* The array the masks were made for */
+	guint32 *masks; /* fuzzy_mask() of the name of each tag in the array */
+} TMFuzzyIndex;
+
+static TMFuzzyIndex workspace_fuzzy_index = { NULL, NULL };
+static TMFuzzyIndex global_fuzzy_index = { NULL, NULL };
+
+/* The global tags of one language. Lookups for a language only search its own tags
+ and loading a tags file only merges into the tags of its language, while
+ theWorkspace->global_tags has the tags of all languages in order. */
+typedef struct
+{
+	langType lang;
+	GPtrArray *tags; /* Sorted by global_tags_sort_attrs, owns the tag references */
+	TMFuzzyIndex fuzzy_index;
+} TMGlobalTags;
+
+static GPtrArray *global_tags_by_lang = NULL; /* TMGlobalTags of each loaded language */
+
+static void scope_index_clear(TMScopeIndex *index)
+{
+	if (NULL != index->members)
+	{
+		g_hash_table_destroy(index->members);
+		g_hash_table_destroy(index->classes);
+	}
+	index->tags_array = NULL;
+	index->members = NULL;
+	index->classes = NULL;
+}
+
+static void free_tags_array(gpointer tags_array)
+{
+	g_ptr_array_free((GPtrArray *) tags_array, TRUE);
+}
+
+static TMScopeIndex *scope_index_build(TMScopeIndex *index, const GPtrArray *tags_array)
+{
+	guint i;
+
+	scope_index_clear(index);
+	if (NULL == tags_array)
+		return NULL;
+
+	/* keys point into the tags, which live as long as the array */
+	index->members = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_tags_array);
+	index->classes = g_hash_table_new(g_str_hash, g_str_equal);
+	index->tags_array = tags_array;
+	for (i = 0; i < tags_array->len; ++i)
+	{
+		TMTag *tag = TM_TAG(tags_array->pdata[i]);
+
+		if ((tag->type & SCOPE_MEMBER_TYPES) && (NULL != tag->atts.entry.scope)
+			&& ('\0' != tag->atts.entry.scope[0]))
+		{
+			GPtrArray *members = g_hash_table_lookup(index->members, tag->atts.entry.scope);
+
+			if (NULL == members)
+			{
+				members = g_ptr_array_new();
+				g_hash_table_insert(index->members, tag->atts.entry.scope, members);
+			}
+			g_ptr_array_add(members, tag);
+		}
+		if ((tag->type & (tm_tag_class_t | tm_tag_struct_t))
+			&& (NULL == g_hash_table_lookup(index->classes, tag->name)))
+			g_hash_table_insert(index->classes, tag->name, tag);
+	}
+	return index;
+}
+
+static TMScopeIndex *scope_index_get(TMScopeIndex *index, const GPtrArray *tags_array)
+{
+	if ((NULL != index->members) && (tags_array == index->tags_array))
+		return index;
+	return scope_index_build(index, tags_array);
+}
+
+/* One bit for each letter regardless of case, digits share five bits and
+ everything else, including '_' and non-ASCII bytes, the last one. */
+static guint32 fuzzy_char_bit(gchar c)
+{
+	if (g_ascii_isalpha(c))
+		return 1u << (g_ascii_tolower(c) - 'a');
+	if (g_ascii_isdigit(c))
+		return 1u << (26 + (c - '0') % 5);
+	return 1u << 31;
+}
+
+static guint32 fuzzy_mask(const gchar *name)
+{
+	guint32 mask = 0;
+
+	for (; '\0' != *name; ++name)
+		mask |= fuzzy_char_bit(*name);
+	return mask;
+}
+
+static void fuzzy_index_clear(TMFuzzyIndex *index)
+{
+	g_free(index->masks);
+	index->tags_array = NULL;
+	index->masks = NULL;
+}
+
+static TMFuzzyIndex *fuzzy_index_get(TMFuzzyIndex *index, const GPtrArray *tags_array)
+{
+	guint i;
+
+	if ((NULL != index->masks) && (tags_array == index->tags_array))
+		return index;
+	fuzzy_index_clear(index);
+	if ((NULL == tags_array) || (0 == tags_array->len))
+		return NULL;
+
+	index->masks = g_new(guint32, tags_array->len);
+	index->tags_array = tags_array;
+	for (i = 0; i < tags_array->len; ++i)
+		index->masks[i] = fuzzy_mask(TM_TAG(tags_array->pdata[i])->name);
+	return index;
+}
+
+static void global_tags_free(gpointer data)
+{
+	TMGlobalTags *global = data;
+	guint i;
+
+	for (i = 0; i < global->tags->len; ++i)
+		tm_tag_unref(global->tags->pdata[i]);
+	g_ptr_array_free(global->tags, TRUE);
+	fuzzy_index_clear(&global->fuzzy_index);
+	g_free(global);
+}
+
+static TMGlobalTags *global_tags_get(langType lang, gboolean create)
+{
+	TMGlobalTags *global;
+	guint i;
+
+	if (NULL == global_tags_by_lang)
+	{
+		if (!create)
+			return NULL;
+		global_tags_by_lang = g_ptr_array_new();
+	}
+	for (i = 0; i < global_tags_by_lang->len; ++i)
+	{
+		global = global_tags_by_lang->pdata[i];
+		if (global->lang == lang)
+			return global;
+	}
+	if (!create)
+		return NULL;
+	global = g_new0(TMGlobalTags, 1);
+	global->lang = lang;
+	global->tags = g_ptr_array_new();
+	g_ptr_array_add(global_tags_by_lang, global);
+	return global;
+}
+
+/* Gets the global tags to search for lang, its own and for C++ also those of C,
+ which are loaded once for both. Returns the number of them in globals. */
+static guint global_tags_get_for_lang(langType lang, TMGlobalTags *globals[2])
+{
+	guint n = 0;
+
+	if (NULL != (globals[n] = global_tags_get(lang, FALSE)))
+		++n;
+	/* lang = 1 is C++, lang = 0 is C */
+	if (1 == lang && NULL != (globals[n] = global_tags_get(0, FALSE)))
+		++n;
+	return n;
+}
+
 static gboolean tm_create_workspace(void)
 {
 	workspace_class_id = tm_work_object_register(tm_workspace_free, tm_workspace_update
@@ -73,17 +272,25 @@ void tm_workspace_free(gpointer workspace)
 
 	if (theWorkspace)
 	{
+		scope_index_clear(&workspace_index);
+		scope_index_clear(&global_index);
+		fuzzy_index_clear(&workspace_fuzzy_index);
+		fuzzy_index_clear(&global_fuzzy_index);
 		if (theWorkspace->work_objects)
 		{
 			for (i=0; i < theWorkspace->work_objects->len; ++i)
 				tm_work_object_free(theWorkspace->work_objects->pdata[i]);
 			g_ptr_array_free(theWorkspace->work_objects, TRUE);
 		}
+		/* the tags are owned by the tags of each language */
 		if (theWorkspace->global_tags)
-		{
-			for (i=0; i < theWorkspace->global_tags->len; ++i)
-				tm_tag_unref(theWorkspace->global_tags->pdata[i]);
 			g_ptr_array_free(theWorkspace->global_tags, TRUE);
+		if (global_tags_by_lang)
+		{
+			for (i = 0; i < global_tags_by_lang->len; ++i)
+				global_tags_free(global_tags_by_lang->pdata[i]);
+			g_ptr_array_free(global_tags_by_lang, TRUE);
+			global_tags_by_lang = NULL;
 		}
 		tm_work_object_destroy(TM_WORK_OBJECT(theWorkspace));
 		g_free(theWorkspace);
@@ -134,6 +341,11 @@ gboolean tm_workspace_remove_object(TMWorkObject *w, gboolean do_free, gboolean
 	return FALSE;
 }
 
+static void unref_tag(gpointer key, gpointer value, gpointer user_data)
+{
+	tm_tag_unref(key);
+}
+
 static TMTagAttrType global_tags_sort_attrs[] =
 {
 	tm_tag_attr_name_t, tm_tag_attr_scope_t,
@@ -142,10 +354,13 @@ static TMTagAttrType global_tags_sort_attrs[] =
 
 gboolean tm_workspace_load_global_tags(const char *tags_file, gint mode)
 {
-	gsize orig_len;
+	gsize orig_len, global_len;
 	guchar buf[BUFSIZ];
 	FILE *fp;
 	TMTag *tag;
+	TMGlobalTags *global;
+	GHashTable *new_tags;
+	guint i;
 	gboolean format_pipe = FALSE;
 
 	if (NULL == theWorkspace)
@@ -154,7 +369,8 @@ gboolean tm_workspace_load_global_tags(const char *tags_file, gint mode)
 		return FALSE;
 	if (NULL == theWorkspace->global_tags)
 		theWorkspace->global_tags = g_ptr_array_new();
-	orig_len = theWorkspace->global_tags->len;
+	global = global_tags_get(mode, TRUE);
+	orig_len = global->tags->len;
 	if ((NULL == fgets((gchar*) buf, BUFSIZ, fp)) || ('\0' == *buf))
 	{
 		fclose(fp);
@@ -180,15 +396,41 @@ gboolean tm_workspace_load_global_tags(const char *tags_file, gint mode)
 		}
 		rewind(fp); /* reset the file pointer, to start reading again from the beginning */
 	}
+	new_tags = g_hash_table_new(g_direct_hash, g_direct_equal);
 	while (NULL != (tag = tm_tag_new_from_file(NULL, fp, mode, format_pipe)))
-		g_ptr_array_add(theWorkspace->global_tags, tag);
+	{
+		g_ptr_array_add(global->tags, tag);
+		g_hash_table_insert(new_tags, tag, tag);
+	}
 	fclose(fp);
 
-	/* reorder the whole array, because tm_tags_find expects a sorted array */
-	tm_tags_merge(theWorkspace->global_tags, orig_len, global_tags_sort_attrs, TRUE);
+	/* merge into the tags of the language only, because tm_tags_find expects a sorted array */
+	tm_tags_merge(global->tags, orig_len, global_tags_sort_attrs, TRUE);
+	fuzzy_index_clear(&global->fuzzy_index);
+
+	/* add the new tags which were not dropped as duplicates to the tags of all languages */
+	global_len = theWorkspace->global_tags->len;
+	for (i = 0; i < global->tags->len; ++i)
+	{
+		tag = global->tags->pdata[i];
+		if (g_hash_table_remove(new_tags, tag))
+			g_ptr_array_add(theWorkspace->global_tags, tag);
+	}
+	g_hash_table_foreach(new_tags, unref_tag, NULL);
+	g_hash_table_destroy(new_tags);
+	tm_tags_merge(theWorkspace->global_tags, global_len, global_tags_sort_attrs, FALSE);
+	scope_index_clear(&global_index);
+	fuzzy_index_clear(&global_fuzzy_index);
 	return TRUE;
 }
 
+const GPtrArray *tm_workspace_get_global_tags(langType lang)
+{
+	TMGlobalTags *global = global_tags_get(lang, FALSE);
+
+	return (NULL == global) ? NULL : global->tags;
+}
+
 static guint tm_file_inode_hash(gconstpointer key)
 {
 	struct stat file_stat;
@@ -272,31 +514,269 @@ static gchar *create_temp_file(const gchar *tpl)
 	return name;
 }
 
+/* Preprocesses files into a temporary file, or just concatenates them without
+ pre_process, and parses it */
+static TMWorkObject *parse_global_tags_files(const char *pre_process, GList *files, int lang)
+{
+	FILE *fp;
+	TMWorkObject *source_file;
+	GTimer *timer;
+	struct stat st;
+	gchar *temp_file = create_temp_file("tmp_XXXXXX.cpp");
+	gchar *temp_file2 = create_temp_file("tmp_XXXXXX.cpp");
+
+	if (NULL == temp_file || NULL == temp_file2 ||
+		NULL == (fp = g_fopen(temp_file, "w")))
+	{
+		g_free(temp_file);
+		g_free(temp_file2);
+		return NULL;
+	}
+
+#ifdef TM_DEBUG
+	g_message ("writing out files to %s\n", temp_file);
+#endif
+	if (pre_process != NULL)
+		write_includes_file(fp, files);
+	else
+		append_to_temp_file(fp, files);
+	fclose(fp);
+
+	if (pre_process != NULL)
+	{
+		gint ret;
+		gchar *tmp_errfile = create_temp_file("tmp_XXXXXX");
+		gchar *errors = NULL;
+		gchar *command = g_strdup_printf("%s %s >%s 2>%s",
+								pre_process, temp_file, temp_file2, tmp_errfile);
+#ifdef TM_DEBUG
+		g_message("Executing: %s", command);
+#endif
+		ret = system(command);
+		g_free(command);
+		g_unlink(temp_file);
+		g_free(temp_file);
+		g_file_get_contents(tmp_errfile, &errors, NULL, NULL);
+		if (errors && *errors)
+			g_printerr("%s", errors);
+		g_free(errors);
+		g_unlink(tmp_errfile);
+		g_free(tmp_errfile);
+		if (ret == -1)
+		{
+			g_unlink(temp_file2);
+			g_free(temp_file2);
+			return NULL;
+		}
+	}
+	else
+	{
+		/* no pre-processing needed, so temp_file2 = temp_file */
+		g_unlink(temp_file2);
+		g_free(temp_file2);
+		temp_file2 = temp_file;
+		temp_file = NULL;
+	}
+	/* report parser throughput, useful for comparing parsers by running -g per filetype */
+	timer = g_timer_new();
+	source_file = tm_source_file_new(temp_file2, TRUE, tm_source_file_get_lang_name(lang));
+	g_timer_stop(timer);
+	if (source_file != NULL && g_stat(temp_file2, &st) == 0)
+	{
+		gdouble elapsed = g_timer_elapsed(timer, NULL);
+
+		g_debug("Parsed %lu kB of %s in %.3f seconds (%.0f kB/s)",
+			(gulong) st.st_size / 1024, tm_source_file_get_lang_name(lang), elapsed,
+			elapsed > 0 ? st.st_size / 1024 / elapsed : 0);
+	}
+	g_timer_destroy(timer);
+	g_unlink(temp_file2);
+	g_free(temp_file2);
+	return source_file;
+}
+
+static void write_global_tags(FILE *fp, const GPtrArray *tags_array)
+{
+	guint i;
+
+	for (i = 0; i < tags_array->len; ++i)
+	{
+		tm_tag_write(TM_TAG(tags_array->pdata[i]), fp, tm_tag_attr_type_t
+		  | tm_tag_attr_scope_t | tm_tag_attr_arglist_t | tm_tag_attr_vartype_t
+		  | tm_tag_attr_pointer_t);
+	}
+}
+
+/* Sorts the tags, drops duplicates and writes them to tags_file */
+static gboolean write_global_tags_file(GPtrArray *tags_array, const char *tags_file)
+{
+	FILE *fp;
+
+	if (FALSE == tm_tags_sort(tags_array, global_tags_sort_attrs, TRUE))
+		return FALSE;
+	if (NULL == (fp = g_fopen(tags_file, "w")))
+		return FALSE;
+	fprintf(fp, "# format=tagmanager\n");
+	write_global_tags(fp, tags_array);
+	fclose(fp);
+	return TRUE;
+}
+
+#ifndef G_OS_WIN32
+/* Parses files and writes their tags to part_file, run by the child processes
+ of create_global_tags_parallel() */
+static gboolean write_global_tags_part(const char *pre_process, GList *files,
+	const char *part_file, int lang)
+{
+	TMWorkObject *source_file = parse_global_tags_files(pre_process, files, lang);
+	GPtrArray *tags_array;
+	FILE *fp;
+
+	if (NULL == source_file)
+		return FALSE;
+	if (NULL == (fp = g_fopen(part_file, "w")))
+	{
+		tm_source_file_free(source_file);
+		return FALSE;
+	}
+	tags_array = tm_tags_extract(source_file->tags_array, tm_tag_max_t);
+	if (NULL != tags_array)
+	{
+		write_global_tags(fp, tags_array);
+		g_ptr_array_free(tags_array, TRUE);
+	}
+	fclose(fp);
+	tm_source_file_free(source_file);
+	return TRUE;
+}
+
+static void read_global_tags_part(GPtrArray *tags_array, const char *part_file, int lang)
+{
+	TMTag *tag;
+	FILE *fp = g_fopen(part_file, "r");
+
+	if (NULL == fp)
+		return;
+	while (NULL != (tag = tm_tag_new_from_file(NULL, fp, lang, FALSE)))
+		g_ptr_array_add(tags_array, tag);
+	fclose(fp);
+}
+
+/* Splits files into one part for each of jobs child processes, which parse the parts
+ at the same time and write their tags to temporary files. These are merged into
+ tags_file, dropping the tags of headers included by several parts. */
+static gboolean create_global_tags_parallel(const char *pre_process, GList *files,
+	const char *tags_file, int lang, guint jobs)
+{
+	guint n_files = g_list_length(files);
+	guint n_parts = MIN(jobs, n_files);
+	guint i, started, finished = 0, n_tags;
+	gchar **part_files = g_new0(gchar *, n_parts);
+	pid_t *pids = g_new(pid_t, n_parts);
+	GPtrArray *all_tags = g_ptr_array_new();
+	GPtrArray *tags_array;
+	GList *node = files;
+	GTimer *timer = g_timer_new();
+	gboolean ret = TRUE;
+
+	/* don't let the children write out what is still buffered */
+	fflush(NULL);
+	for (started = 0; started < n_parts; ++started)
+	{
+		/* consecutive files go together, as they often include the same headers */
+		guint count = n_files / n_parts + ((started < n_files % n_parts) ? 1 : 0);
+		GList *part = NULL;
+
+		for (; count > 0; --count, node = g_list_next(node))
+			part = g_list_prepend(part, node->data);
+		part = g_list_reverse(part);
+
+		part_files[started] = create_temp_file("tmp_XXXXXX.tags");
+		pids[started] = (NULL != part_files[started]) ? fork() : -1;
+		if (0 == pids[started])
+			_exit(write_global_tags_part(pre_process, part, part_files[started], lang) ? 0 : 1);
+		g_list_free(part);
+		if (pids[started] < 0)
+		{
+			g_printerr("Unable to start parsing part %u of the files\n", started + 1);
+			ret = FALSE;
+			break;
+		}
+	}
+
+	while (finished < started)
+	{
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+
+		if (pid < 0)
+		{
+			if (EINTR == errno)
+				continue;
+			ret = FALSE;
+			break;
+		}
+		for (i = 0; i < started; ++i)
+		{
+			if (pids[i] == pid)
+				break;
+		}
+		if (i == started)
+			continue;
+		++finished;
+		if (WIFEXITED(status) && 0 == WEXITSTATUS(status))
+			read_global_tags_part(all_tags, part_files[i], lang);
+		else
+			ret = FALSE;
+		g_message("Parsed %u of %u parts of %u files (%.1f seconds)",
+			finished, n_parts, n_files, g_timer_elapsed(timer, NULL));
+	}
+
+	for (i = 0; i < n_parts; ++i)
+	{
+		if (NULL != part_files[i])
+			g_unlink(part_files[i]);
+		g_free(part_files[i]);
+	}
+	g_free(part_files);
+	g_free(pids);
+
+	/* all_tags holds the references, tags_array is deduplicated */
+	tags_array = g_ptr_array_sized_new(all_tags->len);
+	for (i = 0; i < all_tags->len; ++i)
+		g_ptr_array_add(tags_array, all_tags->pdata[i]);
+	if (ret && (0 == tags_array->len || !write_global_tags_file(tags_array, tags_file)))
+		ret = FALSE;
+	n_tags = tags_array->len;
+	g_ptr_array_free(tags_array, TRUE);
+	for (i = 0; i < all_tags->len; ++i)
+		tm_tag_unref(all_tags->pdata[i]);
+	g_ptr_array_free(all_tags, TRUE);
+
+	if (ret)
+		g_message("Wrote %u tags of %u files parsed by %u jobs in %.1f seconds",
+			n_tags, n_files, n_parts, g_timer_elapsed(timer, NULL));
+	g_timer_destroy(timer);
+	return ret;
+}
+#endif
+
 gboolean tm_workspace_create_global_tags(const char *pre_process, const char **includes,
-	int includes_count, const char *tags_file, int lang)
+	int includes_count, const char *tags_file, int lang, int jobs)
 {
 #ifdef HAVE_GLOB_H
 	glob_t globbuf;
 	size_t idx_glob;
 #endif
 	int idx_inc;
-	char *command;
-	guint i;
-	FILE *fp;
 	TMWorkObject *source_file;
 	GPtrArray *tags_array;
 	GHashTable *includes_files_hash;
 	GList *includes_files = NULL;
-	gchar *temp_file = create_temp_file("tmp_XXXXXX.cpp");
-	gchar *temp_file2 = create_temp_file("tmp_XXXXXX.cpp");
+	gboolean ret;
 
-	if (NULL == temp_file || NULL == temp_file2 ||
-		NULL == theWorkspace || NULL == (fp = g_fopen(temp_file, "w")))
-	{
-		g_free(temp_file);
-		g_free(temp_file2);
+	if (NULL == theWorkspace)
 		return FALSE;
-	}
 
 	includes_files_hash = g_hash_table_new_full (tm_file_inode_hash,
 												 g_direct_equal,
@@ -362,62 +842,24 @@ gboolean tm_workspace_create_global_tags(const char *pre_process, const char **i
 
 	includes_files = g_list_reverse (includes_files);
 
-#ifdef TM_DEBUG
-	g_message ("writing out files to %s\n", temp_file);
+#ifndef G_OS_WIN32
+	if (jobs > 1 && NULL != includes_files && NULL != includes_files->next)
+	{
+		ret = create_global_tags_parallel(pre_process, includes_files, tags_file, lang,
+			(guint) jobs);
+		g_list_free(includes_files);
+		g_hash_table_destroy(includes_files_hash);
+		return ret;
+	}
 #endif
-	if (pre_process != NULL)
-		write_includes_file(fp, includes_files);
-	else
-		append_to_temp_file(fp, includes_files);
-
+	source_file = parse_global_tags_files(pre_process, includes_files, lang);
 	g_list_free (includes_files);
 	g_hash_table_destroy(includes_files_hash);
 	includes_files_hash = NULL;
 	includes_files = NULL;
-	fclose(fp);
 
-	if (pre_process != NULL)
-	{
-		gint ret;
-		gchar *tmp_errfile = create_temp_file("tmp_XXXXXX");
-		gchar *errors = NULL;
-		command = g_strdup_printf("%s %s >%s 2>%s",
-								pre_process, temp_file, temp_file2, tmp_errfile);
-#ifdef TM_DEBUG
-		g_message("Executing: %s", command);
-#endif
-		ret = system(command);
-		g_free(command);
-		g_unlink(temp_file);
-		g_free(temp_file);
-		g_file_get_contents(tmp_errfile, &errors, NULL, NULL);
-		if (errors && *errors)
-			g_printerr("%s", errors);
-		g_free(errors);
-		g_unlink(tmp_errfile);
-		g_free(tmp_errfile);
-		if (ret == -1)
-		{
-			g_unlink(temp_file2);
-			return FALSE;
-		}
-	}
-	else
-	{
-		/* no pre-processing needed, so temp_file2 = temp_file */
-		g_unlink(temp_file2);
-		g_free(temp_file2);
-		temp_file2 = temp_file;
-		temp_file = NULL;
-	}
-	source_file = tm_source_file_new(temp_file2, TRUE, tm_source_file_get_lang_name(lang));
 	if (NULL == source_file)
-	{
-		g_unlink(temp_file2);
 		return FALSE;
-	}
-	g_unlink(temp_file2);
-	g_free(temp_file2);
 	if ((NULL == source_file->tags_array) || (0 == source_file->tags_array->len))
 	{
 		tm_source_file_free(source_file);
@@ -431,27 +873,10 @@ gboolean tm_workspace_create_global_tags(const char *pre_process, const char **i
 		tm_source_file_free(source_file);
 		return FALSE;
 	}
-	if (FALSE == tm_tags_sort(tags_array, global_tags_sort_attrs, TRUE))
-	{
-		tm_source_file_free(source_file);
-		return FALSE;
-	}
-	if (NULL == (fp = g_fopen(tags_file, "w")))
-	{
-		tm_source_file_free(source_file);
-		return FALSE;
-	}
-	fprintf(fp, "# format=tagmanager\n");
-	for (i = 0; i < tags_array->len; ++i)
-	{
-		tm_tag_write(TM_TAG(tags_array->pdata[i]), fp, tm_tag_attr_type_t
-		  | tm_tag_attr_scope_t | tm_tag_attr_arglist_t | tm_tag_attr_vartype_t
-		  | tm_tag_attr_pointer_t);
-	}
-	fclose(fp);
+	ret = write_global_tags_file(tags_array, tags_file);
 	tm_source_file_free(source_file);
 	g_ptr_array_free(tags_array, TRUE);
-	return TRUE;
+	return ret;
 }
 
 TMWorkObject *tm_workspace_find_object(TMWorkObject *work_object, const char *file_name
@@ -480,6 +905,7 @@ void tm_workspace_recreate_tags_array(void)
 	TMWorkObject *w;
 	TMTagAttrType sort_attrs[] = { tm_tag_attr_name_t, tm_tag_attr_file_t
 		, tm_tag_attr_scope_t, tm_tag_attr_type_t, tm_tag_attr_arglist_t, 0};
+	gboolean scope_index_used = (NULL != workspace_index.members);
 
 #ifdef TM_DEBUG
 	g_message("Recreating workspace tags array");
@@ -487,6 +913,8 @@ void tm_workspace_recreate_tags_array(void)
 
 	if ((NULL == theWorkspace) || (NULL == theWorkspace->work_objects))
 		return;
+	scope_index_clear(&workspace_index);
+	fuzzy_index_clear(&workspace_fuzzy_index);
 	if (NULL != theWorkspace->work_object.tags_array)
 		g_ptr_array_set_size(theWorkspace->work_object.tags_array, 0);
 	else
@@ -514,6 +942,10 @@ void tm_workspace_recreate_tags_array(void)
 	g_message("Total: %d tags", theWorkspace->work_object.tags_array->len);
 #endif
 	tm_tags_sort(theWorkspace->work_object.tags_array, sort_attrs, TRUE);
+	/* once member lookups have used the index, keep it up to date here rather than
+	 rebuilding it on the next lookup */
+	if (scope_index_used)
+		scope_index_build(&workspace_index, theWorkspace->work_object.tags_array);
 }
 
 gboolean tm_workspace_update(TMWorkObject *workspace, gboolean force
@@ -574,6 +1006,8 @@ const GPtrArray *tm_workspace_find(const char *name, int type, TMTagAttrType *at
 	TMTag **matches[2];
 	int len, tagCount[2]={0,0}, tagIter;
 	gint tags_lang;
+	TMGlobalTags *globals[2];
+	guint n_globals, i;
 
 	if ((!theWorkspace) || (!name))
 		return NULL;
@@ -586,7 +1020,6 @@ const GPtrArray *tm_workspace_find(const char *name, int type, TMTagAttrType *at
 		tags = g_ptr_array_new();
 
 	matches[0] = tm_tags_find(theWorkspace->work_object.tags_array, name, partial, &tagCount[0]);
-	matches[1] = tm_tags_find(theWorkspace->global_tags, name, partial, &tagCount[1]);
 
 	/* file tags */
 	if (matches[0] && *matches[0])
@@ -613,25 +1046,25 @@ const GPtrArray *tm_workspace_find(const char *name, int type, TMTagAttrType *at
 		}
 	}
 
-	/* global tags */
-	if (matches[1] && *matches[1])
+	/* global tags, only of the language unless all languages are wanted */
+	if (lang == -1)
 	{
-		int tags_lang_alt = 0;
-		/* tag->atts.file.lang contains the language and
-		 * tags->atts.entry.file is NULL */
-		tags_lang = (*matches[1])->atts.file.lang;
-		/* tags_lang_alt is used to load C global tags only once for C and C++
-		 * lang = 1 is C++, lang = 0 is C
-		 * if we have lang 0, than accept also lang 1 for C++ */
-		if (tags_lang == 0)	/* C or C++ */
-			tags_lang_alt = 1;
-		else
-			tags_lang_alt = tags_lang; /* otherwise just ignore it */
+		globals[0] = NULL;
+		n_globals = 1;
+	}
+	else
+		n_globals = global_tags_get_for_lang(lang, globals);
+	for (i = 0; i < n_globals; ++i)
+	{
+		const GPtrArray *global_tags = globals[i] ? globals[i]->tags : theWorkspace->global_tags;
+
+		matches[1] = tm_tags_find(global_tags, name, partial, &tagCount[1]);
+		if (!matches[1] || !*matches[1])
+			continue;
 
 		for (tagIter=0;tagIter<tagCount[1];++tagIter)
 		{
-			if ((type & (*matches[1])->type) && (lang == -1 ||
-				tags_lang == lang || tags_lang_alt == lang))
+			if (type & (*matches[1])->type)
 				g_ptr_array_add(tags, *matches[1]);
 
 			if (partial)
@@ -709,6 +1142,7 @@ tm_workspace_find_scoped (const char *name, const char *scope, gint type,
 		TMTagAttrType *attrs, gboolean partial, langType lang, gboolean global_search)
 {
 	static GPtrArray *tags = NULL;
+	TMGlobalTags *global;
 
 	if ((!theWorkspace))
 		return NULL;
@@ -723,8 +1157,12 @@ tm_workspace_find_scoped (const char *name, const char *scope, gint type,
 	if (global_search)
 	{
 		/* for a scoped tag, I think we always want the same language */
-		fill_find_tags_array (tags, theWorkspace->global_tags,
-							  name, scope, type, partial, lang, FALSE);
+		if (lang == -1)
+			fill_find_tags_array (tags, theWorkspace->global_tags,
+								  name, scope, type, partial, lang, FALSE);
+		else if (NULL != (global = global_tags_get(lang, FALSE)))
+			fill_find_tags_array (tags, global->tags,
+								  name, scope, type, partial, -1, FALSE);
 	}
 	if (attrs)
 		tm_tags_sort (tags, attrs, TRUE);
@@ -732,6 +1170,276 @@ tm_workspace_find_scoped (const char *name, const char *scope, gint type,
 }
 
 
+/* Scores of fuzzy matches, see fuzzy_score() */
+#define FUZZY_NO_MATCH (G_MININT / 2)
+#define FUZZY_MAX_NAME 256
+#define FUZZY_CONSECUTIVE 200
+#define FUZZY_START 190
+#define FUZZY_WORD_START 180
+#define FUZZY_CAMEL_HUMP 140
+#define FUZZY_DIGIT 80
+#define FUZZY_EXACT_CASE 2
+#define FUZZY_GAP_LEADING (-1)
+#define FUZZY_GAP_INNER (-2)
+#define FUZZY_GAP_TRAILING (-1)
+/* Boosts for tags of open files, of the current file and of the scope being edited */
+#define FUZZY_WORKSPACE 100
+#define FUZZY_SOURCE_FILE 300
+#define FUZZY_SCOPE 200
+/* Number of tags looked at between checks of the time budget */
+#define FUZZY_CHECK_INTERVAL 1024
+
+typedef struct
+{
+	TMTag *tag;
+	gint score;
+} TMFuzzyMatch;
+
+/* Bonus for matching name[i], highest at the start of the name or of one
+ of the words of underscore_names and camelCaseNames */
+static gint fuzzy_bonus(const gchar *name, gsize i)
+{
+	gchar prev;
+
+	if (0 == i)
+		return FUZZY_START;
+	prev = name[i - 1];
+	if (!g_ascii_isalnum(prev))
+		return FUZZY_WORD_START;
+	if (g_ascii_isupper(name[i]) && g_ascii_islower(prev))
+		return FUZZY_CAMEL_HUMP;
+	if (g_ascii_isdigit(name[i]) && !g_ascii_isdigit(prev))
+		return FUZZY_DIGIT;
+	return 0;
+}
+
+static gboolean fuzzy_is_subsequence(const gchar *pattern, const gchar *name)
+{
+	for (; ('\0' != *name) && ('\0' != *pattern); ++name)
+	{
+		if (g_ascii_tolower(*name) == g_ascii_tolower(*pattern))
+			++pattern;
+	}
+	return '\0' == *pattern;
+}
+
+/* Scores the best way to find the characters of pattern in order in name, ignoring case.
+ Each match is worth its fuzzy_bonus() or more if it follows the previous match, and each
+ skipped character costs a little, so "gtkwss" ranks gtk_widget_set_sensitive high.
+ Returns FUZZY_NO_MATCH if name doesn't contain pattern that way. */
+static gint fuzzy_score(const gchar *pattern, gsize pattern_len, const gchar *name)
+{
+	gint best[2][FUZZY_MAX_NAME]; /* Best score of pattern[0..i] in name[0..j] */
+	gint ending[2][FUZZY_MAX_NAME]; /* Same with pattern[i] matched at name[j] */
+	gsize name_len = strlen(name);
+	gsize i, j;
+	gint score;
+
+	if (name_len > FUZZY_MAX_NAME)
+		name_len = FUZZY_MAX_NAME;
+	if ((pattern_len > name_len) || !fuzzy_is_subsequence(pattern, name))
+		return FUZZY_NO_MATCH;
+
+	for (i = 0; i < pattern_len; ++i)
+	{
+		gint *row = best[i % 2], *prev_row = best[(i + 1) % 2];
+		gint *end_row = ending[i % 2], *prev_end_row = ending[(i + 1) % 2];
+		gint gap = (i + 1 == pattern_len) ? FUZZY_GAP_TRAILING : FUZZY_GAP_INNER;
+		gint prev_score = FUZZY_NO_MATCH;
+		gchar c = g_ascii_tolower(pattern[i]);
+
+		for (j = 0; j < name_len; ++j)
+		{
+			score = FUZZY_NO_MATCH;
+			if ((j >= i) && (g_ascii_tolower(name[j]) == c))
+			{
+				if (0 == i)
+					score = (gint) j * FUZZY_GAP_LEADING + fuzzy_bonus(name, j);
+				else
+					score = MAX(prev_row[j - 1] + fuzzy_bonus(name, j),
+						prev_end_row[j - 1] + FUZZY_CONSECUTIVE);
+				if (name[j] == pattern[i])
+					score += FUZZY_EXACT_CASE;
+			}
+			end_row[j] = score;
+			row[j] = prev_score = MAX(score, prev_score + gap);
+		}
+	}
+	score = best[(pattern_len - 1) % 2][name_len - 1];
+	/* the pattern may only be found after FUZZY_MAX_NAME characters */
+	return (score > FUZZY_NO_MATCH / 2) ? score : FUZZY_NO_MATCH;
+}
+
+/* Whether a is a better match than b: a higher score, then a shorter name and
+ then the name sorting first */
+static gboolean fuzzy_match_better(const TMFuzzyMatch *a, const TMFuzzyMatch *b)
+{
+	gsize len_a, len_b;
+
+	if (a->score != b->score)
+		return a->score > b->score;
+	len_a = strlen(a->tag->name);
+	len_b = strlen(b->tag->name);
+	if (len_a != len_b)
+		return len_a < len_b;
+	return strcmp(a->tag->name, b->tag->name) < 0;
+}
+
+/* Adds match to the max_count best matches, which are kept best first and
+ with only the best match of each name */
+static void fuzzy_matches_add(GArray *matches, TMFuzzyMatch *match, guint max_count)
+{
+	guint i;
+
+	if ((matches->len == max_count) &&
+		!fuzzy_match_better(match, &g_array_index(matches, TMFuzzyMatch, max_count - 1)))
+		return;
+	for (i = 0; i < matches->len; ++i)
+	{
+		TMFuzzyMatch *other = &g_array_index(matches, TMFuzzyMatch, i);
+
+		if (0 == strcmp(other->tag->name, match->tag->name))
+		{
+			if (!fuzzy_match_better(match, other))
+				return;
+			g_array_remove_index(matches, i);
+			break;
+		}
+	}
+	for (i = 0; i < matches->len; ++i)
+	{
+		if (fuzzy_match_better(match, &g_array_index(matches, TMFuzzyMatch, i)))
+			break;
+	}
+	g_array_insert_val(matches, i, *match);
+	if (matches->len > max_count)
+		g_array_set_size(matches, max_count);
+}
+
+static gboolean fuzzy_match_lang(const TMTag *tag, gboolean global, langType lang)
+{
+	if (lang == -1)
+		return TRUE;
+	if (!global)
+		return tag->atts.entry.file->lang == lang;
+	/* C global tags are used for C++ too, see tm_workspace_find() */
+	return (tag->atts.file.lang == lang) || (tag->atts.file.lang == 0 && lang == 1);
+}
+
+/* Whether tag is a member of scope or of one of the scopes around it */
+static gboolean fuzzy_match_scope(const TMTag *tag, const char *scope)
+{
+	const char *tag_scope = tag->atts.entry.scope;
+	gsize len;
+
+	if ((NULL == scope) || (NULL == tag_scope) || ('\0' == tag_scope[0]))
+		return FALSE;
+	len = strlen(tag_scope);
+	return (0 == strncmp(scope, tag_scope, len)) &&
+		!g_ascii_isalnum(scope[len]) && ('_' != scope[len]);
+}
+
+const GPtrArray *tm_workspace_find_fuzzy(const char *pattern, int type, langType lang,
+	const TMSourceFile *source_file, const char *scope, guint max_count, gdouble max_seconds)
+{
+	static GPtrArray *tags = NULL;
+	const GPtrArray *arrays[3];
+	TMFuzzyIndex *indexes[3];
+	TMGlobalTags *globals[2];
+	GArray *matches;
+	GTimer *timer;
+	gsize pattern_len;
+	guint32 pattern_mask;
+	guint i, j, n_arrays = 1, scanned = 0;
+	gboolean timed_out = FALSE;
+
+	if ((!theWorkspace) || (!pattern) || (0 == max_count))
+		return NULL;
+	pattern_len = strlen(pattern);
+	if ((0 == pattern_len) || (pattern_len > FUZZY_MAX_NAME))
+		return NULL;
+	if (tags)
+		g_ptr_array_set_size(tags, 0);
+	else
+		tags = g_ptr_array_new();
+
+	arrays[0] = theWorkspace->work_object.tags_array;
+	indexes[0] = fuzzy_index_get(&workspace_fuzzy_index, arrays[0]);
+	if (lang == -1)
+	{
+		arrays[n_arrays] = theWorkspace->global_tags;
+		indexes[n_arrays] = fuzzy_index_get(&global_fuzzy_index, arrays[n_arrays]);
+		++n_arrays;
+	}
+	else
+	{
+		guint n_globals = global_tags_get_for_lang(lang, globals);
+
+		for (i = 0; i < n_globals; ++i, ++n_arrays)
+		{
+			arrays[n_arrays] = globals[i]->tags;
+			indexes[n_arrays] = fuzzy_index_get(&globals[i]->fuzzy_index, arrays[n_arrays]);
+		}
+	}
+	pattern_mask = fuzzy_mask(pattern);
+	matches = g_array_sized_new(FALSE, FALSE, sizeof(TMFuzzyMatch), max_count + 1);
+	timer = g_timer_new();
+
+	/* open files first, so their tags are ranked even when the time runs out */
+	for (i = 0; (i < n_arrays) && !timed_out; ++i)
+	{
+		const char *last_name = NULL;
+		gint last_score = FUZZY_NO_MATCH;
+
+		if (NULL == indexes[i])
+			continue;
+		for (j = 0; j < arrays[i]->len; ++j)
+		{
+			TMFuzzyMatch match;
+
+			if ((0 == ++scanned % FUZZY_CHECK_INTERVAL) &&
+				(g_timer_elapsed(timer, NULL) > max_seconds))
+			{
+				timed_out = TRUE;
+				break;
+			}
+			if ((indexes[i]->masks[j] & pattern_mask) != pattern_mask)
+				continue;
+			match.tag = TM_TAG(arrays[i]->pdata[j]);
+			if (!(type & match.tag->type) || !fuzzy_match_lang(match.tag, (0 != i), lang))
+				continue;
+			/* the arrays are sorted by name, so tags of the same name follow each other */
+			if ((NULL == last_name) || (0 != strcmp(last_name, match.tag->name)))
+			{
+				last_name = match.tag->name;
+				last_score = fuzzy_score(pattern, pattern_len, last_name);
+			}
+			if (FUZZY_NO_MATCH == last_score)
+				continue;
+			match.score = last_score;
+			if (0 == i)
+			{
+				match.score += FUZZY_WORKSPACE;
+				if ((NULL != source_file) && (match.tag->atts.entry.file == source_file))
+					match.score += FUZZY_SOURCE_FILE;
+			}
+			if (fuzzy_match_scope(match.tag, scope))
+				match.score += FUZZY_SCOPE;
+			fuzzy_matches_add(matches, &match, max_count);
+		}
+	}
+#ifdef TM_DEBUG
+	if (timed_out)
+		g_message("Fuzzy search for %s stopped after %u tags", pattern, scanned);
+#endif
+
+	for (i = 0; i < matches->len; ++i)
+		g_ptr_array_add(tags, g_array_index(matches, TMFuzzyMatch, i).tag);
+	g_array_free(matches, TRUE);
+	g_timer_destroy(timer);
+	return tags;
+}
+
 const TMTag *
 tm_get_current_tag (GPtrArray * file_tags, const gulong line, const guint tag_types)
 {
@@ -767,118 +1475,105 @@ tm_get_current_function (GPtrArray * file_tags, const gulong line)
 }
 
 
-static int
-find_scope_members_tags (const GPtrArray * all, GPtrArray * tags,
-						 const langType langJava, const char *name,
-						 const char *filename, gboolean no_definitions)
+/* Finds the class or struct tag named name, in the workspace first. */
+static TMTag *find_class(const char *name)
 {
-	GPtrArray *local = g_ptr_array_new ();
-	unsigned int i;
+	TMScopeIndex *index;
+	TMTag *tag = NULL;
+
+	if (NULL != (index = scope_index_get(&workspace_index, theWorkspace->work_object.tags_array)))
+		tag = g_hash_table_lookup(index->classes, name);
+	if ((NULL == tag) &&
+		(NULL != (index = scope_index_get(&global_index, theWorkspace->global_tags))))
+		tag = g_hash_table_lookup(index->classes, name);
+	return tag;
+}
+
+/* Returns the last component of a qualified name like ns::klass or package.klass. */
+static const char *get_unqualified_name(const char *name)
+{
+	const char *sep;
+
+	if (NULL != (sep = strrchr(name, ':')))
+		return sep + 1;
+	if (NULL != (sep = strrchr(name, '.')))
+		return sep + 1;
+	return name;
+}
+
+/* Returns the scope name of the members of the class base, as written in the
+ inheritance list of a class tag. */
+static char *get_base_scope(const char *base)
+{
+	const char *name = get_unqualified_name(base);
 	TMTag *tag;
-	size_t len = strlen (name);
-	for (i = 0; (i < all->len); ++i)
+
+	if (NULL == (tag = find_class(name)))
+		return NULL;
+	if (name != base || (NULL == tag->atts.entry.scope) || ('\0' == tag->atts.entry.scope[0]))
+		return g_strdup(base);
+	/* scopes of languages like Java and Python are separated with dots */
+	if ((NULL != strchr(tag->atts.entry.scope, '.')) && (NULL == strstr(tag->atts.entry.scope, "::")))
+		return g_strconcat(tag->atts.entry.scope, ".", name, NULL);
+	return g_strconcat(tag->atts.entry.scope, "::", name, NULL);
+}
+
+/* Adds the tags of the given types in scope name and in the scopes of its base classes.
+ If filename is set, only tags from that file are added. */
+static int
+find_scope_members_tags (TMScopeIndex *index, GPtrArray *tags, const char *name,
+						 const char *filename, int types)
+{
+	GPtrArray *scopes = g_ptr_array_new();
+	guint i, j;
+
+	g_ptr_array_add(scopes, g_strdup(name));
+	for (i = 0; i < scopes->len; ++i)
 	{
-		tag = TM_TAG (all->pdata[i]);
-		if (no_definitions && filename && tag->atts.entry.file &&
-			0 != strcmp (filename,
-						 tag->atts.entry.file->work_object.short_name))
-		{
-			continue;
-		}
-		if (tag && tag->atts.entry.scope && tag->atts.entry.scope[0] != '\0')
+		const char *scope = scopes->pdata[i];
+		GPtrArray *members = g_hash_table_lookup(index->members, scope);
+		TMTag *klass;
+
+		for (j = 0; (NULL != members) && (j < members->len); ++j)
 		{
-			if (0 == strncmp (name, tag->atts.entry.scope, len))
-			{
-				g_ptr_array_add (local, tag);
-			}
+			TMTag *tag = TM_TAG(members->pdata[j]);
+
+			if (!(tag->type & types))
+				continue;
+			if (filename && tag->atts.entry.file &&
+				0 != strcmp(filename, tag->atts.entry.file->work_object.short_name))
+				continue;
+			g_ptr_array_add(tags, tag);
 		}
-	}
-	if (local->len > 0)
-	{
-		unsigned int j;
-		TMTag *tag2;
-		char backup = 0;
-		char *s_backup = NULL;
-		char *var_type = NULL;
-		char *scope;
-		for (i = 0; (i < local->len); ++i)
+
+		/* queue the scopes of the base classes, each only once */
+		klass = find_class(get_unqualified_name(scope));
+		if ((NULL != klass) && (NULL != klass->atts.entry.inheritance) &&
+			isalpha((unsigned char) klass->atts.entry.inheritance[0]))
 		{
-			tag = TM_TAG (local->pdata[i]);
-			scope = tag->atts.entry.scope;
-			if (scope && 0 == strcmp (name, scope))
-			{
-				g_ptr_array_add (tags, tag);
-				continue;
-			}
-			s_backup = NULL;
-			j = 0;				/* someone could write better code :P */
-			while (scope)
+			gchar **bases = g_strsplit(klass->atts.entry.inheritance, ",", 0);
+			gchar **base;
+
+			for (base = bases; NULL != *base; ++base)
 			{
-				if (s_backup)
+				char *base_scope = get_base_scope(*base);
+
+				for (j = 0; (NULL != base_scope) && (j < scopes->len); ++j)
 				{
-					backup = s_backup[0];
-					s_backup[0] = '\0';
-					if (0 == strcmp (name, tag->atts.entry.scope))
-					{
-						j = local->len;
-						s_backup[0] = backup;
+					if (0 == strcmp(base_scope, scopes->pdata[j]))
 						break;
-					}
-				}
-				if (tag->atts.entry.file
-					&& tag->atts.entry.file->lang == langJava)
-				{
-					scope = strrchr (tag->atts.entry.scope, '.');
-					if (scope)
-						var_type = scope + 1;
 				}
+				if ((NULL != base_scope) && (j == scopes->len))
+					g_ptr_array_add(scopes, base_scope);
 				else
-				{
-					scope = strrchr (tag->atts.entry.scope, ':');
-					if (scope)
-					{
-						var_type = scope + 1;
-						scope--;
-					}
-				}
-				if (s_backup)
-				{
-					s_backup[0] = backup;
-				}
-				if (scope)
-				{
-					if (s_backup)
-					{
-						backup = s_backup[0];
-						s_backup[0] = '\0';
-					}
-					for (j = 0; (j < local->len); ++j)
-					{
-						if (i == j)
-							continue;
-						tag2 = TM_TAG (local->pdata[j]);
-						if (tag2->atts.entry.var_type &&
-							0 == strcmp (var_type, tag2->atts.entry.var_type))
-						{
-							break;
-						}
-					}
-					if (s_backup)
-						s_backup[0] = backup;
-				}
-				if (j < local->len)
-				{
-					break;
-				}
-				s_backup = scope;
-			}
-			if (j == local->len)
-			{
-				g_ptr_array_add (tags, tag);
+					g_free(base_scope);
 			}
+			g_strfreev(bases);
 		}
 	}
-	g_ptr_array_free (local, TRUE);
+	for (i = 0; i < scopes->len; ++i)
+		g_free(scopes->pdata[i]);
+	g_ptr_array_free(scopes, TRUE);
 	return (int) tags->len;
 }
 
@@ -1091,7 +1786,8 @@ tm_workspace_find_scope_members (const GPtrArray * file_tags, const char *name,
 								 gboolean search_global, gboolean no_definitions)
 {
 	static GPtrArray *tags = NULL;
-	GPtrArray *local = NULL;
+	static TMTagAttrType sort_attrs[] = { tm_tag_attr_name_t, tm_tag_attr_type_t, tm_tag_attr_none_t };
+	TMScopeIndex *index;
 	char *new_name = (char *) name;
 	char *filename = NULL;
 	int found = 0, del = 0;
@@ -1176,44 +1872,31 @@ tm_workspace_find_scope_members (const GPtrArray * file_tags, const char *name,
 
 	g_ptr_array_set_size (tags, 0);
 
-	if (no_definitions && tag && tag->atts.entry.file)
-	{
-		local = tm_tags_extract (tag->atts.entry.file->work_object.tags_array,
-								 (tm_tag_function_t | tm_tag_prototype_t |
-								  tm_tag_member_t | tm_tag_field_t |
-								  tm_tag_method_t | tm_tag_enumerator_t));
-	}
-	else
-	{
-		local = tm_tags_extract (theWorkspace->work_object.tags_array,
-								 (tm_tag_function_t | tm_tag_prototype_t |
-								  tm_tag_member_t | tm_tag_field_t |
-								  tm_tag_method_t | tm_tag_enumerator_t));
-	}
-	if (local)
+	/* tags from the same file only, as in the file of the tag that named the scope */
+	if (!(no_definitions && tag && tag->atts.entry.file))
+		filename = NULL;
+	if (NULL != (index = scope_index_get(&workspace_index, theWorkspace->work_object.tags_array)))
 	{
-		found = find_scope_members_tags (local, tags, langJava, new_name,
-										 filename, no_definitions);
-		g_ptr_array_free (local, TRUE);
+		found = find_scope_members_tags (index, tags, new_name, filename,
+										 (tm_tag_function_t | tm_tag_prototype_t |
+										  tm_tag_member_t | tm_tag_field_t |
+										  tm_tag_method_t | tm_tag_enumerator_t));
 	}
-	if (!found && search_global)
+	if (!found && search_global &&
+		NULL != (index = scope_index_get(&global_index, theWorkspace->global_tags)))
 	{
-		GPtrArray *global = tm_tags_extract (theWorkspace->global_tags,
-											 (tm_tag_member_t |
-											  tm_tag_prototype_t |
-											  tm_tag_field_t |
-											  tm_tag_method_t |
-											  tm_tag_function_t |
-											  tm_tag_enumerator_t
-											  |tm_tag_struct_t | tm_tag_typedef_t |
-											  tm_tag_union_t | tm_tag_enum_t));
-		if (global)
-		{
-			find_scope_members_tags (global, tags, langJava, new_name,
-									 filename, no_definitions);
-			g_ptr_array_free (global, TRUE);
-		}
+		find_scope_members_tags (index, tags, new_name, filename,
+								 (tm_tag_member_t |
+								  tm_tag_prototype_t |
+								  tm_tag_field_t |
+								  tm_tag_method_t |
+								  tm_tag_function_t |
+								  tm_tag_enumerator_t
+								  |tm_tag_struct_t | tm_tag_typedef_t |
+								  tm_tag_union_t | tm_tag_enum_t));
 	}
+	/* merge the inherited members into the list of members, sorted by name */
+	tm_tags_sort (tags, sort_attrs, TRUE);
 	if (del)
 	{
 		g_free (new_name);
@@ -1224,29 +1907,26 @@ tm_workspace_find_scope_members (const GPtrArray * file_tags, const char *name,
 
 const GPtrArray *tm_workspace_get_parents(const gchar *name)
 {
-	static TMTagAttrType type[] = { tm_tag_attr_name_t, tm_tag_attr_none_t };
 	static GPtrArray *parents = NULL;
-	const GPtrArray *matches;
 	guint i = 0;
 	guint j;
 	gchar **klasses;
 	gchar **klass;
 	TMTag *tag;
 
-	g_return_val_if_fail(name && isalpha(*name),NULL);
+	g_return_val_if_fail(name && isalpha((unsigned char) *name),NULL);
 
 	if (NULL == parents)
 		parents = g_ptr_array_new();
 	else
 		g_ptr_array_set_size(parents, 0);
-	matches = tm_workspace_find(name, tm_tag_class_t, type, FALSE, -1);
-	if ((NULL == matches) || (0 == matches->len))
+	if ((NULL == theWorkspace) || (NULL == (tag = find_class(name))))
 		return NULL;
-	g_ptr_array_add(parents, matches->pdata[0]);
+	g_ptr_array_add(parents, tag);
 	while (i < parents->len)
 	{
 		tag = TM_TAG(parents->pdata[i]);
-		if ((NULL != tag->atts.entry.inheritance) && (isalpha(tag->atts.entry.inheritance[0])))
+		if ((NULL != tag->atts.entry.inheritance) && (isalpha((unsigned char) tag->atts.entry.inheritance[0])))
 		{
 			klasses = g_strsplit(tag->atts.entry.inheritance, ",", 10);
 			for (klass = klasses; (NULL != *klass); ++ klass)
@@ -1256,12 +1936,8 @@ const GPtrArray *tm_workspace_get_parents(const gchar *name)
 					if (0 == strcmp(*klass, TM_TAG(parents->pdata[j])->name))
 						break;
 				}
-				if (parents->len == j)
-				{
-					matches = tm_workspace_find(*klass, tm_tag_class_t, type, FALSE, -1);
-					if ((NULL != matches) && (0 < matches->len))
-						g_ptr_array_add(parents, matches->pdata[0]);
-				}
+				if ((parents->len == j) && (NULL != (tag = find_class(*klass))))
+					g_ptr_array_add(parents, tag);
 			}
 			g_strfreev(klasses);
 		}
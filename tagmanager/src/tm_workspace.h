@@ -31,7 +31,7 @@ extern "C"
 typedef struct
 {
     TMWorkObject work_object; /*!< The parent work object */
-    GPtrArray *global_tags; /*!< Global tags loaded at startup */
+    GPtrArray *global_tags; /*!< Global tags of all languages loaded at startup */
     GPtrArray *work_objects; /*!< An array of TMWorkObject pointers */
 } TMWorkspace;
 
@@ -78,6 +78,13 @@ gboolean tm_workspace_remove_object(TMWorkObject *work_object, gboolean do_free,
 gboolean tm_workspace_load_global_tags(const char *tags_file, gint mode);
 /*gboolean tm_workspace_load_global_tags(const char *tags_file);*/
 
+/* Gets the global tags loaded for a language. C tags are not included for C++,
+ unlike in tm_workspace_find().
+ \param lang The language of the tags.
+ \return The tags sorted by name, or NULL if none of the language were loaded.
+*/
+const GPtrArray *tm_workspace_get_global_tags(langType lang);
+
 /* Creates a list of global tags. Ideally, this should be created once during
  installations so that all users can use the same file. Thsi is because a full
  scale global tag list can occupy several megabytes of disk space.
@@ -87,10 +94,12 @@ gboolean tm_workspace_load_global_tags(const char *tags_file, gint mode);
  are allowed.
  \param tags_file The file where the tags will be stored.
  \param lang The language to use for the tags file.
+ \param jobs The number of processes parsing the include files at the same time,
+ each one a share of them. Not used on Windows.
  \return TRUE on success, FALSE on failure.
 */
 gboolean tm_workspace_create_global_tags(const char *pre_process, const char **includes,
-    int includes_count, const char *tags_file, int lang);
+    int includes_count, const char *tags_file, int lang, int jobs);
 
 /* Recreates the tag array of the workspace by collecting the tags of
  all member work objects. You shouldn't have to call this directly since
@@ -139,7 +148,26 @@ const GPtrArray *
 tm_workspace_find_scoped (const char *name, const char *scope, gint type,
     TMTagAttrType *attrs, gboolean partial, langType lang, gboolean global_search);
 
-/* Returns all matching members tags found in given struct/union/class name.
+/* Returns the tags whose names contain the characters of pattern in the same order,
+ ignoring case, ranked by how well they match with matches at the start of words
+ in underscore_names and camelCaseNames ranking highest.
+ \param pattern The characters to find.
+ \param type The tag types to return TMTagType (types can be binary or'ed).
+ \param lang Specifies the language(see the table in parsers.h) of the tags to be found,
+             -1 for all
+ \param source_file The file being edited, whose tags are ranked higher, or NULL.
+ \param scope The scope being edited, whose members are ranked higher, or NULL.
+ \param max_count The maximum number of tags to return.
+ \param max_seconds The time after which to stop looking at more tags. Tags of the
+             workspace are looked at before global tags.
+ \return Array of the best matching tags, best first. Do not free() it since it is
+ a static member.
+*/
+const GPtrArray *tm_workspace_find_fuzzy(const char *pattern, int type, langType lang,
+	const TMSourceFile *source_file, const char *scope, guint max_count, gdouble max_seconds);
+
+/* Returns all matching members tags found in given struct/union/class name,
+ including those inherited from its base classes, sorted by name.
  \param name Name of the struct/union/class.
  \param file_tags A GPtrArray of edited file TMTag pointers (for search speedup, can be NULL).
  \return A GPtrArray of TMTag pointers to struct/union/class members */